@@ -0,0 +1,187 @@
+#ifndef __GENETICS_BENCH_H
+#define __GENETICS_BENCH_H
+
+// Common part of benchmarks: options, timing and report in CSV or JSON
+//
+// Options of every benchmark:
+//   --format=csv|json   (csv)
+//   --output=<file>     (standard output)
+//   --threads=<n>       (1)
+//   --repetitions=<n>   (5) each case is run that many times, minimum and median are reported
+//   --seed=<n>          (42)
+//   --quick             smaller sizes, e.g. to check that benchmarks still run
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <optional>
+#include <tuple>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace bench {
+
+struct Options {
+	std::string format = "csv";
+	std::string output;
+	std::size_t threads = 1;
+	std::size_t repetitions = 5;
+	std::uint64_t seed = 42;
+	bool quick = false;
+
+	Options(int argc, char const *argv[]) {
+		for (int i = 1; i < argc; ++i) {
+			std::string const argument = argv[i];
+			auto const value = [&argument](std::string const& name) -> std::optional<std::string> {
+				if (argument.rfind(name + "=", 0) != 0) return std::nullopt;
+				return argument.substr(name.size() + 1);
+			};
+			if (auto v = value("--format")) format = v.value();
+			else if (auto v = value("--output")) output = v.value();
+			else if (auto v = value("--threads")) threads = std::stoull(v.value());
+			else if (auto v = value("--repetitions")) repetitions = std::max<std::size_t>(1, std::stoull(v.value()));
+			else if (auto v = value("--seed")) seed = std::stoull(v.value());
+			else if (argument == "--quick") quick = true;
+			else throw std::invalid_argument("Unknown option: " + argument);
+		}
+		if (format != "csv" && format != "json") throw std::invalid_argument("Unknown format: " + format);
+	}
+};
+
+struct Result {
+	std::string benchmark;
+	std::vector<std::pair<std::string, std::string>> parameters;
+	std::size_t repetitions = 0;
+	double seconds_min = 0, seconds_median = 0;
+	double items = 0; // per run, e.g. matings or specimens; 0 if not applicable
+	std::string note; // e.g. best cost, to see that compared runs did the same work
+};
+
+// Runs setup() (not timed) and body() repetitions times
+template <typename Setup, typename Body>
+std::pair<double, double> measure(std::size_t repetitions, Setup&& setup, Body&& body) {
+	std::vector<double> seconds;
+	for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+		setup();
+		auto const start = std::chrono::steady_clock::now();
+		body();
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+		seconds.push_back(elapsed.count());
+	}
+	std::sort(seconds.begin(), seconds.end());
+	return {seconds.front(), seconds[seconds.size() / 2]};
+}
+
+class Report {
+public:
+	explicit Report(Options const& options) : options(options) { }
+
+	template <typename Setup, typename Body>
+	Result& run(std::string benchmark, std::vector<std::pair<std::string, std::string>> parameters, double items, Setup&& setup, Body&& body) {
+		Result result;
+		result.benchmark = std::move(benchmark);
+		result.parameters = std::move(parameters);
+		result.parameters.emplace_back("threads", std::to_string(options.threads));
+		result.repetitions = options.repetitions;
+		result.items = items;
+		std::tie(result.seconds_min, result.seconds_median) = measure(options.repetitions, setup, body);
+		results.push_back(std::move(result));
+		// Progress, so that long runs are not silent
+		std::cerr << results.back().benchmark << ' ' << parameters_of(results.back(), ' ') << ": " << results.back().seconds_median << " s" << std::endl;
+		return results.back();
+	}
+
+	// Written on destruction, if not before
+	void write() {
+		if (written) return;
+		written = true;
+		std::ofstream file;
+		if (!options.output.empty()) {
+			file.open(options.output);
+			if (!file) throw std::runtime_error("Cannot open " + options.output);
+		}
+		std::ostream& out = options.output.empty() ? std::cout : file;
+		if (options.format == "json") {
+			write_json(out);
+		} else {
+			write_csv(out);
+		}
+	}
+
+	~Report() {
+		try {
+			write();
+		} catch (std::exception const& error) {
+			std::cerr << error.what() << std::endl;
+		}
+	}
+
+private:
+	Options const& options;
+	std::vector<Result> results;
+	bool written = false;
+
+	static std::string parameters_of(Result const& result, char separator) {
+		std::string text;
+		for (auto const& [name, value] : result.parameters) {
+			if (!text.empty()) text += separator;
+			text += name + "=" + value;
+		}
+		return text;
+	}
+
+	static double items_per_second(Result const& result) {
+		return result.items > 0 && result.seconds_median > 0 ? result.items / result.seconds_median : 0;
+	}
+
+	void write_csv(std::ostream& out) const {
+		out << "benchmark,parameters,repetitions,seconds_min,seconds_median,items,items_per_second,note\n";
+		for (auto const& result : results) {
+			out << result.benchmark << ',' << parameters_of(result, ';') << ',' << result.repetitions << ','
+			    << result.seconds_min << ',' << result.seconds_median << ',' << result.items << ','
+			    << items_per_second(result) << ',' << result.note << '\n';
+		}
+	}
+
+	void write_json(std::ostream& out) const {
+		auto const quoted = [](std::string const& text) {
+			std::string result = "\"";
+			for (char c : text) {
+				if (c == '"' || c == '\\') result += '\\';
+				result += c;
+			}
+			return result + '"';
+		};
+		out << "[\n";
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			auto const& result = results[i];
+			out << "  {\"benchmark\": " << quoted(result.benchmark) << ", \"parameters\": {";
+			for (std::size_t p = 0; p < result.parameters.size(); ++p) {
+				out << (p ? ", " : "") << quoted(result.parameters[p].first) << ": " << quoted(result.parameters[p].second);
+			}
+			out << "}, \"repetitions\": " << result.repetitions
+			    << ", \"seconds_min\": " << result.seconds_min
+			    << ", \"seconds_median\": " << result.seconds_median
+			    << ", \"items\": " << result.items
+			    << ", \"items_per_second\": " << items_per_second(result)
+			    << ", \"note\": " << quoted(result.note) << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "]\n";
+	}
+};
+
+template <typename T>
+std::string to_string(T const& value) {
+	std::ostringstream stream;
+	stream << value;
+	return stream.str();
+}
+
+} // namespace bench
+
+#endif //__GENETICS_BENCH_H
@@ -0,0 +1,151 @@
+// Whole evolve() runs of test01 (integer) and test03 (polynomial regression) problems
+// Input of test03 is fixed (the same as its scripted run), so are seeds of initial generation and of evolution
+
+#include "bench.hpp"
+#include "integer.hpp"
+#include "../include/genetics_mating.hpp"
+#include "../test/polynomial.hpp"
+
+namespace {
+
+struct Case {
+	std::size_t survivors;
+	std::size_t generations_till_elimination;
+	std::size_t generations;
+};
+
+// Mating schedulers with budget of offspring per generation; all pairs are the default
+enum class Scheduler { ALL_PAIRS, RANDOM, TOURNAMENT, PROPORTIONAL };
+
+std::shared_ptr<genetics::IMatingScheduler<bench::gene_t, bench::cost_t>> make_scheduler(Scheduler scheduler, std::size_t budget) {
+	switch (scheduler) {
+	case Scheduler::RANDOM:
+		return std::make_shared<genetics::RandomMating<bench::gene_t, bench::cost_t>>(budget);
+	case Scheduler::TOURNAMENT:
+		return std::make_shared<genetics::TournamentMating<bench::gene_t, bench::cost_t>>(budget, 4);
+	case Scheduler::PROPORTIONAL:
+		return std::make_shared<genetics::ProportionalMating<bench::gene_t, bench::cost_t>>(budget, [](bench::cost_t cost) { return 1.0 / (1.0 + cost); });
+	default:
+		return nullptr;
+	}
+}
+
+char const* scheduler_name(Scheduler scheduler) {
+	switch (scheduler) {
+	case Scheduler::RANDOM: return "random";
+	case Scheduler::TOURNAMENT: return "tournament";
+	case Scheduler::PROPORTIONAL: return "proportional";
+	default: return "all_pairs";
+	}
+}
+
+void bench_integer(bench::Report& report, bench::Options const& options, Case const& test,
+                   Scheduler scheduler = Scheduler::ALL_PAIRS, std::size_t budget = 0) {
+	genetics::Environment<bench::gene_t, bench::cost_t> environment(
+		std::make_shared<bench::IntegerFitness>(), std::make_shared<bench::IntegerCrossover>(),
+		std::make_shared<bench::IntegerSelection>(test.survivors, test.generations, test.generations_till_elimination),
+		options.threads, options.seed);
+	environment.set_mating_scheduler(make_scheduler(scheduler, budget));
+	auto const first_generation = bench::integer_generation(test.survivors, options.seed);
+
+	genetics::Generation<bench::gene_t> generation;
+	genetics::GenerationsCosts<bench::cost_t> costs;
+	auto& result = report.run("evolve", {{"problem", "integer"},
+	                                     {"survivors", std::to_string(test.survivors)},
+	                                     {"generations_till_elimination", std::to_string(test.generations_till_elimination)},
+	                                     {"generations", std::to_string(test.generations)},
+	                                     {"mating", scheduler_name(scheduler)},
+	                                     {"budget", std::to_string(budget)}}, 0,
+	                          [&] { generation = first_generation; costs.clear(); },
+	                          [&] { generation = environment.evolve(std::move(generation), costs); });
+	result.note = "best=" + std::to_string(costs.empty() ? 0 : costs[0]);
+}
+
+// Pareto: inaccuracy and size are separate objectives
+// Bounded: tests of an offspring are stopped, once it can't survive
+struct PolynomialVariant {
+	bool pareto = false;
+	bool bounded = false;
+	std::size_t points = 3;
+};
+
+void bench_polynomial(bench::Report& report, bench::Options const& options, Case const& test, PolynomialVariant variant = {}) {
+	// x^2 + x + 1
+	std::vector<std::pair<domain_t, domain_t>> target = {{0, 1}, {1, 3}, {2, 7}};
+	if (variant.points != target.size()) {
+		target.clear();
+		for (std::size_t i = 0; i < variant.points; ++i) {
+			domain_t const x = -2.f + 4.f * static_cast<domain_t>(i) / static_cast<domain_t>(variant.points);
+			target.emplace_back(x, x * x + x + 1);
+		}
+	}
+	auto selection = std::make_shared<PolySelection>(test.survivors, test.generations);
+	selection->set_generations_till_elimination(test.generations_till_elimination);
+	genetics::Environment<Polynomial, PolynomialCost> environment(
+		std::make_shared<PolyFitness>(target, variant.bounded), std::make_shared<PolyCrossover>(), selection, options.threads, options.seed);
+	if (variant.pareto) {
+		environment.set_objectives(std::make_shared<PolyObjectives>());
+	}
+
+	genetics::RandomStream random(options.seed, 0);
+	std::vector<Polynomial> polynomials(test.survivors);
+	for (auto& polynomial : polynomials) {
+		polynomial.resize(random.get_random_int<std::size_t>(0, 10));
+		random.fill_random_float<domain_t>(polynomial, -10.f, 10.f);
+	}
+	auto const first_generation = genetics::new_generation(std::move(polynomials));
+
+	genetics::Generation<Polynomial> generation;
+	genetics::GenerationsCosts<PolynomialCost> costs;
+	auto& result = report.run("evolve", {{"problem", "polynomial"},
+	                                     {"elimination", variant.pareto ? "pareto" : "cost"},
+	                                     {"fitness", variant.bounded ? "bounded" : "full"},
+	                                     {"points", std::to_string(target.size())},
+	                                     {"survivors", std::to_string(test.survivors)},
+	                                     {"generations_till_elimination", std::to_string(test.generations_till_elimination)},
+	                                     {"generations", std::to_string(test.generations)}}, 0,
+	                          [&] { generation = first_generation; costs.clear(); },
+	                          [&] { generation = environment.evolve(std::move(generation), costs); });
+	// Evolution could stop early, when target is matched
+	result.note = "reached=" + std::to_string(std::get<genetics::GENERATION_COUNT_ID>(generation))
+	            + " best=" + (costs.empty() ? std::string("none") : bench::to_string(costs[0]));
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+	bench::Options const options(argc, argv);
+	bench::Report report(options);
+
+	// Population grows as survivors ^ (2 ^ generations_till_elimination), so the latter stays small
+	std::vector<Case> const integer_cases = options.quick
+		? std::vector<Case>{{100, 1, 5}, {30, 2, 4}}
+		: std::vector<Case>{{100, 1, 20}, {300, 1, 20}, {1000, 1, 10}, {30, 2, 10}, {60, 2, 10}};
+	std::vector<Case> const polynomial_cases = options.quick
+		? std::vector<Case>{{30, 1, 5}, {10, 2, 4}}
+		: std::vector<Case>{{30, 1, 20}, {100, 1, 20}, {300, 1, 10}, {15, 2, 10}, {30, 2, 6}, {6, 3, 3}};
+
+	for (auto const& test : integer_cases) {
+		bench_integer(report, options, test);
+	}
+	// Same number of offspring as all pairs of 1000 survivors, and then many more survivors with the same budget
+	std::size_t const budget = options.quick ? 4950 : genetics::pairs_amount(1000);
+	for (std::size_t survivors : {options.quick ? 100 : 1000, options.quick ? 1000 : 100'000}) {
+		for (auto scheduler : {Scheduler::RANDOM, Scheduler::TOURNAMENT, Scheduler::PROPORTIONAL}) {
+			bench_integer(report, options, {survivors, 1, options.quick ? 5u : 10u}, scheduler, budget);
+		}
+	}
+	for (auto const& test : polynomial_cases) {
+		bench_polynomial(report, options, test);
+	}
+	for (auto const& test : polynomial_cases) {
+		if (test.generations_till_elimination == 1) {
+			bench_polynomial(report, options, test, {.pareto = true});
+		}
+	}
+	for (bool bounded : {false, true}) {
+		bench_polynomial(report, options, {options.quick ? 30u : 100u, 1, options.quick ? 5u : 20u}, {.bounded = bounded, .points = 1000});
+	}
+
+	return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef __GENETICS_BENCH_INTEGER_H
+#define __GENETICS_BENCH_INTEGER_H
+
+// Integer problem of test01: specimens approach 100 by averaging parents, with rare +-1 mutations
+
+#include "../include/genetics.hpp"
+
+namespace bench {
+
+typedef long long int gene_t;
+typedef std::size_t cost_t;
+
+class IntegerFitness : public genetics::IPointwiseFitness<gene_t, cost_t> {
+public:
+	cost_t cost(gene_t const& specimen, std::size_t) const override {
+		gene_t constexpr ideal = 100;
+		return static_cast<cost_t>(std::max(specimen, ideal) - std::min(specimen, ideal));
+	}
+};
+
+class IntegerCrossover : public genetics::ICrossover<gene_t, cost_t> {
+public:
+	bool does_commute() const override { return true; }
+	bool fixed_offspring_amount() const override { return true; }
+
+	gene_t cross(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t> const&,
+	             std::size_t parent1, std::size_t parent2, genetics::RandomStream& random) override {
+		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+		gene_t new_specimen = (specimens[parent1] + specimens[parent2]) / 2;
+		if (random.get_random_float<float>(0.f, 1.f) < 0.3f) {
+			new_specimen += random.get_random_int<int>(0, 1) ? -1 : 1;
+		}
+		return new_specimen;
+	}
+};
+
+// Never good enough, so that every run does the same amount of work
+class IntegerSelection : public genetics::ISelection<gene_t, cost_t> {
+public:
+	IntegerSelection(std::size_t amount, std::optional<std::size_t> generations, std::size_t generations_per_elimination = 1)
+	  : amount(amount), generations(generations), generations_per_elimination(generations_per_elimination) { }
+
+	std::size_t survivors() const override { return amount; }
+	std::optional<std::size_t> max_generations() const override { return generations; }
+	std::size_t generations_till_eliminaion() const override { return generations_per_elimination; }
+
+private:
+	std::size_t amount;
+	std::optional<std::size_t> generations;
+	std::size_t generations_per_elimination;
+};
+
+inline genetics::Generation<gene_t> integer_generation(std::size_t size, std::uint64_t seed) {
+	genetics::RandomStream random(seed, 0);
+	std::vector<gene_t> specimens(size);
+	random.fill_random_int<gene_t>(specimens, -1000000, 1000000);
+	return genetics::new_generation(std::move(specimens));
+}
+
+} // namespace bench
+
+#endif //__GENETICS_BENCH_INTEGER_H
@@ -0,0 +1,141 @@
+// Linear GP interpreter: each instruction set over random programs, and prefix cache over offspring of evaluated parents
+// Notes show total error, to see that instruction sets and cache give the same costs
+
+#include "bench.hpp"
+#include "../include/genetics_lgp.hpp"
+
+namespace {
+
+using Isa = genetics::LinearInterpreter::Isa;
+
+struct LinearCost {
+	float error = 0;
+	std::size_t length = 0;
+
+	LinearCost() = default;
+	LinearCost(float error, std::size_t length) : error(error), length(length) { }
+};
+
+genetics::LinearInterpreter random_dataset(genetics::LinearMachine const& machine, std::size_t rows, Isa isa, std::uint64_t seed) {
+	genetics::RandomStream random(seed, 1);
+	std::vector<std::vector<float>> inputs(rows, std::vector<float>(machine.inputs));
+	std::vector<float> outputs(rows);
+	for (std::size_t j = 0; j < rows; ++j) {
+		random.fill_random_float<float>(inputs[j], -2.f, 2.f);
+		outputs[j] = random.get_random_float<float>(-10.f, 10.f);
+	}
+	return genetics::LinearInterpreter(machine, inputs, outputs, isa);
+}
+
+// Chained programs accumulate into registers they read, so most of their code is effective (random programs have few effective instructions)
+genetics::Generation<genetics::LinearProgram> random_programs(genetics::LinearMachine const& machine, std::size_t size, bool chained,
+                                                              std::uint64_t seed) {
+	genetics::RandomStream random(seed, 0);
+	std::vector<genetics::LinearProgram> programs(size);
+	for (auto& program : programs) {
+		program = genetics::random_linear_program(machine, random.get_random_int<std::size_t>(machine.max_length / 2, machine.max_length), random);
+		if (!chained) continue;
+		for (auto& instruction : program) {
+			if (instruction.op == genetics::LinearOp::SET_CONSTANT) instruction.op = genetics::LinearOp::ADD_CONSTANT;
+			instruction.source1 = instruction.destination;
+		}
+	}
+	return genetics::new_generation(std::move(programs));
+}
+
+// Offspring of one generation, as evolve has them: matings of the default scheduler (crossover does not commute,
+// so every pair mates both ways), each offspring with its own random stream
+genetics::Generation<genetics::LinearProgram> offspring_of(genetics::LinearMachine const& machine, genetics::Generation<genetics::LinearProgram> const& parents,
+                                                           std::uint64_t seed) {
+	genetics::LinearCrossover<LinearCost> crossover(machine);
+	genetics::GenerationsCosts<LinearCost> const costs(std::get<genetics::SPECIMENS_ID>(parents).size());
+	genetics::AllPairsMating<genetics::LinearProgram, LinearCost> scheduler(!crossover.does_commute());
+	genetics::RandomStreams const streams(seed, std::get<genetics::GENERATION_COUNT_ID>(parents));
+	std::vector<genetics::Mating> matings;
+	scheduler.matings(0, scheduler.schedule(parents, costs), streams, matings);
+	std::vector<genetics::LinearProgram> offspring;
+	for (auto const& mating : matings) {
+		genetics::RandomStream random = streams.stream(mating.pair, 0);
+		offspring.push_back(crossover.cross(parents, costs, mating.parent1, mating.parent2, random));
+	}
+	return genetics::new_generation(std::move(offspring));
+}
+
+double total_error(genetics::LinearInterpreter const& interpreter, genetics::Generation<genetics::LinearProgram> const& generation) {
+	double total = 0;
+	for (auto const& program : std::get<genetics::SPECIMENS_ID>(generation)) {
+		total += interpreter(program);
+	}
+	return total;
+}
+
+void bench_interpreter(bench::Report& report, std::string const& name, genetics::LinearInterpreter const& interpreter,
+                       genetics::Generation<genetics::LinearProgram> const& generation) {
+	std::size_t const size = std::get<genetics::SPECIMENS_ID>(generation).size();
+	double error = 0;
+	auto& result = report.run("interpreter", {{"isa", name}, {"programs", std::to_string(size)}, {"rows", std::to_string(interpreter.size())}},
+	                          static_cast<double>(size), [] { }, [&] { error = total_error(interpreter, generation); });
+	result.note = "total_error=" + std::to_string(error);
+}
+
+// Cache starts empty, with parents evaluated (they were, a generation ago); then offspring are timed
+void bench_cache(bench::Report& report, genetics::LinearInterpreter& interpreter, std::size_t cache_bytes,
+                 std::string const& programs, genetics::Generation<genetics::LinearProgram> const& parents,
+                 genetics::Generation<genetics::LinearProgram> const& offspring) {
+	std::size_t const size = std::get<genetics::SPECIMENS_ID>(offspring).size();
+	double error = 0;
+	auto& result = report.run("prefix_cache", {{"programs", programs}, {"cache", cache_bytes ? "on" : "off"}, {"offspring", std::to_string(size)},
+	                                           {"rows", std::to_string(interpreter.size())}},
+	                          static_cast<double>(size),
+	                          [&] {
+		interpreter.set_prefix_cache(cache_bytes);
+		total_error(interpreter, parents);
+	},
+	                          [&] { error = total_error(interpreter, offspring); });
+	auto const statistics = interpreter.prefix_cache_statistics();
+	result.note = "total_error=" + std::to_string(error) + ";hits=" + std::to_string(statistics.hits);
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+	bench::Options const options(argc, argv);
+	bench::Report report(options);
+
+	genetics::LinearMachine machine;
+	machine.registers = 8;
+	machine.inputs = 2;
+	machine.max_length = 64;
+
+	std::vector<std::pair<std::string, Isa>> instruction_sets = {{"scalar", Isa::SCALAR}};
+	if (genetics::LinearInterpreter::best_isa() >= Isa::AVX2) instruction_sets.push_back({"avx2", Isa::AVX2});
+	if (genetics::LinearInterpreter::best_isa() >= Isa::AVX512) instruction_sets.push_back({"avx512", Isa::AVX512});
+
+	auto const programs = random_programs(machine, options.quick ? 200 : 2'000, false, options.seed);
+	for (std::size_t rows : {16, 256, 4096}) {
+		if (options.quick && rows > 256) continue;
+		for (auto const& [name, isa] : instruction_sets) {
+			bench_interpreter(report, name, random_dataset(machine, rows, isa, options.seed), programs);
+		}
+	}
+
+	// Cache pays off with long effective code: chained programs of up to 256 instructions
+	struct CacheCase {
+		std::string programs;
+		bool chained;
+		std::size_t max_length;
+	};
+	std::size_t const parents = options.quick ? 8 : 32, rows = options.quick ? 256 : 4096;
+	for (auto const& [name, chained, max_length] : {CacheCase{"random", false, 64}, CacheCase{"chained", true, 64}, CacheCase{"chained_long", true, 256}}) {
+		genetics::LinearMachine cache_machine = machine;
+		cache_machine.max_length = max_length;
+		auto const generation = random_programs(cache_machine, parents, chained, options.seed);
+		auto const offspring = offspring_of(cache_machine, generation, options.seed);
+		auto interpreter = random_dataset(cache_machine, rows, genetics::LinearInterpreter::best_isa(), options.seed);
+		for (std::size_t cache_bytes : {std::size_t(0), std::size_t(256) << 20}) {
+			bench_cache(report, interpreter, cache_bytes, name, generation, offspring);
+		}
+	}
+
+	return 0;
+}
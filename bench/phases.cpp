@@ -0,0 +1,137 @@
+// Microbenchmarks of Environment phases: crossover, elimination (by cost and by Pareto fronts), and permutation helpers
+
+#include "bench.hpp"
+#include "integer.hpp"
+#include "../test/polynomial.hpp"
+
+namespace {
+
+// One generation of crossover without elimination (and without fitness: costs of parents are known)
+template <typename Genome, typename Cost, typename Fitness, typename Crossover, typename Selection>
+void bench_crossover(bench::Report& report, bench::Options const& options, std::string const& problem,
+                     std::shared_ptr<Fitness> fitness, std::shared_ptr<Crossover> crossover, std::shared_ptr<Selection> selection,
+                     genetics::Generation<Genome> const& parents) {
+	genetics::Environment<Genome, Cost> environment(fitness, crossover, selection, options.threads, options.seed);
+	genetics::GenerationsCosts<Cost> parents_costs;
+	for (auto const& specimen : std::get<genetics::SPECIMENS_ID>(parents)) {
+		parents_costs.push_back(fitness->cost(specimen, 0));
+	}
+
+	std::size_t const size = std::get<genetics::SPECIMENS_ID>(parents).size();
+	genetics::Generation<Genome> generation;
+	genetics::GenerationsCosts<Cost> costs;
+	auto& result = report.run("compute_crossover", {{"problem", problem}, {"specimens", std::to_string(size)}},
+	                          static_cast<double>(genetics::pairs_amount(size)),
+	                          [&] { generation = parents; costs = parents_costs; },
+	                          [&] { environment.advance(generation, costs, 1); });
+	result.note = "offspring=" + std::to_string(std::get<genetics::SPECIMENS_ID>(generation).size() - size);
+}
+
+// What eliminate_losers does: top-k of costs, then compaction of specimens and costs
+void bench_elimination(bench::Report& report, bench::Options const& options, std::size_t size, std::size_t survivors) {
+	genetics::ThreadPool pool(options.threads);
+	auto const pristine = bench::integer_generation(size, options.seed);
+	auto const& pristine_specimens = std::get<genetics::SPECIMENS_ID>(pristine);
+	genetics::GenerationsCosts<bench::cost_t> pristine_costs;
+	for (auto specimen : pristine_specimens) {
+		pristine_costs.push_back(bench::IntegerFitness().cost(specimen, 0));
+	}
+
+	std::vector<bench::gene_t> specimens;
+	genetics::GenerationsCosts<bench::cost_t> costs;
+	auto& result = report.run("eliminate_losers", {{"specimens", std::to_string(size)}, {"survivors", std::to_string(survivors)}},
+	                          static_cast<double>(size),
+	                          [&] { specimens = pristine_specimens; costs = pristine_costs; },
+	                          [&] {
+		genetics::Compaction const compaction(genetics::select_best(costs, survivors, pool));
+		compaction.apply(specimens);
+		compaction.apply(costs);
+	});
+	result.note = "best=" + std::to_string(costs[0]);
+}
+
+void bench_permutation(bench::Report& report, bench::Options const& options, std::size_t size) {
+	auto const pristine = bench::integer_generation(size, options.seed);
+	auto const& pristine_specimens = std::get<genetics::SPECIMENS_ID>(pristine);
+	auto const less = [](bench::gene_t one, bench::gene_t another) { return one < another; };
+
+	std::vector<std::size_t> permutation;
+	report.run("sort_to_permutation", {{"elements", std::to_string(size)}}, static_cast<double>(size),
+	           [] { },
+	           [&] { permutation = genetics::sort_to_permutation(pristine_specimens, less); });
+
+	std::vector<bench::gene_t> specimens;
+	auto& result = report.run("apply_permutation_in_place", {{"elements", std::to_string(size)}}, static_cast<double>(size),
+	                          [&] { specimens = pristine_specimens; },
+	                          [&] { genetics::apply_permutation_in_place(specimens, permutation); });
+	result.note = std::is_sorted(specimens.begin(), specimens.end()) ? "sorted" : "NOT SORTED";
+}
+
+// Non-dominated sorting and crowding distance of random points, as in select_pareto
+void bench_pareto(bench::Report& report, bench::Options const& options, std::size_t size, std::size_t objectives) {
+	genetics::ThreadPool pool(options.threads);
+	std::vector<double> values(size * objectives);
+	genetics::RandomStream(options.seed, 0).fill_random_float<double>(values, 0.0, 1.0);
+
+	std::vector<std::size_t> fronts;
+	auto& result = report.run("non_dominated_fronts", {{"points", std::to_string(size)}, {"objectives", std::to_string(objectives)}},
+	                          static_cast<double>(size),
+	                          [] { },
+	                          [&] {
+		fronts = genetics::non_dominated_fronts(values, objectives, pool);
+		genetics::crowding_distances(values, objectives, fronts, 0, pool);
+	});
+	result.note = "fronts=" + std::to_string(fronts.empty() ? 0 : *std::max_element(fronts.begin(), fronts.end()) + 1);
+}
+
+genetics::Generation<Polynomial> polynomial_generation(std::size_t size, std::uint64_t seed) {
+	genetics::RandomStream random(seed, 0);
+	std::vector<Polynomial> polynomials(size);
+	for (auto& polynomial : polynomials) {
+		polynomial.resize(random.get_random_int<std::size_t>(1, 10));
+		random.fill_random_float<domain_t>(polynomial, -10.f, 10.f);
+	}
+	return genetics::new_generation(std::move(polynomials));
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+	bench::Options const options(argc, argv);
+	bench::Report report(options);
+	std::size_t const scale = options.quick ? 10 : 1;
+
+	// Survivors and elimination are not used: the only generation is not an eliminating one
+	for (std::size_t size : {1000 / scale, 3000 / scale}) {
+		bench_crossover<bench::gene_t, bench::cost_t>(report, options, "integer",
+			std::make_shared<bench::IntegerFitness>(), std::make_shared<bench::IntegerCrossover>(),
+			std::make_shared<bench::IntegerSelection>(1, std::nullopt, 2),
+			bench::integer_generation(size, options.seed));
+	}
+	std::vector<std::pair<domain_t, domain_t>> const target = {{0, 1}, {1, 3}, {2, 7}, {3, 13}, {-1, 1}};
+	for (std::size_t size : {300 / scale, 1000 / scale}) {
+		auto selection = std::make_shared<PolySelection>(1, 1);
+		selection->set_generations_till_elimination(2);
+		bench_crossover<Polynomial, PolynomialCost>(report, options, "polynomial",
+			std::make_shared<PolyFitness>(target), std::make_shared<PolyCrossover>(), selection,
+			polynomial_generation(size, options.seed));
+	}
+
+	for (std::size_t size : {100'000 / scale, 1'000'000 / scale}) {
+		for (std::size_t survivors : {100, 10'000}) {
+			bench_elimination(report, options, size, std::min(size, survivors));
+		}
+	}
+
+	for (std::size_t size : {100'000 / scale, 1'000'000 / scale}) {
+		bench_permutation(report, options, size);
+	}
+
+	for (std::size_t objectives : {2, 3, 4}) {
+		for (std::size_t size : {10'000 / scale, 100'000 / scale}) {
+			bench_pareto(report, options, size, objectives);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,84 @@
+// Fitness of polynomial regression: PolyFitness of test03 (scalar Horner) against PolynomialFitness (SIMD kernel)
+// Each instruction set is run separately; notes show total error, to see that all of them give the same costs
+
+#include "bench.hpp"
+#include "../include/genetics_polynomial.hpp"
+#include "../test/polynomial.hpp"
+
+namespace {
+
+std::vector<std::pair<domain_t, domain_t>> random_target(std::size_t points, std::uint64_t seed) {
+	genetics::RandomStream random(seed, 1);
+	std::vector<std::pair<domain_t, domain_t>> target(points);
+	for (auto& point : target) {
+		point.first = random.get_random_float<domain_t>(-2.f, 2.f);
+		point.second = random.get_random_float<domain_t>(-10.f, 10.f);
+	}
+	return target;
+}
+
+genetics::Generation<Polynomial> random_polynomials(std::size_t size, std::uint64_t seed) {
+	genetics::RandomStream random(seed, 0);
+	std::vector<Polynomial> polynomials(size);
+	for (auto& polynomial : polynomials) {
+		polynomial.resize(random.get_random_int<std::size_t>(1, 10));
+		random.fill_random_float<domain_t>(polynomial, -10.f, 10.f);
+	}
+	return genetics::new_generation(std::move(polynomials));
+}
+
+std::string total_error(genetics::GenerationsCosts<PolynomialCost> const& costs) {
+	double total = 0;
+	for (auto const& cost : costs) {
+		total += cost.get_inaccuracy();
+	}
+	return "total_error=" + std::to_string(total);
+}
+
+// What compute_pointwise_costs does: one cost_batch per chunk (PolyFitness gets the default one, calling cost)
+template <typename Fitness>
+void bench_fitness(bench::Report& report, bench::Options const& options, std::string const& name, Fitness const& fitness,
+                   genetics::Generation<Polynomial> const& generation, std::size_t points) {
+	genetics::ThreadPool pool(options.threads);
+	auto const& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+	auto const& ages = std::get<genetics::AGE_ID>(generation);
+	std::size_t const grain = 1024,
+	                  chunks = (specimens.size() + grain - 1) / grain;
+
+	genetics::GenerationsCosts<PolynomialCost> costs;
+	auto& result = report.run("fitness", {{"fitness", name}, {"specimens", std::to_string(specimens.size())}, {"points", std::to_string(points)}},
+	                          static_cast<double>(specimens.size()),
+	                          [&] { costs.assign(specimens.size(), PolynomialCost()); },
+	                          [&] {
+		pool.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+			fitness.cost_batch(specimens, ages, chunk * grain, std::min(specimens.size(), (chunk + 1) * grain), costs);
+		});
+	});
+	result.note = total_error(costs);
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+	bench::Options const options(argc, argv);
+	bench::Report report(options);
+	std::size_t const size = options.quick ? 10'000 : 200'000;
+	auto const generation = random_polynomials(size, options.seed);
+
+	using Isa = genetics::PolynomialErrors::Isa;
+	std::vector<std::pair<std::string, Isa>> instruction_sets = {{"scalar", Isa::SCALAR}};
+	if (genetics::PolynomialErrors::best_isa() >= Isa::AVX2) instruction_sets.push_back({"avx2", Isa::AVX2});
+	if (genetics::PolynomialErrors::best_isa() >= Isa::AVX512) instruction_sets.push_back({"avx512", Isa::AVX512});
+
+	// test03 has a handful of points; the more points, the more lanes are busy
+	for (std::size_t points : {3, 16, 100, 1000}) {
+		if (options.quick && points > 100) continue;
+		auto const target = random_target(points, options.seed);
+		bench_fitness(report, options, "PolyFitness", PolyFitness(target), generation, points);
+		for (auto const& [name, isa] : instruction_sets) {
+			bench_fitness(report, options, "PolynomialFitness/" + name, genetics::PolynomialFitness<PolynomialCost>(target, isa), generation, points);
+		}
+	}
+
+	return 0;
+}
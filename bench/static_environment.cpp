@@ -0,0 +1,116 @@
+// Environment (virtual interfaces) against StaticEnvironment (concrete policies) on test01 problem
+
+#include "bench.hpp"
+#include "../include/genetics.hpp"
+
+typedef long long int gene_t;
+typedef std::size_t cost_t;
+
+namespace {
+
+cost_t distance_to_ideal(gene_t specimen) {
+	gene_t constexpr ideal = 100;
+	return static_cast<cost_t>(std::max(specimen, ideal) - std::min(specimen, ideal));
+}
+
+gene_t mix(gene_t parent1, gene_t parent2, genetics::RandomStream& random) {
+	gene_t new_specimen = (parent1 + parent2) / 2;
+	if (random.get_random_float<float>(0.f, 1.f) < 0.3f) {
+		new_specimen += random.get_random_int<int>(0, 1) ? -1 : 1;
+	}
+	return new_specimen;
+}
+
+// Virtual interfaces, no batching: one virtual call per offspring and per cost
+
+class VirtualFitness : public genetics::IPointwiseFitness<gene_t, cost_t> {
+public:
+	cost_t cost(gene_t const& specimen, std::size_t) const override { return distance_to_ideal(specimen); }
+};
+
+class VirtualCrossover : public genetics::ICrossover<gene_t, cost_t> {
+public:
+	bool does_commute() const override { return true; }
+	bool fixed_offspring_amount() const override { return true; }
+
+	gene_t cross(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t> const&,
+	             std::size_t parent1, std::size_t parent2, genetics::RandomStream& random) override {
+		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+		return mix(specimens[parent1], specimens[parent2], random);
+	}
+};
+
+class VirtualSelection : public genetics::ISelection<gene_t, cost_t> {
+public:
+	explicit VirtualSelection(std::size_t amount, std::size_t generations) : amount(amount), generations(generations) { }
+	std::size_t survivors() const override { return amount; }
+	std::optional<std::size_t> max_generations() const override { return generations; }
+private:
+	std::size_t amount, generations;
+};
+
+// Concrete policies, no base classes
+
+struct StaticFitness {
+	cost_t cost(gene_t const& specimen, std::size_t) const { return distance_to_ideal(specimen); }
+};
+
+struct StaticCrossover {
+	bool does_commute() const { return true; }
+
+	gene_t cross(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t> const&,
+	             std::size_t parent1, std::size_t parent2, genetics::RandomStream& random) {
+		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+		return mix(specimens[parent1], specimens[parent2], random);
+	}
+};
+
+struct StaticSelection {
+	std::size_t amount, generations;
+	std::size_t survivors() const { return amount; }
+	std::optional<std::size_t> max_generations() const { return generations; }
+};
+
+genetics::Generation<gene_t> first_generation(std::size_t size, std::uint64_t seed) {
+	genetics::RandomStream random(seed, 0);
+	std::vector<gene_t> specimens(size);
+	random.fill_random_int<gene_t>(specimens, -1000000, 1000000);
+	return genetics::new_generation(std::move(specimens));
+}
+
+template <typename Environment>
+void run(bench::Report& report, bench::Options const& options, char const* name, Environment& environment, std::size_t survivors, std::size_t generations) {
+	auto const first = first_generation(survivors, options.seed);
+	genetics::Generation<gene_t> result;
+	auto& measured = report.run("evolve", {{"environment", name}, {"survivors", std::to_string(survivors)}, {"generations", std::to_string(generations)}},
+	                            static_cast<double>(genetics::pairs_amount(survivors) * generations),
+	                            [&] { result = first; },
+	                            [&] { result = environment.evolve(std::move(result)); });
+	// Same seed, so both must end with the same best specimen
+	measured.note = "best=" + std::to_string(std::get<genetics::SPECIMENS_ID>(result)[0]);
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+	bench::Options const options(argc, argv);
+	bench::Report report(options);
+	std::size_t const generations = options.quick ? 2 : 10;
+
+	for (std::size_t survivors : {options.quick ? 200 : 1000, options.quick ? 400 : 2000}) {
+		genetics::Environment<gene_t, cost_t> dynamic(std::make_shared<VirtualFitness>(),
+		                                              std::make_shared<VirtualCrossover>(),
+		                                              std::make_shared<VirtualSelection>(survivors, generations),
+		                                              options.threads, options.seed);
+		genetics::StaticEnvironment<gene_t, cost_t, StaticFitness, StaticCrossover, StaticSelection> fixed(
+			std::make_shared<StaticFitness>(),
+			std::make_shared<StaticCrossover>(),
+			std::make_shared<StaticSelection>(StaticSelection{survivors, generations}),
+			options.threads, options.seed);
+
+		run(report, options, "virtual", dynamic, survivors, generations);
+		run(report, options, "static", fixed, survivors, generations);
+	}
+
+	return 0;
+}
@@ -6,15 +6,34 @@
 #include <cstdlib>
 #include <cstddef>
 #include <vector>
+#include <deque>
 #include <optional>
 #include <memory>
 
 #include <map>
+#include <unordered_map>
 #include <functional>
 #include <algorithm>
 #include <random>
+#include <array>
+#include <span>
+#include <limits>
+#include <cstdint>
+#include <type_traits>
+#include <concepts>
 #include <cassert>
 #include <utility>
+#include <numeric>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+
+#include <thread>
+#include <stop_token>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
 
 namespace genetics {
 
@@ -48,278 +67,2319 @@ void apply_permutation_in_place(std::vector<T>& vec, std::vector<std::size_t> pe
 }
 
 
-class RandomGenerator {
-private:
-	std::mt19937 engine;
+/*
+ *	Counter-based random numbers: Philox4x32-10 from
+ *	"Parallel random numbers: as easy as 1, 2, 3" (Salmon et al., 2011).
+ *	No state besides counter and key, so any stream can be recreated on any thread.
+ */
+class Philox4x32 {
+public:
+	using Counter = std::array<std::uint32_t, 4>;
+	using Key = std::array<std::uint32_t, 2>;
 
-	RandomGenerator() {
-		std::random_device rd;
-		engine.seed(rd());
+	static Counter generate(Counter counter, Key key) {
+		for (std::size_t round = 0; round < 10; ++round) {
+			if (round > 0) {
+				key[0] += 0x9E3779B9u;
+				key[1] += 0xBB67AE85u;
+			}
+			std::uint64_t const product0 = static_cast<std::uint64_t>(0xD2511F53u) * counter[0],
+			                    product1 = static_cast<std::uint64_t>(0xCD9E8D57u) * counter[2];
+			counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+			           static_cast<std::uint32_t>(product1),
+			           static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+			           static_cast<std::uint32_t>(product0)};
+		}
+		return counter;
 	}
-	RandomGenerator(RandomGenerator const&) = delete;
-	RandomGenerator& operator=(RandomGenerator&) = delete;
-	~RandomGenerator() { }
+};
 
+// splitmix64 finalizer, used to derive keys
+inline std::uint64_t mix_bits(std::uint64_t value) {
+	value += 0x9E3779B97F4A7C15ull;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+// Fresh seed for runs that do not need to be reproducible
+inline std::uint64_t random_seed() {
+	std::random_device rd;
+	return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+}
+
+/*
+ *	One independent stream of random numbers.
+ *	Stream is identified by 64-bit key and 96-bit position, lowest 32 bits of counter are draw blocks.
+ *	Satisfies UniformRandomBitGenerator, so it can be used with <random> distributions as well,
+ *	but get_random_* and fill_random_* are cheaper: no distribution objects are built.
+ */
+class RandomStream {
 public:
-	static RandomGenerator& get_instance() {
-		static RandomGenerator instance;
-		return instance;
+	using result_type = std::uint32_t;
+
+	RandomStream(std::uint64_t key, std::uint64_t stream, std::uint32_t substream = 0)
+	  : key{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32)}
+	  , counter{0, substream, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)} { }
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()() {
+		if (buffered == block.size()) {
+			refill();
+		}
+		return block[buffered++];
+	}
+
+	std::uint64_t next_uint64() {
+		std::uint64_t const high = (*this)();
+		return (high << 32) | (*this)();
 	}
 
+	// Uniform in [from, to)
 	template <typename T>
 	T get_random_float(T from, T to) {
-		return std::uniform_real_distribution<T>(from, to)(engine);
+		static_assert(std::is_floating_point_v<T>);
+		return from + (to - from) * unit<T>();
 	}
 
+	// Uniform in [from, to]
 	template <typename T>
 	T get_random_int(T from, T to) {
-		return std::uniform_int_distribution<T>(from, to)(engine);
+		static_assert(std::is_integral_v<T>);
+		using U = std::make_unsigned_t<T>;
+		U const range = static_cast<U>(static_cast<U>(to) - static_cast<U>(from));
+		return static_cast<T>(static_cast<U>(from) + static_cast<U>(bounded(static_cast<std::uint64_t>(range))));
 	}
-};
 
-std::size_t constexpr SPECIMENS_ID = 0,
-                      GENERATION_COUNT_ID = 1,
-                      AGE_ID = 2;
+	// Bulk versions: whole blocks are converted at once, no per-value buffering
+	template <typename T>
+	void fill_random_float(std::span<T> output, T from, T to) {
+		static_assert(std::is_floating_point_v<T>);
+		T const scale = to - from;
+		std::size_t i = 0;
+		if constexpr (sizeof(T) <= sizeof(std::uint32_t)) {
+			for (; buffered < block.size() && i < output.size(); ++i) {
+				output[i] = from + scale * to_unit<T>((*this)());
+			}
+			for (; i + 4 <= output.size(); i += 4) {
+				auto const values = Philox4x32::generate(counter, key);
+				++counter[0];
+				for (std::size_t lane = 0; lane < 4; ++lane) {
+					output[i + lane] = from + scale * to_unit<T>(values[lane]);
+				}
+			}
+		}
+		for (; i < output.size(); ++i) {
+			output[i] = from + scale * unit<T>();
+		}
+	}
 
-template <typename Genome>
-using Generation = std::tuple<std::vector<Genome>,
-                              std::size_t,
-                              std::optional<std::vector<std::size_t>>>;
+	template <typename T>
+	void fill_random_int(std::span<T> output, T from, T to) {
+		for (auto& value : output) {
+			value = get_random_int<T>(from, to);
+		}
+	}
 
-template <typename Genome>
-Generation<Genome> new_generation(std::vector<Genome> specimens) {
-	std::size_t const specimens_size = specimens.size();
-	return std::make_tuple(std::move(specimens), 0, std::vector<std::size_t>(specimens_size, 0));
-}
+private:
+	Philox4x32::Key key;
+	Philox4x32::Counter counter;
+	Philox4x32::Counter block{};
+	std::size_t buffered = 4;
 
-template <typename Cost>
-using GenerationsCosts = std::vector<Cost>;
+	void refill() {
+		block = Philox4x32::generate(counter, key);
+		++counter[0];
+		buffered = 0;
+	}
 
-template <typename Genome, typename Cost>
-class IFitness {
-public:
-	virtual ~IFitness() = default;
+	template <typename T>
+	static T to_unit(std::uint32_t bits) {
+		return static_cast<T>(bits >> 8) * static_cast<T>(1.0 / 16777216.0);
+	}
 
-	// All-at-once computation, because from framework POV it parallelizes poorly
-	// Also, must be computed "in place": the most complicated part for framework user
-	// Framework guarantees that size of costs will be 0, and it's capacity will be somewhat close to optimal
-	virtual void cost(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) = 0;
+	template <typename T>
+	T unit() {
+		if constexpr (sizeof(T) <= sizeof(std::uint32_t)) {
+			return to_unit<T>((*this)());
+		} else {
+			return static_cast<T>(next_uint64() >> 11) * static_cast<T>(1.0 / 9007199254740992.0);
+		}
+	}
+
+	// Unbiased integer in [0, range], Lemire's "nearly divisionless" method
+	std::uint64_t bounded(std::uint64_t range) {
+		if (range == std::numeric_limits<std::uint64_t>::max()) return next_uint64();
+		std::uint64_t const span = range + 1;
+		if (span <= std::numeric_limits<std::uint32_t>::max()) {
+			std::uint32_t const span32 = static_cast<std::uint32_t>(span);
+			std::uint64_t product = static_cast<std::uint64_t>((*this)()) * span32;
+			if (static_cast<std::uint32_t>(product) < span32) {
+				std::uint32_t const threshold = static_cast<std::uint32_t>(-span32) % span32;
+				while (static_cast<std::uint32_t>(product) < threshold) {
+					product = static_cast<std::uint64_t>((*this)()) * span32;
+				}
+			}
+			return product >> 32;
+		}
+		unsigned __int128 product = static_cast<unsigned __int128>(next_uint64()) * span;
+		if (static_cast<std::uint64_t>(product) < span) {
+			std::uint64_t const threshold = -span % span;
+			while (static_cast<std::uint64_t>(product) < threshold) {
+				product = static_cast<unsigned __int128>(next_uint64()) * span;
+			}
+		}
+		return static_cast<std::uint64_t>(product >> 64);
+	}
 };
 
 /*
- *	Could be controlled by Genome class.
- *	Must be *very* fast, because it is expected to be done synchronously
- *	in sequential manner.
+ *	All random streams of one crossover phase: key is derived from run seed and generation,
+ *	stream is pair index, substream is offspring index within the pair.
  */
-template <typename Genome, typename Cost>
-class ICrossover {
+class RandomStreams {
 public:
-	virtual ~ICrossover() = default;
+	RandomStreams(std::uint64_t seed, std::size_t generation)
+	  : key(mix_bits(seed ^ mix_bits(generation))) { }
 
-	virtual bool does_commute() const = 0; // Is crossover symmetric?
-	virtual std::size_t default_offspring_amount() const { return 1; } // How much offspring should a pair have by default?
+	RandomStream stream(std::size_t pair, std::size_t offspring) const {
+		return RandomStream(key, pair, static_cast<std::uint32_t>(offspring));
+	}
 
-	// How to scale offspring amount due to high fitness? - This is a must, if one wants to implement specimen aging
-	//     ...after all, this is how real evolution works
-	virtual std::size_t offspring_amount(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2) { return 1; }
-	
-	// What mutations will offspring have? Probably this should be decided/done by crossover operation
-	
-	virtual Genome cross(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2) = 0;
+private:
+	std::uint64_t key;
 };
 
-template <typename Genome, typename Cost>
-class ISelection {
+/*
+ *	Persistent pool of workers with work stealing.
+ *	Calling thread participates as worker 0, so pool of size 1 spawns nothing.
+ *	Chunks are dealt to workers in contiguous blocks; a worker that runs out of
+ *	its own chunks steals half of the remaining chunks of somebody else.
+ */
+class ThreadPool {
 public:
-	virtual ~ISelection() = default;
+	explicit ThreadPool(std::size_t number_of_threads)
+	  : queues(std::max<std::size_t>(number_of_threads, 1)) {
+		for (std::size_t worker = 1; worker < queues.size(); ++worker) {
+			threads.emplace_back([this, worker] { worker_loop(worker); });
+		}
+	}
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
 
-	// Number of specimens selected from each generation.
-	virtual std::size_t survivors() const = 0;
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			stopping = true;
+		}
+		job_started.notify_all();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+	}
 
-	// Check for some specimen with good enough fitness
-	virtual bool is_good_enough(Genome const& specimen, Cost const& cost) { return false; }
-	
-	// Limit of generations for one evolve call
-	virtual std::optional<std::size_t> max_generations() const { return std::nullopt; }
+	std::size_t size() const { return queues.size(); }
 
-	// Selection will be performed only every generations_till_eliminaion generations
-	virtual std::size_t generations_till_eliminaion() const { return 1; }
-};
+	// Calls task(chunk, worker) for every chunk in [0, chunks) and waits for all of them
+	// Not reentrant: task must not call parallel_for of the same pool
+	template <typename Task>
+	void parallel_for(std::size_t chunks, Task&& task) {
+		if (chunks == 0) return;
+		if (queues.size() == 1 || chunks == 1) {
+			for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+				task(chunk, 0);
+			}
+			return;
+		}
 
-// XXX: Probably should be distributed among crossover and selection
-/*
-template <typename Genome, typename Cost>
-class ISimilarity {
-public:
-	virtual ~ISimilarity() = default;
+		for (std::size_t worker = 0; worker < queues.size(); ++worker) {
+			queues[worker].begin = chunks * worker / queues.size();
+			queues[worker].end = chunks * (worker + 1) / queues.size();
+		}
 
-	// After choosing specimen with the best fitness, add penalties for being similar to already chosen pool
-	//virtual bool discourage_similarity() { return false; }
-};
-*/
+		std::function<void(std::size_t, std::size_t)> job = [&task](std::size_t chunk, std::size_t worker) { task(chunk, worker); };
+		{
+			std::lock_guard<std::mutex> lock(job_mutex);
+			current_job = &job;
+			first_exception = nullptr;
+			busy_workers = queues.size() - 1;
+			++epoch;
+		}
+		job_started.notify_all();
 
-template <typename Genome, typename Cost>
-class Environment {
-public:
-	Environment(std::shared_ptr<IFitness<Genome, Cost>> fitness,
-	            std::shared_ptr<ICrossover<Genome, Cost>> crossover,
-	            std::shared_ptr<ISelection<Genome, Cost>> selection,
-	            //std::shared_ptr<ISimilarity<Genome, Cost>> similarity,
-	            std::size_t number_of_threads = 1)
-	  : fitness(fitness)
-	  , crossover(crossover)
-	  , selection(selection)
-	  //, similarity(similarity)
-	  , number_of_threads(number_of_threads) { }
+		run_chunks(0);
 
-	// Main function
-	Generation<Genome> evolve(Generation<Genome> generation) {
-		auto& specimens = std::get<SPECIMENS_ID>(generation);
-		auto& generation_count = std::get<GENERATION_COUNT_ID>(generation);
-		auto& ages = std::get<AGE_ID>(generation);
-		GenerationsCosts<Cost> costs;
+		std::unique_lock<std::mutex> lock(job_mutex);
+		job_finished.wait(lock, [this] { return busy_workers == 0; });
+		current_job = nullptr;
+		if (first_exception) {
+			std::rethrow_exception(first_exception);
+		}
+	}
 
-		std::size_t approximate_size_of_generation_container = compute_approximate_size_of_generation_container();
+private:
+	struct WorkQueue {
+		std::mutex mutex;
+		std::size_t begin = 0, end = 0;
+	};
 
-		specimens.reserve(approximate_size_of_generation_container);
-		if (ages) {
-			ages.value().reserve(approximate_size_of_generation_container);
-		}
-		costs.reserve(approximate_size_of_generation_container);
+	std::vector<WorkQueue> queues;
+	std::vector<std::thread> threads;
 
-		// Compute costs first time
-		compute_fitness(generation, costs);
+	std::mutex job_mutex;
+	std::condition_variable job_started, job_finished;
+	std::function<void(std::size_t, std::size_t)>* current_job = nullptr;
+	std::exception_ptr first_exception;
+	std::size_t busy_workers = 0;
+	std::size_t epoch = 0;
+	bool stopping = false;
 
-		auto starting_generation = generation_count;
-		auto const max_generations = selection->max_generations();
+	std::optional<std::size_t> pop_own(std::size_t worker) {
+		auto& queue = queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.begin == queue.end) return std::nullopt;
+		return queue.begin++;
+	}
+
+	// Takes the back half of victim's chunks, keeps one for itself
+	std::optional<std::size_t> steal(std::size_t thief) {
+		for (std::size_t offset = 1; offset < queues.size(); ++offset) {
+			auto& victim = queues[(thief + offset) % queues.size()];
+			std::size_t stolen_begin, stolen_end;
+			{
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				std::size_t const remaining = victim.end - victim.begin;
+				if (remaining == 0) continue;
+				stolen_end = victim.end;
+				stolen_begin = victim.end - (remaining + 1) / 2;
+				victim.end = stolen_begin;
+			}
+			auto& own = queues[thief];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			own.begin = stolen_begin + 1;
+			own.end = stolen_end;
+			return stolen_begin;
+		}
+		return std::nullopt;
+	}
+
+	void run_chunks(std::size_t worker) {
 		for (;;) {
-			compute_crossover(generation, costs);
-			++generation_count;
+			auto chunk = pop_own(worker);
+			if (!chunk) chunk = steal(worker);
+			if (!chunk) return;
 
-			if (generation_count % selection->generations_till_eliminaion() == 0) {
-				compute_fitness(generation, costs);
-				eliminate_losers(generation, costs);
+			try {
+				(*current_job)(chunk.value(), worker);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(job_mutex);
+				if (!first_exception) first_exception = std::current_exception();
+			}
+		}
+	}
 
-				// NOTE: Why? Because first specimen must be the best, after sorting
-				if (selection->is_good_enough(specimens[0], costs[0])) {
-					break;
-				}
+	void worker_loop(std::size_t worker) {
+		std::size_t seen_epoch = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(job_mutex);
+				job_started.wait(lock, [&] { return stopping || epoch != seen_epoch; });
+				if (stopping) return;
+				seen_epoch = epoch;
 			}
 
-			if (max_generations && (generation_count - starting_generation) >= max_generations.value()) {
-				break;
+			run_chunks(worker);
+
+			std::lock_guard<std::mutex> lock(job_mutex);
+			if (--busy_workers == 0) {
+				job_finished.notify_one();
 			}
 		}
+	}
+};
 
-		return generation;
+/*
+ *	Blocking FIFO of bounded capacity between two threads.
+ *	Producer waits while it is full, consumer waits while it is empty.
+ *	After close() pushes are refused and pops return what is left, then nothing.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) { }
+
+	// false if queue was closed
+	bool push(T value) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+		if (closed) return false;
+		items.push_back(std::move(value));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// nullopt if queue is closed and empty
+	std::optional<T> pop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [this] { return closed || !items.empty(); });
+		if (items.empty()) return std::nullopt;
+		std::optional<T> result(std::move(items.front()));
+		items.pop_front();
+		not_full.notify_one();
+		return result;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
 	}
 
 private:
-	std::size_t number_of_threads;
+	std::size_t const capacity;
+	std::deque<T> items;
+	bool closed = false;
+	std::mutex mutex;
+	std::condition_variable not_full, not_empty;
+};
 
-	std::shared_ptr<IFitness<Genome, Cost>> fitness;
-	std::shared_ptr<ICrossover<Genome, Cost>> crossover;
-	std::shared_ptr<ISelection<Genome, Cost>> selection;
-	//std::shared_ptr<ISimilarity<Genome, Cost>> similarity;
+// Number of unordered pairs (i < j) among n specimens
+inline std::size_t pairs_amount(std::size_t n) {
+	return n < 2 ? 0 : n * (n - 1) / 2;
+}
 
-	// Calculate approximate size of generation container (to minimize reallocations)
-	// offspring_amount is not considered, but it should converge to optimal capacity quickly (provided that resize() of vector does not change capacity)
-	std::size_t compute_approximate_size_of_generation_container() const {
-		std::size_t generation_size_estimation = selection->survivors();
+// Inverse of row-major enumeration of the upper triangle: k -> (i, j), i < j < n
+inline std::pair<std::size_t, std::size_t> unrank_pair(std::size_t k, std::size_t n) {
+	// Row i starts at i * (2n - i - 1) / 2; floating point guess is corrected below
+	auto row_start = [n](std::size_t i) { return i * (2 * n - i - 1) / 2; };
+	double const b = 2.0 * n - 1.0;
+	std::size_t i = static_cast<std::size_t>(std::max(0.0, (b - std::sqrt(b * b - 8.0 * k)) / 2.0));
+	i = std::min(i, n - 2);
+	while (i > 0 && row_start(i) > k) --i;
+	while (i + 1 < n - 1 && row_start(i + 1) <= k) ++i;
+	return {i, i + 1 + (k - row_start(i))};
+}
 
-		// For each generation, when elimination did not occur, we must cumulatively multiply required space
-		// It will be something akin to survivors ^ (2 ^ generations): increases VERY fast
-		// Each generation:
-		//   - All specimen crossover with all specimens (n * n)
-		//   - But! Specimens do not crossover with themselves (- n)
-		//   - And if crossover commutes, we don't need half of that (/ 2)
-		for (std::size_t i = 0; i < selection->generations_till_eliminaion(); ++i) {
-			std::size_t new_specimens = generation_size_estimation
-			                            * generation_size_estimation
-			                            - generation_size_estimation;
-			if (crossover->does_commute()) new_specimens /= 2;
-			new_specimens *= crossover->default_offspring_amount();
-
-			generation_size_estimation += new_specimens;
+std::size_t constexpr SPECIMENS_ID = 0,
+                      GENERATION_COUNT_ID = 1,
+                      AGE_ID = 2;
+
+// Container of specimens: std::vector by default
+// Could be specialized for some Genome, e.g. with RaggedPopulation from genetics_arena.hpp
+template <typename Genome>
+struct population_traits {
+	using type = std::vector<Genome>;
+};
+
+template <typename Genome>
+using Population = typename population_traits<Genome>::type;
+
+// What fitness, crossover and selection see: Genome const& for std::vector, a view for other containers
+template <typename Genome>
+using SpecimenView = decltype(std::declval<Population<Genome> const&>()[0]);
+
+// Container, which keeps genomes of dropped specimens and gives them back as slots for new ones (see RecyclingPopulation of genetics_arena.hpp)
+template <typename Container, typename Genome>
+concept RecyclingContainer = requires (Container& container) {
+	{ container.recycle() } -> std::same_as<Genome&>;
+};
+
+// Container, which gives a genome of its own to write a new specimen into, and then appends it (see RaggedPopulation of genetics_arena.hpp)
+template <typename Container, typename Genome>
+concept BuildingContainer = requires (Container& container) {
+	{ container.build() } -> std::same_as<Genome&>;
+	container.commit();
+};
+
+template <typename Genome>
+using Generation = std::tuple<Population<Genome>,
+                              std::size_t,
+                              std::optional<std::vector<std::size_t>>>;
+
+template <typename Genome>
+Generation<Genome> new_generation(std::vector<Genome> specimens) {
+	std::size_t const specimens_size = specimens.size();
+	return std::make_tuple(Population<Genome>(std::move(specimens)), 0, std::vector<std::size_t>(specimens_size, 0));
+}
+
+// Moves all specimens of from to the end of to, from stays empty (but keeps capacity)
+template <typename T>
+void splice(std::vector<T>& to, std::vector<T>& from) {
+	std::move(from.begin(), from.end(), std::back_inserter(to));
+	from.clear();
+}
+
+// Specimen of from goes to the end of to; what is left of it in from is unspecified
+template <typename T>
+void move_specimen(std::vector<T>& to, std::vector<T>& from, std::size_t index) {
+	to.emplace_back(std::move(from[index]));
+}
+
+template <typename Cost>
+using GenerationsCosts = std::vector<Cost>;
+
+// Indices of the k best of [0, n) by strict order better, best first
+// Ties must be broken (e.g. by index), so that result does not depend on number of threads
+// Each chunk partitions its own range with nth_element, then only chunk winners are merged and sorted
+template <typename Better>
+std::vector<std::size_t> select_best(std::size_t n, std::size_t k, ThreadPool& pool, Better const& better) {
+	k = std::min(k, n);
+	auto const keep_best = [&better](std::vector<std::size_t>& indices, std::size_t amount) {
+		if (indices.size() > amount) {
+			std::nth_element(indices.begin(), std::next(indices.begin(), amount), indices.end(), better);
+			indices.resize(amount);
 		}
-		return generation_size_estimation;
-	}
+	};
 
-	// modifies generation
-	void compute_crossover(Generation<Genome>& generation, GenerationsCosts<Cost> const& costs) {
-		// Sequential for now, but it should not be heavy
-		// TODO: Redesign for any number of threads
-		// NOTES:
-		//   - Commutative crossover should not use the same specimens twice: use only half of the matrix
-		//   - Default offspring amount controls how many times crossover for this particular pair is called
-		//   - Offspring amount shows how much more offspring should a pair have, if it's fitness is high (close to zero)
-		//   - Each crossover phase must increase age of specimen (because it is used when computing fitness)
-		//     In short? Parents age, when they give birth to offspring
-		std::size_t const default_offspring = crossover->default_offspring_amount();
+	if (k == 0) return {};
 
-		auto& specimens = std::get<SPECIMENS_ID>(generation);
-		auto& ages = std::get<AGE_ID>(generation);
+	// Parallel partitioning pays off only when chunks are much bigger than k
+	std::size_t const chunks = std::max<std::size_t>(1, std::min(pool.size(), n / (4 * k)));
+	std::vector<std::vector<std::size_t>> winners(chunks);
+	pool.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+		std::size_t const first = n * chunk / chunks,
+		                  last = n * (chunk + 1) / chunks;
+		auto& indices = winners[chunk];
+		indices.resize(last - first);
+		std::iota(indices.begin(), indices.end(), first);
+		keep_best(indices, k);
+	});
+
+	std::vector<std::size_t> best = std::move(winners[0]);
+	for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+		best.insert(best.end(), winners[chunk].begin(), winners[chunk].end());
+	}
+	keep_best(best, k);
+	std::sort(best.begin(), best.end(), better);
+	return best;
+}
 
-		std::size_t const specimens_old_size = specimens.size();
+// Indices of the k best costs, best first; ties are broken by index
+template <typename Cost>
+std::vector<std::size_t> select_best(GenerationsCosts<Cost> const& costs, std::size_t k, ThreadPool& pool) {
+	return select_best(costs.size(), k, pool, [&costs](std::size_t one, std::size_t another) {
+		if (costs[one] < costs[another]) return true;
+		if (costs[another] < costs[one]) return false;
+		return one < another;
+	});
+}
 
-		if (ages) {
-			for (std::size_t i = 0; i < ages.value().size(); ++i) {
-				++ages.value()[i];
-			}
+// Sorts with workers: chunks are sorted, then merged pairwise (pairs of one round are merged in parallel too)
+template <typename T, typename Less>
+void parallel_sort(std::vector<T>& items, Less const& less, ThreadPool& pool) {
+	std::size_t const n = items.size(),
+	                  chunks = std::max<std::size_t>(1, std::min(pool.size(), n / 4096));
+	if (chunks == 1) {
+		std::sort(items.begin(), items.end(), less);
+		return;
+	}
+	auto const at = [&items](std::size_t index) { return items.begin() + static_cast<std::ptrdiff_t>(index); };
+	std::vector<std::size_t> bounds(chunks + 1);
+	for (std::size_t chunk = 0; chunk <= chunks; ++chunk) {
+		bounds[chunk] = n * chunk / chunks;
+	}
+	pool.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+		std::sort(at(bounds[chunk]), at(bounds[chunk + 1]), less);
+	});
+	while (bounds.size() > 2) {
+		pool.parallel_for((bounds.size() - 1) / 2, [&](std::size_t pair, std::size_t) {
+			std::inplace_merge(at(bounds[2 * pair]), at(bounds[2 * pair + 1]), at(bounds[2 * pair + 2]), less);
+		});
+		std::vector<std::size_t> merged;
+		for (std::size_t i = 0; i < bounds.size(); i += 2) {
+			merged.push_back(bounds[i]);
 		}
+		if (merged.back() != n) merged.push_back(n);
+		bounds = std::move(merged);
+	}
+}
+
+/*
+ *	Divide and conquer of non_dominated_fronts for three and more objectives (Jensen, 2003; Fortin, Grenier, Parizeau, 2013):
+ *	O(n log^(m - 1) n). Points are distinct and in lexicographic order, so a point is dominated only by points before it;
+ *	splits keep that order. fronts are raised, never lowered: front of a point is one more than fronts of its dominators.
+ */
+class ParetoFronts {
+public:
+	ParetoFronts(std::span<double const> values, std::size_t m, std::vector<std::size_t>& fronts)
+	  : values(values), m(m), fronts(fronts) { }
 
-		for (std::size_t i = 0; i < specimens_old_size; ++i) {
-			std::size_t starting_specimen = crossover->does_commute() ? 0 : i+1;
+	void sort(std::vector<std::size_t> const& points) { sort_within(points, m - 1); }
 
-			for (std::size_t j = i+1; j < specimens_old_size; ++j) {
-				if (i == j) continue;
+private:
+	std::span<double const> values;
+	std::size_t m;
+	std::vector<std::size_t>& fronts;
 
-				std::size_t const current_offspring_amount = crossover->offspring_amount(generation, costs, i, j) * default_offspring;
+	double value(std::size_t point, std::size_t objective) const { return values[point * m + objective]; }
 
-				for (std::size_t count = 0; count < current_offspring_amount; ++count) {
-					specimens.emplace_back(crossover->cross(generation, costs, i, j)); // One cannot be sure if Genome is heavy or not
-					if (ages) {
-						ages.value().emplace_back(0);
-					}
+	// Below that many comparisons pairs are simply compared
+	static std::size_t constexpr brute_force_pairs = 1024;
+
+	void raise(std::size_t point, std::size_t dominator) { fronts[point] = std::max(fronts[point], fronts[dominator] + 1); }
+
+	bool dominates(std::size_t one, std::size_t another, std::size_t k) const {
+		for (std::size_t j = 0; j <= k; ++j) {
+			if (value(another, j) < value(one, j)) return false;
+		}
+		return true;
+	}
+
+	// Points are equal in objectives after k; they are compared in objectives up to k
+	void sort_within(std::vector<std::size_t> const& points, std::size_t k) {
+		if (points.size() < 2) return;
+		if (points.size() * points.size() <= 2 * brute_force_pairs) {
+			for (std::size_t i = 1; i < points.size(); ++i) {
+				for (std::size_t dominator = 0; dominator < i; ++dominator) {
+					if (dominates(points[dominator], points[i], k)) raise(points[i], points[dominator]);
 				}
 			}
+			return;
+		}
+		if (k == 1) {
+			sweep(points, points);
+			return;
 		}
+		auto const threshold = split(points, {}, k);
+		if (!threshold) {
+			sort_within(points, k - 1);
+			return;
+		}
+		auto const [lower, upper] = partition(points, threshold.value(), k);
+		sort_within(lower, k);
+		// lower points are not worse in objective k, and upper ones can't dominate them
+		sort_between(lower, upper, k - 1);
+		sort_within(upper, k);
 	}
 
-	// modifies costs
-	// Sequential! User MUST add parallelization here by himself.
-	// It's the most heavy function of all, but it depends on all specimens at once
-	// thus, it's not possible to parallelize this in framework
-	void compute_fitness(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) {
-		costs.resize(0);
-		fitness->cost(generation, costs);
+	// Fronts of lower points are final; each of them is not worse than each upper one in objectives after k
+	void sort_between(std::vector<std::size_t> const& lower, std::vector<std::size_t> const& upper, std::size_t k) {
+		if (lower.empty() || upper.empty()) return;
+		if (lower.size() * upper.size() <= brute_force_pairs) {
+			for (std::size_t point : upper) {
+				for (std::size_t dominator : lower) {
+					if (dominates(dominator, point, k)) raise(point, dominator);
+				}
+			}
+			return;
+		}
+		if (k == 1) {
+			sweep(lower, upper);
+			return;
+		}
+
+		auto const [lower_min, lower_max] = std::minmax_element(lower.begin(), lower.end(), [&](std::size_t one, std::size_t another) {
+			return value(one, k) < value(another, k);
+		});
+		auto const [upper_min, upper_max] = std::minmax_element(upper.begin(), upper.end(), [&](std::size_t one, std::size_t another) {
+			return value(one, k) < value(another, k);
+		});
+		if (value(*lower_max, k) <= value(*upper_min, k)) {
+			sort_between(lower, upper, k - 1);
+			return;
+		}
+		if (value(*lower_min, k) > value(*upper_max, k)) return;
+
+		auto const threshold = split(lower, upper, k).value();
+		auto const [lower_best, lower_worst] = partition(lower, threshold, k);
+		auto const [upper_best, upper_worst] = partition(upper, threshold, k);
+		sort_between(lower_best, upper_best, k);
+		sort_between(lower_best, upper_worst, k - 1);
+		sort_between(lower_worst, upper_worst, k);
 	}
 
-	// modifies generation
-	void eliminate_losers(Generation<Genome>& generation, GenerationsCosts<Cost> const& costs) {
-		// Sequential for now, but it should not be heavy
-		// TODO: Redesign for any number of threads
-		// NOTES:
-		//   - All "winners" should be moved/swapped to first positions
-		//   - Then container should be resized to target size
-		auto& specimens = std::get<SPECIMENS_ID>(generation);
-		auto& ages = std::get<AGE_ID>(generation);
+	// Value of objective k and whether it belongs to the better part: split into two nonempty parts, as even as possible
+	std::optional<std::pair<double, bool>> split(std::vector<std::size_t> const& one, std::vector<std::size_t> const& another, std::size_t k) const {
+		std::vector<double> objective;
+		objective.reserve(one.size() + another.size());
+		for (std::size_t point : one) objective.push_back(value(point, k));
+		for (std::size_t point : another) objective.push_back(value(point, k));
+		std::size_t const n = objective.size();
+		std::nth_element(objective.begin(), objective.begin() + static_cast<std::ptrdiff_t>(n / 2), objective.end());
+		double const median = objective[n / 2];
 
-		auto&& sort_permutation = sort_to_permutation(costs, [](Cost const& one, Cost const& another) { return one < another; });
+		std::size_t const less = static_cast<std::size_t>(std::count_if(objective.begin(), objective.end(), [median](double x) { return x < median; })),
+		                  not_greater = static_cast<std::size_t>(std::count_if(objective.begin(), objective.end(), [median](double x) { return x <= median; }));
+		auto const imbalance = [n](std::size_t better) { return better > n - better ? 2 * better - n : n - 2 * better; };
+		bool const with_median = not_greater < n, without_median = less > 0;
+		if (!with_median && !without_median) return std::nullopt;
+		return std::pair(median, with_median && (!without_median || imbalance(not_greater) <= imbalance(less)));
+	}
 
-		apply_permutation_in_place(specimens, sort_permutation);
-		if (specimens.size() > selection->survivors()) {
-			specimens.resize(selection->survivors());
+	std::pair<std::vector<std::size_t>, std::vector<std::size_t>> partition(std::vector<std::size_t> const& points,
+	                                                                      std::pair<double, bool> threshold, std::size_t k) const {
+		std::vector<std::size_t> better, worse;
+		for (std::size_t point : points) {
+			bool const is_better = threshold.second ? value(point, k) <= threshold.first : value(point, k) < threshold.first;
+			(is_better ? better : worse).push_back(point);
 		}
-		if (ages) {
-			apply_permutation_in_place(ages.value(), sort_permutation);
-			if (ages.value().size() > selection->survivors()) {
-				ages.value().resize(selection->survivors());
+		return {std::move(better), std::move(worse)};
+	}
+
+	// First two objectives: lower points are met in order of the first one, before upper points with the same value,
+	// and prefix maximum of their fronts over the second one is kept in a Fenwick tree. With lower == upper, it is one sweep
+	void sweep(std::vector<std::size_t> const& lower, std::vector<std::size_t> const& upper) {
+		std::vector<double> keys;
+		keys.reserve(lower.size());
+		for (std::size_t point : lower) keys.push_back(value(point, 1));
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		std::vector<std::size_t> tree(keys.size() + 1, 0); // front + 1, 0 is none
+		auto const not_greater = [&keys](double key) { return static_cast<std::size_t>(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin()); };
+		auto const insert = [&](std::size_t point) {
+			for (std::size_t i = not_greater(value(point, 1)); i <= keys.size(); i += i & (~i + 1)) {
+				tree[i] = std::max(tree[i], fronts[point] + 1);
+			}
+		};
+		auto const query = [&](std::size_t point) {
+			std::size_t best = 0;
+			for (std::size_t i = not_greater(value(point, 1)); i > 0; i -= i & (~i + 1)) {
+				best = std::max(best, tree[i]);
+			}
+			if (best) fronts[point] = std::max(fronts[point], best);
+		};
+
+		if (&lower == &upper) {
+			for (std::size_t point : lower) {
+				query(point);
+				insert(point);
+			}
+			return;
+		}
+		std::size_t i = 0;
+		for (std::size_t point : upper) {
+			for (; i < lower.size() && value(lower[i], 0) <= value(point, 0); ++i) {
+				insert(lower[i]);
 			}
+			query(point);
 		}
 	}
 };
 
+/*
+ *	Pareto front of each of n points with m objectives (values[i * m + j], all minimized); front 0 is non-dominated,
+ *	front k + 1 is dominated only by fronts up to k. Equal points are in the same front.
+ *	Points are sorted lexicographically (in parallel), equal ones are merged; then up to two objectives it is a sweep in O(n log n),
+ *	with least second objective of each front kept and binary searched, and with more objectives it is divide and conquer
+ *	of ParetoFronts, O(n log^(m - 1) n) instead of O(m n^2) of pairwise comparisons.
+ */
+inline std::vector<std::size_t> non_dominated_fronts(std::span<double const> values, std::size_t m, ThreadPool& pool) {
+	std::size_t const n = m ? values.size() / m : 0;
+	std::vector<std::size_t> fronts(n, 0);
+	if (n == 0) return fronts;
+	auto const value = [&values, m](std::size_t point, std::size_t objective) { return values[point * m + objective]; };
+
+	std::vector<std::size_t> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	parallel_sort(order, [&](std::size_t one, std::size_t another) {
+		for (std::size_t j = 0; j < m; ++j) {
+			if (value(one, j) != value(another, j)) return value(one, j) < value(another, j);
+		}
+		return one < another;
+	}, pool);
+	auto const same = [&](std::size_t one, std::size_t another) {
+		for (std::size_t j = 0; j < m; ++j) {
+			if (value(one, j) != value(another, j)) return false;
+		}
+		return true;
+	};
+	std::vector<std::size_t> distinct;
+	distinct.reserve(n);
+	for (std::size_t k = 0; k < n; ++k) {
+		if (k == 0 || !same(order[k - 1], order[k])) distinct.push_back(order[k]);
+	}
+
+	if (m <= 2) {
+		// Every point before is not worse in the first objective, so it dominates, if it is not worse in the second one either
+		auto const second = [&](std::size_t point) { return m == 2 ? value(point, 1) : 0.0; };
+		std::vector<double> least_second; // of each front, non-decreasing
+		for (std::size_t point : distinct) {
+			auto const front = std::upper_bound(least_second.begin(), least_second.end(), second(point));
+			fronts[point] = static_cast<std::size_t>(front - least_second.begin());
+			if (front == least_second.end()) {
+				least_second.push_back(second(point));
+			} else {
+				*front = second(point);
+			}
+		}
+	} else {
+		ParetoFronts(values, m, fronts).sort(distinct);
+	}
+
+	for (std::size_t k = 1; k < n; ++k) {
+		if (same(order[k - 1], order[k])) fronts[order[k]] = fronts[order[k - 1]];
+	}
+	return fronts;
+}
+
+/*
+ *	Crowding distance (as in NSGA-II) of points of fronts up to last_front, within their front: sum over objectives
+ *	of the gap between neighbours, normalized by the range of the front; extreme points get infinity.
+ *	Points of later fronts get 0. Fronts are processed in parallel.
+ */
+inline std::vector<double> crowding_distances(std::span<double const> values, std::size_t m, std::vector<std::size_t> const& fronts,
+                                              std::size_t last_front, ThreadPool& pool) {
+	std::size_t const n = fronts.size();
+	std::vector<double> distances(n, 0.0);
+	std::vector<std::vector<std::size_t>> members(last_front + 1);
+	for (std::size_t point = 0; point < n; ++point) {
+		if (fronts[point] <= last_front) members[fronts[point]].push_back(point);
+	}
+
+	pool.parallel_for(members.size(), [&](std::size_t front, std::size_t) {
+		auto& points = members[front];
+		for (std::size_t j = 0; j < m; ++j) {
+			auto const value = [&values, m, j](std::size_t point) { return values[point * m + j]; };
+			std::sort(points.begin(), points.end(), [&](std::size_t one, std::size_t another) {
+				return value(one) != value(another) ? value(one) < value(another) : one < another;
+			});
+			double const range = points.empty() ? 0.0 : value(points.back()) - value(points.front());
+			for (std::size_t k = 0; k < points.size(); ++k) {
+				if (k == 0 || k + 1 == points.size() || !(range > 0)) {
+					distances[points[k]] = std::numeric_limits<double>::infinity();
+				} else {
+					distances[points[k]] += (value(points[k + 1]) - value(points[k - 1])) / range;
+				}
+			}
+		}
+	});
+	return distances;
+}
+
+/*
+ *	Worst of the k best costs offered so far, shared by workers of bounded fitness: they offer costs in portions
+ *	and get back the new cutoff. It only gets better, and it's never better than the final k-th best cost.
+ */
+template <typename Cost>
+class CostThreshold {
+public:
+	explicit CostThreshold(std::size_t k) : k(k) {
+		best.reserve(k);
+	}
+
+	std::optional<Cost> offer(std::span<Cost const> costs) {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto const& cost : costs) {
+			if (best.size() < k) {
+				best.push_back(cost);
+				std::push_heap(best.begin(), best.end());
+			} else if (k > 0 && cost < best.front()) {
+				std::pop_heap(best.begin(), best.end());
+				best.back() = cost;
+				std::push_heap(best.begin(), best.end());
+			}
+		}
+		return current();
+	}
+
+	std::optional<Cost> cutoff() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return current();
+	}
+
+private:
+	std::size_t k;
+	std::vector<Cost> best; // heap with the worst on top
+	mutable std::mutex mutex;
+
+	std::optional<Cost> current() const {
+		if (k == 0 || best.size() < k) return std::nullopt;
+		return best.front();
+	}
+};
+
+/*
+ *	Moves chosen elements to the front of containers (i-th chosen goes to position i) and drops the rest.
+ *	Only chosen elements are touched: first they are moved forward in order of their positions
+ *	(target is never after source, so nothing chosen is overwritten), then the small front region
+ *	is permuted into requested order.
+ */
+class Compaction {
+public:
+	explicit Compaction(std::vector<std::size_t> const& chosen)
+	  : chosen(chosen), by_position(chosen.size()), ranks(chosen.size()) {
+		std::iota(by_position.begin(), by_position.end(), 0);
+		std::sort(by_position.begin(), by_position.end(),
+		          [&chosen](std::size_t one, std::size_t another) { return chosen[one] < chosen[another]; });
+		sources.resize(chosen.size());
+		for (std::size_t place = 0; place < chosen.size(); ++place) {
+			sources[place] = chosen[by_position[place]];
+			ranks[place] = by_position[place];
+		}
+	}
+
+	// Containers could do it their own way (e.g. RaggedPopulation copies chosen into a spare buffer in one pass)
+	template <typename Container>
+	requires requires (Container& container, std::vector<std::size_t> const& chosen) { container.compact(chosen); }
+	void apply(Container& container) const {
+		container.compact(chosen);
+	}
+
+	template <typename T>
+	void apply(std::vector<T>& vec) const {
+		for (std::size_t place = 0; place < sources.size(); ++place) {
+			if (sources[place] != place) {
+				vec[place] = std::move(vec[sources[place]]);
+			}
+		}
+		vec.resize(sources.size());
+		apply_permutation_in_place(vec, ranks);
+	}
+
+private:
+	std::vector<std::size_t> chosen, by_position, ranks, sources;
+};
+
+template <typename Genome, typename Cost>
+class IFitness {
+public:
+	virtual ~IFitness() = default;
+
+	// All-at-once computation, because from framework POV it parallelizes poorly
+	// Also, must be computed "in place": the most complicated part for framework user
+	// Framework guarantees that size of costs will be 0, and it's capacity will be somewhat close to optimal
+	// With incremental(), costs of first costs.size() specimens are already known (survivors of previous elimination),
+	// and only the rest must be appended (costs may also be cleared and computed anew, if cost depends on the whole generation)
+	// Either way, there must be exactly one cost per specimen after the call
+	virtual void cost(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) = 0;
+
+	// Does cost keep known costs and append the rest? Otherwise costs are empty before every call
+	virtual bool incremental() const { return false; }
+
+	// Does cost change when specimen gets older? Then known costs are never reused: costs will always be empty
+	virtual bool depends_on_age() const { return false; }
+};
+
+/*
+ *	Cost of each specimen does not depend on other specimens.
+ *	Framework computes costs of new specimens in parallel chunks and writes them straight into GenerationsCosts,
+ *	so cost must be thread-safe and Cost must be default constructible.
+ *	Age is 0, if generation does not track ages.
+ */
+template <typename Genome, typename Cost>
+class IPointwiseFitness {
+public:
+	virtual ~IPointwiseFitness() = default;
+
+	virtual Cost cost(SpecimenView<Genome> specimen, std::size_t age) const = 0;
+
+	// Batched fitness: costs of specimens [first, last) go to costs[first, last) (costs are already resized)
+	// One call per chunk of the parallel loop, so that a fitness could evaluate several specimens at once (e.g. with SIMD);
+	// called concurrently for disjoint ranges. By default it just calls cost
+	virtual void cost_batch(Population<Genome> const& specimens, std::optional<std::vector<std::size_t>> const& ages,
+	                        std::size_t first, std::size_t last, GenerationsCosts<Cost>& costs) const {
+		for (std::size_t i = first; i < last; ++i) {
+			costs[i] = cost(specimens[i], ages ? ages.value()[i] : 0);
+		}
+	}
+
+	// Does cost change when specimen gets older? Then known costs are never reused
+	virtual bool depends_on_age() const { return false; }
+
+	// Bounded evaluation, used if is_bounded(): in eliminating generations cutoff is the worst of survivors() best costs met so far,
+	// and fitness may stop, as soon as its partial cost is worse than cutoff (cutoff < partial), returning partial cost.
+	// Partial costs must only grow as evaluation goes on; then survivors and their costs are the same as with full evaluation.
+	// Called concurrently, and instead of cost_batch
+	virtual bool is_bounded() const { return false; }
+	virtual Cost bounded_cost(SpecimenView<Genome> specimen, std::size_t age, Cost const& cutoff) const { return cost(specimen, age); }
+};
+
+// Pair of parents and amount of their offspring
+struct Mating {
+	std::size_t parent1, parent2;
+	std::size_t count;
+	std::size_t pair; // Index of pair in generation: random stream of k-th offspring is streams.stream(pair, k)
+};
+
+/*
+ *	Could be controlled by Genome class.
+ *	Must be *very* fast: it is called for every offspring.
+ *	With several threads in Environment, offspring_amount and cross are called concurrently.
+ */
+template <typename Genome, typename Cost>
+class ICrossover {
+public:
+	virtual ~ICrossover() = default;
+
+	virtual bool does_commute() const = 0; // Is crossover symmetric? If not, each pair mates both ways (asked once, by constructor of environment)
+	virtual std::size_t default_offspring_amount() const { return 1; } // How much offspring should a pair have by default?
+
+	// How to scale offspring amount due to high fitness? - This is a must, if one wants to implement specimen aging
+	//     ...after all, this is how real evolution works
+	virtual std::size_t offspring_amount(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2) { return 1; }
+	// Is offspring_amount always 1? Then it is not called at all
+	virtual bool fixed_offspring_amount() const { return false; }
+
+	// What mutations will offspring have? Probably this should be decided/done by crossover operation
+	
+	// random is the stream of this particular offspring: same seed, generation, pair and offspring index give the same numbers
+	virtual Genome cross(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2, RandomStream& random) = 0;
+
+	// The same offspring, written over an existing genome: with a recycling population (e.g. RecyclingPopulation of genetics_arena.hpp)
+	// it is a dropped specimen, with RaggedPopulation it is the genome, which every offspring is built in;
+	// its memory could be reused (e.g. with assign or resize instead of a new vector).
+	// Must give the same offspring, as cross; by default offspring is assigned what cross gives
+	virtual void cross_into(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2,
+	                        RandomStream& random, Genome& offspring) {
+		offspring = cross(generation, costs, parent1, parent2, random);
+	}
+
+	// Batched crossover: one call per block of matings instead of one per offspring
+	// Offspring of all matings must be appended to offspring in the same order, as cross would give them;
+	// capacity of offspring is already reserved, so they could be constructed in place
+	// By default it just calls cross (or cross_into, if population recycles or builds specimens)
+	virtual void cross_batch(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::span<Mating const> matings,
+	                         RandomStreams const& streams, Population<Genome>& offspring) {
+		for (auto const& mating : matings) {
+			for (std::size_t count = 0; count < mating.count; ++count) {
+				RandomStream random = streams.stream(mating.pair, count);
+				if constexpr (RecyclingContainer<Population<Genome>, Genome>) {
+					cross_into(generation, costs, mating.parent1, mating.parent2, random, offspring.recycle());
+				} else if constexpr (BuildingContainer<Population<Genome>, Genome>) {
+					cross_into(generation, costs, mating.parent1, mating.parent2, random, offspring.build());
+					offspring.commit();
+				} else {
+					offspring.emplace_back(cross(generation, costs, mating.parent1, mating.parent2, random)); // One cannot be sure if Genome is heavy or not
+				}
+			}
+		}
+	}
+};
+
+/*
+ *	Who mates with whom in a generation.
+ *	Matings are numbered, and any range of them could be asked for (by crossover chunks and batches, concurrently),
+ *	so parents of k-th mating must depend only on k and on what schedule() has seen: random is random.stream(k, 0).
+ *	Crossover and offspring_amount are then called for each mating, as for a pair of all-pairs crossover.
+ *	Scheduler keeps state of current generation, so one scheduler is for one environment.
+ */
+template <typename Genome, typename Cost>
+class IMatingScheduler {
+public:
+	virtual ~IMatingScheduler() = default;
+
+	// Called before crossover of each generation; returns number of matings
+	virtual std::size_t schedule(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs) = 0;
+
+	// Appends matings [first, last) in order, with count 1 and pair k (count is then set by environment)
+	virtual void matings(std::size_t first, std::size_t last, RandomStreams const& random, std::vector<Mating>& out) const = 0;
+
+	// Number of matings for generation of given size, to reserve memory
+	virtual std::size_t expected_matings(std::size_t specimens) const = 0;
+
+	// Does schedule look at costs? Then costs of all specimens are computed before every crossover,
+	// not only at elimination (with generations_till_eliminaion() == 1 they are known anyway)
+	virtual bool needs_costs() const { return false; }
+};
+
+/*
+ *	Default scheduler: every pair (i < j) mates, row by row over the upper triangle.
+ *	Ordered one is for crossover, which does not commute: each pair mates both ways, (i, j) and then (j, i).
+ *	Offspring grow as survivors ^ 2; see genetics_mating.hpp for schedulers with fixed budget.
+ */
+template <typename Genome, typename Cost>
+class AllPairsMating : public IMatingScheduler<Genome, Cost> {
+public:
+	explicit AllPairsMating(bool ordered = false) : ordered(ordered) { }
+	~AllPairsMating() override = default;
+
+	std::size_t schedule(Generation<Genome> const& generation, GenerationsCosts<Cost> const&) override {
+		specimens = std::get<SPECIMENS_ID>(generation).size();
+		return pairs_amount(specimens) * ways();
+	}
+
+	void matings(std::size_t first, std::size_t last, RandomStreams const&, std::vector<Mating>& out) const override {
+		if (first >= last) return;
+		auto [i, j] = unrank_pair(first / ways(), specimens);
+		for (std::size_t pair = first; pair < last; ++pair) {
+			bool const reversed = pair % ways() == 1;
+			out.push_back(reversed ? Mating{j, i, 1, pair} : Mating{i, j, 1, pair});
+			if (pair % ways() != ways() - 1) continue;
+			if (++j == specimens) {
+				++i;
+				j = i + 1;
+			}
+		}
+	}
+
+	// Saturates instead of overflow
+	std::size_t expected_matings(std::size_t specimens) const override {
+		return specimens >> 32 ? std::numeric_limits<std::size_t>::max() : pairs_amount(specimens) * ways();
+	}
+
+private:
+	bool ordered;
+	std::size_t specimens = 0;
+
+	std::size_t ways() const { return ordered ? 2 : 1; }
+};
+
+template <typename Genome, typename Cost>
+class ISelection {
+public:
+	virtual ~ISelection() = default;
+
+	// Number of specimens selected from each generation.
+	virtual std::size_t survivors() const = 0;
+
+	// Check for some specimen with good enough fitness
+	virtual bool is_good_enough(SpecimenView<Genome> specimen, Cost const& cost) { return false; }
+	
+	// Limit of generations for one evolve call
+	virtual std::optional<std::size_t> max_generations() const { return std::nullopt; }
+
+	// Selection will be performed only every generations_till_eliminaion generations
+	virtual std::size_t generations_till_eliminaion() const { return 1; }
+};
+
+// What happened in one generation of evolve
+// In streaming and pipeline modes crossover, fitness and selection of offspring overlap, so their time is elimination_seconds
+template <typename Cost>
+struct GenerationStatistics {
+	std::size_t generation = 0; // generation count after it
+	bool eliminating = false;
+
+	double crossover_seconds = 0, fitness_seconds = 0, elimination_seconds = 0;
+	std::size_t offspring = 0;
+	double offspring_per_second = 0; // over the whole generation
+
+	std::size_t peak_specimens = 0; // most specimens stored at once (offspring of pipeline and streaming batches included)
+	std::size_t capacity = 0;       // of generation's container then
+	std::size_t reserved_bytes = 0; // estimation of evolve call for its generations, see compute_approximate_size_of_generation_container
+
+	// Costs of survivors, in eliminating generations only
+	std::optional<Cost> best, median, worst;
+};
+
+// Receives statistics after every generation; Environment without observer does not collect them
+template <typename Cost>
+class IObserver {
+public:
+	virtual ~IObserver() = default;
+
+	virtual void generation_done(GenerationStatistics<Cost> const& statistics) = 0;
+};
+
+/*
+ *	Similarity of specimens for elimination with niches (clearing): only niche_capacity() best specimens of each niche
+ *	survive on their own merit, others of the niche are taken only if there are not enough survivors without them.
+ *	Specimens are in the same niche when their feature vectors fall into the same cell of side niche_radius():
+ *	cells are cut in feature space itself, if there are few features, or in its projection onto a few random directions
+ *	(locality-sensitive hashing), if there are many. So niches cost O(n) per generation instead of O(n ^ 2) distances,
+ *	and features are computed in parallel. Close specimens may still fall into neighbouring cells.
+ */
+template <typename Genome, typename Cost>
+class ISimilarity {
+public:
+	virtual ~ISimilarity() = default;
+
+	// Length of feature vectors
+	virtual std::size_t dimensions() const = 0;
+
+	// Writes dimensions() features of specimen; called concurrently
+	virtual void features(SpecimenView<Genome> specimen, std::span<float> out) const = 0;
+
+	virtual float niche_radius() const = 0;
+	virtual std::size_t niche_capacity() const { return 1; }
+};
+
+/*
+ *	Objectives of multi-objective (Pareto) elimination, all minimized: survivors are taken front by front
+ *	of non-dominated sorting, and from the last front that does not fit whole, by crowding distance, as in NSGA-II.
+ *	Then operator< of Cost is not used by elimination; the first survivor is of the first front, extreme in some objective, but not the best one:
+ *	is_good_enough of selection is asked for every survivor of the first front, and statistics rank costs of survivors by operator< of Cost.
+ */
+template <typename Cost>
+class IObjectives {
+public:
+	virtual ~IObjectives() = default;
+
+	virtual std::size_t objectives() const = 0;
+
+	// Writes objectives() values of cost; called concurrently
+	virtual void values(Cost const& cost, std::span<double> out) const = 0;
+};
+
+/*
+ *	Policies of BasicEnvironment.
+ *	Virtual interfaces above satisfy them, but so does any class with the same member functions:
+ *	then calls are direct and could be inlined (see StaticEnvironment).
+ *	Only the required parts are listed; the rest (offspring_amount, max_generations, ...) are used if present.
+ */
+template <typename Fitness, typename Genome, typename Cost>
+concept GenerationFitness = requires (Fitness& fitness, Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) {
+	fitness.cost(generation, costs);
+};
+
+template <typename Fitness, typename Genome, typename Cost>
+concept PointwiseFitness = requires (Fitness const& fitness, SpecimenView<Genome> specimen, std::size_t age) {
+	{ fitness.cost(specimen, age) } -> std::convertible_to<Cost>;
+};
+
+template <typename Fitness, typename Genome, typename Cost>
+concept FitnessPolicy = GenerationFitness<Fitness, Genome, Cost> || PointwiseFitness<Fitness, Genome, Cost>;
+
+template <typename Crossover, typename Genome, typename Cost>
+concept CrossoverPolicy = requires (Crossover& crossover, Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs,
+                                   std::size_t parent, RandomStream& random) {
+	{ crossover.does_commute() } -> std::convertible_to<bool>;
+	{ crossover.cross(generation, costs, parent, parent, random) } -> std::convertible_to<Genome>;
+};
+
+template <typename Selection, typename Genome, typename Cost>
+concept SelectionPolicy = requires (Selection const& selection) {
+	{ selection.survivors() } -> std::convertible_to<std::size_t>;
+};
+
+// Fitness of Environment: whole-generation or pointwise one, chosen at run time
+template <typename Genome, typename Cost>
+class DynamicFitness {
+public:
+	DynamicFitness(std::shared_ptr<IFitness<Genome, Cost>> fitness, std::shared_ptr<IPointwiseFitness<Genome, Cost>> pointwise_fitness)
+	  : fitness(fitness), pointwise_fitness(pointwise_fitness) { }
+
+	bool is_pointwise() const { return static_cast<bool>(pointwise_fitness); }
+
+	void cost(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) { fitness->cost(generation, costs); }
+	Cost cost(SpecimenView<Genome> specimen, std::size_t age) const { return pointwise_fitness->cost(specimen, age); }
+	void cost_batch(Population<Genome> const& specimens, std::optional<std::vector<std::size_t>> const& ages,
+	                std::size_t first, std::size_t last, GenerationsCosts<Cost>& costs) const {
+		pointwise_fitness->cost_batch(specimens, ages, first, last, costs);
+	}
+
+	bool incremental() const { return fitness && fitness->incremental(); }
+	bool depends_on_age() const { return pointwise_fitness ? pointwise_fitness->depends_on_age() : fitness->depends_on_age(); }
+
+	bool is_bounded() const { return pointwise_fitness && pointwise_fitness->is_bounded(); }
+	Cost bounded_cost(SpecimenView<Genome> specimen, std::size_t age, Cost const& cutoff) const {
+		return pointwise_fitness->bounded_cost(specimen, age, cutoff);
+	}
+
+private:
+	std::shared_ptr<IFitness<Genome, Cost>> fitness;
+	std::shared_ptr<IPointwiseFitness<Genome, Cost>> pointwise_fitness;
+};
+
+/*
+ *	Evolution engine over arbitrary policies; use Environment (virtual interfaces) or StaticEnvironment (concrete classes).
+ */
+template <typename Genome, typename Cost, typename Fitness, typename Crossover, typename Selection>
+requires FitnessPolicy<Fitness, Genome, Cost> && CrossoverPolicy<Crossover, Genome, Cost> && SelectionPolicy<Selection, Genome, Cost>
+class BasicEnvironment {
+public:
+	using genome_type = Genome;
+	using cost_type = Cost;
+
+	BasicEnvironment(std::shared_ptr<Fitness> fitness,
+	                 std::shared_ptr<Crossover> crossover,
+	                 std::shared_ptr<Selection> selection,
+	                 std::size_t number_of_threads = 1,
+	                 std::optional<std::uint64_t> seed = std::nullopt)
+	  : fitness(fitness)
+	  , crossover(crossover)
+	  , selection(selection)
+	  , number_of_threads(number_of_threads)
+	  , pool(number_of_threads)
+	  , run_seed(seed ? seed.value() : random_seed()) { }
+
+	// Same seed and same initial generation give the same result, regardless of number of threads
+	std::uint64_t seed() const { return run_seed; }
+
+	// Of selection policy, or defaults
+	std::size_t generations_till_elimination() const {
+		if constexpr (requires (Selection const& s) { s.generations_till_eliminaion(); }) {
+			return selection->generations_till_eliminaion();
+		} else {
+			return 1;
+		}
+	}
+
+	std::optional<std::size_t> max_generations() const {
+		if constexpr (requires (Selection const& s) { s.max_generations(); }) {
+			return selection->max_generations();
+		} else {
+			return std::nullopt;
+		}
+	}
+
+	// Opt-in streaming mode: eliminating generation is crossed, scored and selected in batches of about batch_size offspring,
+	// and offspring are kept only while they are among survivors() best.
+	// Peak memory is bounded by the last generation before elimination plus one batch
+	// (survivors + batch with generations_till_eliminaion() == 1), instead of all offspring at once.
+	// Fitness is called for each batch as for a separate generation, so costs must not depend on other specimens.
+	// Result is the same as without streaming.
+	void set_streaming_batch(std::optional<std::size_t> batch_size) { streaming_batch = batch_size; }
+
+	// Opt-in pipeline for eliminating generation: offspring are crossed in batches of about batch_size on a separate thread
+	// (by crossover_threads workers), scored by fitness on this one while next batch is crossed, and gathered on a third thread;
+	// selection runs when all batches are in. In streaming mode its batches go through the same pipeline.
+	// As in streaming mode, fitness is called for each batch as for a separate generation. Result is the same as without pipeline.
+	void set_pipeline(std::optional<std::size_t> batch_size, std::size_t crossover_threads = 1) {
+		pipeline_batch = batch_size;
+		pipeline_pool = batch_size ? std::make_unique<ThreadPool>(crossover_threads) : nullptr;
+	}
+
+	// How many specimens one task of pointwise fitness has; by default there are several tasks per thread.
+	// Smaller grain balances better (idle threads steal tasks), bigger one has less overhead.
+	void set_fitness_grain_size(std::optional<std::size_t> grain_size) { fitness_grain_size = grain_size; }
+
+	// Statistics of every generation go there; nullptr (default) turns them off, and then nothing is measured
+	void set_observer(std::shared_ptr<IObserver<Cost>> new_observer) { observer = new_observer; }
+
+	// Opt-in limit of memory for specimens, their costs and ages, in bytes (estimated with sizeof: heap memory of genomes is not counted).
+	// When generations till elimination are projected to need more, eliminating generation is streamed
+	// (as with set_streaming_batch, in batches that fit into the rest of the budget, unless streaming batch is set explicitly).
+	// If generations before it alone need more, population spills into a scratch file in scratch_directory (temporary directory by default);
+	// population must be able to do it (e.g. SpillablePopulation of genetics_spill.hpp), otherwise advance throws std::length_error
+	// before anything is allocated. Either way nothing reserves more than the budget up front. Result is the same as without budget.
+	// Trivially copyable genomes spill with SpillablePopulation, and sequence genomes with SpillableRaggedPopulation; others can't.
+	void set_memory_budget(std::optional<std::size_t> bytes, std::string scratch_directory = "") {
+		memory_budget = bytes;
+		this->scratch_directory = std::move(scratch_directory);
+	}
+
+	// Elimination with niches, see ISimilarity; nullptr (default) turns it off.
+	// Niches need the whole eliminating generation, so with similarity it is not streamed (and memory budget can only spill it)
+	void set_similarity(std::shared_ptr<ISimilarity<Genome, Cost>> new_similarity) {
+		similarity = new_similarity;
+		niche_projections.clear();
+	}
+
+	// Multi-objective elimination, see IObjectives; nullptr (default) brings back operator< of Cost.
+	// Fronts need the whole eliminating generation, so with objectives it is not streamed (and memory budget can only spill it).
+	// Works along with similarity: then niches are cleared, and survivors are taken in Pareto order within leaders and the rest
+	void set_objectives(std::shared_ptr<IObjectives<Cost>> new_objectives) { objectives = new_objectives; }
+
+	// Who mates with whom; nullptr brings back the default, all pairs (both ways, if crossover does not commute)
+	void set_mating_scheduler(std::shared_ptr<IMatingScheduler<Genome, Cost>> new_scheduler) {
+		scheduler = new_scheduler ? new_scheduler : default_scheduler();
+	}
+
+	// Main function
+	Generation<Genome> evolve(Generation<Genome> generation) {
+		GenerationsCosts<Cost> costs;
+		return evolve(std::move(generation), costs);
+	}
+
+	// Costs of first costs.size() specimens are known and are not computed again
+	// On return, costs are costs of returned specimens (for those scored after last crossover)
+	// Pass the same costs to the next call to continue evolution without scoring survivors again
+	Generation<Genome> evolve(Generation<Genome> generation, GenerationsCosts<Cost>& costs) {
+		advance(generation, costs);
+		return generation;
+	}
+
+	// Evolves generation in place, for at most given number of generations (and at most max_generations())
+	// Returns true if it has stopped because the best specimen is good enough
+	// Stop request is checked before every generation; then generation and costs are left as after the last one
+	// Costs of all specimens (as left by previous call at elimination) are taken as they are, even if fitness depends on age:
+	// ages change only with crossover, so calls in steps don't score anything again
+	bool advance(Generation<Genome>& generation, GenerationsCosts<Cost>& costs, std::optional<std::size_t> generations = std::nullopt,
+	             std::stop_token stop = {}) {
+		auto& specimens = std::get<SPECIMENS_ID>(generation);
+		auto& generation_count = std::get<GENERATION_COUNT_ID>(generation);
+		auto& ages = std::get<AGE_ID>(generation);
+		assert(costs.size() <= specimens.size());
+		if (generations && generations.value() == 0) {
+			return false;
+		}
+
+		plan_memory(generation);
+
+		// Offspring of eliminating generation are not stored in streaming mode
+		std::size_t const stored_generations = generations_till_elimination() - (streaming_batch_size() ? 1 : 0);
+		std::size_t approximate_size_of_generation_container = compute_approximate_size_of_generation_container(stored_generations);
+		if (memory_budget) {
+			approximate_size_of_generation_container = std::min(approximate_size_of_generation_container,
+			                                                    memory_budget.value() / bytes_per_specimen(generation));
+		}
+
+		specimens.reserve(approximate_size_of_generation_container);
+		if (ages) {
+			ages.value().reserve(approximate_size_of_generation_container);
+		}
+		costs.reserve(approximate_size_of_generation_container);
+		reserved_bytes = approximate_size_of_generation_container * (sizeof(Genome) + sizeof(Cost) + (ages ? sizeof(std::size_t) : 0));
+
+		// Compute costs of unknown specimens
+		if (costs.size() != specimens.size()) {
+			compute_fitness(generation, costs);
+		}
+
+		auto starting_generation = generation_count;
+		auto max_generations = this->max_generations();
+		if (generations) {
+			max_generations = max_generations ? std::min(max_generations.value(), generations.value()) : generations.value();
+		}
+		for (;;) {
+			if (stop.stop_requested()) {
+				return false;
+			}
+			bool const eliminating = (generation_count + 1) % generations_till_elimination() == 0;
+			statistics = GenerationStatistics<Cost>();
+			if (eliminating && streaming_batch_size()) {
+				timed(statistics.elimination_seconds, [&] { bounded([&] { compute_streaming_elimination(generation, costs); }); });
+				++generation_count;
+			} else if (eliminating && pipeline_batch) {
+				timed(statistics.elimination_seconds, [&] { bounded([&] { compute_pipelined_elimination(generation, costs); }); });
+				++generation_count;
+			} else {
+				if (scheduler->needs_costs()) {
+					timed(statistics.fitness_seconds, [&] { compute_fitness(generation, costs); });
+				}
+				timed(statistics.crossover_seconds, [&] { compute_crossover(generation, costs); });
+				++generation_count;
+				if (eliminating) {
+					timed(statistics.fitness_seconds, [&] { bounded([&] { compute_fitness(generation, costs); }); });
+					timed(statistics.elimination_seconds, [&] { eliminate_losers(generation, costs); });
+				}
+			}
+			if (observer) {
+				report_generation(generation, costs, eliminating);
+			}
+
+			if (eliminating && has_good_enough(generation, costs)) {
+				return true;
+			}
+
+			if (max_generations && (generation_count - starting_generation) >= max_generations.value()) {
+				return false;
+			}
+		}
+	}
+
+private:
+	std::size_t number_of_threads;
+	ThreadPool pool;
+	std::uint64_t run_seed;
+
+	// Default amount of tasks per worker in parallel phases, so that stealing has something to balance
+	static std::size_t constexpr chunks_per_thread = 8;
+	// Offspring of each crossover chunk, kept between generations to reuse capacity
+	std::vector<Population<Genome>> offspring_buffers;
+	// Matings of each crossover chunk are given to crossover in blocks of this size
+	static std::size_t constexpr matings_per_block = 256;
+	std::vector<std::vector<Mating>> mating_buffers;
+
+	std::optional<std::size_t> streaming_batch;
+	Generation<Genome> streaming_generation;
+	Population<Genome> streaming_offspring, streaming_survivors; // admitted by streaming elimination, and the spare buffer of specimens
+
+	std::optional<std::size_t> memory_budget;
+	std::string scratch_directory;
+	// Plan of current advance call for memory budget
+	std::optional<std::size_t> budget_batch;
+	bool spill_specimens = false;
+
+	std::optional<std::size_t> pipeline_batch;
+	// Batches crossed, but not yet scored (and scored, but not yet gathered)
+	static std::size_t constexpr pipeline_depth = 2;
+	// Crossover stage has its own workers and buffers, as it runs along with fitness
+	std::unique_ptr<ThreadPool> pipeline_pool;
+	std::vector<Population<Genome>> pipeline_offspring_buffers;
+	std::vector<std::vector<Mating>> pipeline_mating_buffers;
+
+	std::shared_ptr<IObserver<Cost>> observer;
+	GenerationStatistics<Cost> statistics; // of current generation
+	std::size_t reserved_bytes = 0;
+
+	std::shared_ptr<Fitness> fitness;
+	std::optional<std::size_t> fitness_grain_size;
+	std::shared_ptr<Crossover> crossover;
+	std::shared_ptr<Selection> selection;
+	std::shared_ptr<IMatingScheduler<Genome, Cost>> scheduler = default_scheduler();
+	std::shared_ptr<ISimilarity<Genome, Cost>> similarity;
+	std::vector<float> niche_projections; // directions of hashing and their offsets, fixed for the run
+	std::shared_ptr<IObjectives<Cost>> objectives;
+	std::optional<CostThreshold<Cost>> threshold; // while eliminating generation is scored by bounded fitness
+	std::vector<std::size_t> first_front; // places of survivors of the first front, after elimination with objectives
+
+	// Time of phase, if somebody is watching
+	template <typename Phase>
+	void timed(double& seconds, Phase&& phase) {
+		if (!observer) {
+			phase();
+			return;
+		}
+		auto const start = std::chrono::steady_clock::now();
+		phase();
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Counts are collected by phases, the rest is here
+	void report_generation(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, bool eliminating) {
+		statistics.generation = std::get<GENERATION_COUNT_ID>(generation);
+		statistics.eliminating = eliminating;
+		statistics.reserved_bytes = reserved_bytes;
+		double const seconds = statistics.crossover_seconds + statistics.fitness_seconds + statistics.elimination_seconds;
+		statistics.offspring_per_second = seconds > 0 ? statistics.offspring / seconds : 0;
+		// Survivors are sorted by elimination, unless niches or fronts put them in other order
+		// (first survivor is still the best with niches, but not with fronts: there operator< of Cost ranks them all)
+		if (eliminating && !costs.empty()) {
+			statistics.best = costs.front();
+			if (needs_whole_elimination()) {
+				GenerationsCosts<Cost> ranked(costs);
+				auto const middle = ranked.begin() + static_cast<std::ptrdiff_t>(ranked.size() / 2);
+				std::nth_element(ranked.begin(), middle, ranked.end());
+				if (objectives) statistics.best = *std::min_element(ranked.begin(), middle + 1);
+				statistics.median = *middle;
+				statistics.worst = *std::max_element(middle, ranked.end());
+			} else {
+				statistics.median = costs[costs.size() / 2];
+				statistics.worst = costs.back();
+			}
+		}
+		observer->generation_done(statistics);
+	}
+
+	// Optional parts of policies, with defaults of virtual interfaces
+	// With concrete policies these are resolved at compile time and usually folded into constants
+
+	bool is_good_enough(SpecimenView<Genome> specimen, Cost const& cost) {
+		if constexpr (requires (Selection& s) { s.is_good_enough(specimen, cost); }) {
+			return selection->is_good_enough(specimen, cost);
+		} else {
+			return false;
+		}
+	}
+
+	// First specimen is the best one, after sorting; with objectives, any one of the first front could be
+	bool has_good_enough(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs) {
+		auto const& specimens = std::get<SPECIMENS_ID>(generation);
+		if (!objectives) return is_good_enough(specimens[0], costs[0]);
+		return std::any_of(first_front.begin(), first_front.end(), [&](std::size_t place) { return is_good_enough(specimens[place], costs[place]); });
+	}
+
+	// All pairs, ordered ones for crossover, which does not commute
+	std::shared_ptr<IMatingScheduler<Genome, Cost>> default_scheduler() const {
+		return std::make_shared<AllPairsMating<Genome, Cost>>(!crossover->does_commute());
+	}
+
+	std::size_t default_offspring_amount() const {
+		if constexpr (requires (Crossover const& c) { c.default_offspring_amount(); }) {
+			return crossover->default_offspring_amount();
+		} else {
+			return 1;
+		}
+	}
+
+	bool fixed_offspring_amount() const {
+		if constexpr (requires (Crossover const& c) { c.fixed_offspring_amount(); }) {
+			return crossover->fixed_offspring_amount();
+		} else {
+			return !requires (Crossover& c, Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs) {
+				c.offspring_amount(generation, costs, 0, 0);
+			};
+		}
+	}
+
+	std::size_t offspring_amount(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2) {
+		if constexpr (requires (Crossover& c) { c.offspring_amount(generation, costs, parent1, parent2); }) {
+			return crossover->offspring_amount(generation, costs, parent1, parent2);
+		} else {
+			return 1;
+		}
+	}
+
+	void cross_batch(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::span<Mating const> matings,
+	                 RandomStreams const& streams, Population<Genome>& offspring) {
+		if constexpr (requires (Crossover& c) { c.cross_batch(generation, costs, matings, streams, offspring); }) {
+			crossover->cross_batch(generation, costs, matings, streams, offspring);
+		} else {
+			for (auto const& mating : matings) {
+				for (std::size_t count = 0; count < mating.count; ++count) {
+					RandomStream random = streams.stream(mating.pair, count);
+					auto const cross_into = [&](Genome& child) {
+						if constexpr (requires (Crossover& c) { c.cross_into(generation, costs, mating.parent1, mating.parent2, random, child); }) {
+							crossover->cross_into(generation, costs, mating.parent1, mating.parent2, random, child);
+						} else {
+							child = crossover->cross(generation, costs, mating.parent1, mating.parent2, random);
+						}
+					};
+					if constexpr (RecyclingContainer<Population<Genome>, Genome>) {
+						cross_into(offspring.recycle());
+					} else if constexpr (BuildingContainer<Population<Genome>, Genome>) {
+						cross_into(offspring.build());
+						offspring.commit();
+					} else {
+						offspring.emplace_back(crossover->cross(generation, costs, mating.parent1, mating.parent2, random));
+					}
+				}
+			}
+		}
+	}
+
+	bool pointwise_fitness() const {
+		if constexpr (PointwiseFitness<Fitness, Genome, Cost> && GenerationFitness<Fitness, Genome, Cost>) {
+			return fitness->is_pointwise();
+		} else {
+			return PointwiseFitness<Fitness, Genome, Cost>;
+		}
+	}
+
+	// Top-k elimination by cost, and fitness, which can stop early
+	bool bounded_fitness() const {
+		if (needs_whole_elimination() || !pointwise_fitness()) return false;
+		if constexpr (requires (Fitness const& f) { { f.is_bounded() } -> std::convertible_to<bool>; }) {
+			return fitness->is_bounded();
+		} else {
+			return requires (Fitness const& f, SpecimenView<Genome> specimen, Cost const& cutoff) {
+				{ f.bounded_cost(specimen, std::size_t(0), cutoff) } -> std::convertible_to<Cost>;
+			};
+		}
+	}
+
+	// Scoring of eliminating generation: with bounded fitness, costs are checked against survivors() best ones met in it
+	template <typename Phase>
+	void bounded(Phase&& phase) {
+		if (!bounded_fitness()) {
+			phase();
+			return;
+		}
+		threshold.emplace(selection->survivors());
+		try {
+			phase();
+		} catch (...) {
+			threshold.reset();
+			throw;
+		}
+		threshold.reset();
+	}
+
+	// Whole-generation fitness, which keeps known costs
+	bool incremental_fitness() const {
+		if constexpr (requires (Fitness const& f) { { f.incremental() } -> std::convertible_to<bool>; }) {
+			return fitness->incremental();
+		} else {
+			return false;
+		}
+	}
+
+	bool fitness_depends_on_age() const {
+		if constexpr (requires (Fitness const& f) { f.depends_on_age(); }) {
+			return fitness->depends_on_age();
+		} else {
+			return false;
+		}
+	}
+
+	// Calculate approximate size of generation container (to minimize reallocations)
+	// offspring_amount is not considered, but it should converge to optimal capacity quickly (provided that resize() of vector does not change capacity)
+	std::size_t compute_approximate_size_of_generation_container(std::size_t generations) const {
+		std::size_t generation_size_estimation = selection->survivors();
+
+		// For each generation, when elimination did not occur, we must cumulatively multiply required space
+		// With all pairs (n * (n - 1) / 2 matings, twice that if crossover does not commute) it will be something akin to survivors ^ (2 ^ generations): increases VERY fast
+		// Saturates instead of overflow
+		std::size_t constexpr unbounded = std::numeric_limits<std::size_t>::max();
+		std::size_t const offspring = std::max<std::size_t>(1, default_offspring_amount());
+		for (std::size_t i = 0; i < generations; ++i) {
+			std::size_t const matings = scheduler->expected_matings(generation_size_estimation);
+			if (matings > (unbounded - generation_size_estimation) / offspring) return unbounded;
+			generation_size_estimation += matings * offspring;
+		}
+		return generation_size_estimation;
+	}
+
+	std::size_t bytes_per_specimen(Generation<Genome> const& generation) const {
+		return sizeof(Genome) + sizeof(Cost) + (std::get<AGE_ID>(generation) ? sizeof(std::size_t) : 0);
+	}
+
+	// Niches and fronts can't be found in batches
+	bool needs_whole_elimination() const { return similarity || objectives; }
+
+	// Streaming batch: explicit one, or the one of memory budget
+	std::optional<std::size_t> streaming_batch_size() const {
+		if (needs_whole_elimination()) return std::nullopt;
+		return streaming_batch ? streaming_batch : budget_batch;
+	}
+
+	// How generations till elimination fit into memory budget: eliminating one is streamed, if it does not fit,
+	// and stored ones are spilled, if they don't fit either
+	void plan_memory(Generation<Genome> const& generation) {
+		budget_batch.reset();
+		spill_specimens = false;
+		if (!memory_budget) return;
+
+		std::size_t const budget = memory_budget.value(),
+		                  specimen_bytes = bytes_per_specimen(generation);
+		if (compute_approximate_size_of_generation_container(generations_till_elimination()) <= budget / specimen_bytes) return;
+
+		// Eliminating generation is streamed, unless niches or fronts need it whole
+		std::size_t const stored = compute_approximate_size_of_generation_container(generations_till_elimination() - (needs_whole_elimination() ? 0 : 1));
+		std::size_t stored_bytes = stored > budget / specimen_bytes ? budget : stored * specimen_bytes;
+		if (stored > budget / specimen_bytes) {
+			if constexpr (requires (Population<Genome>& specimens) { specimens.spill(scratch_directory); }) {
+				spill_specimens = true;
+				// Only ages stay in memory
+				std::size_t const age_bytes = std::get<AGE_ID>(generation) ? sizeof(std::size_t) : 0;
+				stored_bytes = age_bytes && stored > budget / age_bytes ? budget : stored * age_bytes;
+			} else {
+				throw std::length_error("Generations till elimination need about " + std::to_string(stored) + " specimens, which is over memory budget, "
+				                        "and population cannot spill to disk (see genetics_spill.hpp)");
+			}
+		}
+		// Batches in pipeline: one in each queue slot and one in each stage
+		std::size_t const batches_in_memory = pipeline_batch ? 2 * pipeline_depth + 3 : 1;
+		budget_batch = std::max<std::size_t>(1, (budget - stored_bytes) / specimen_bytes / batches_in_memory);
+	}
+
+	void spill(Population<Genome>& specimens) {
+		if constexpr (requires { specimens.spill(scratch_directory); }) {
+			specimens.spill(scratch_directory);
+		}
+	}
+
+	// modifies ages: parents age, when they give birth to offspring
+	void age_parents(Generation<Genome>& generation) {
+		auto& ages = std::get<AGE_ID>(generation);
+		if (ages) {
+			for (std::size_t i = 0; i < ages.value().size(); ++i) {
+				++ages.value()[i];
+			}
+		}
+	}
+
+	// Parents are chosen with streams of their own, so that they don't correlate with crossover
+	static std::uint64_t constexpr mating_salt = 0x6d6174696e67; // "mating"
+
+	// Number of matings of the generation; called once per generation, before breed
+	std::size_t schedule_matings(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs) {
+		return scheduler->schedule(generation, costs);
+	}
+
+	// Crosses matings [first_pair, last_pair) into offspring_buffers, returns number of filled buffers
+	// With spill_offspring, buffers are spilled before offspring go into them
+	std::size_t breed(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t first_pair, std::size_t last_pair,
+	                  bool spill_offspring = false) {
+		return breed(generation, costs, first_pair, last_pair, pool, offspring_buffers, mating_buffers, spill_offspring);
+	}
+
+	std::size_t breed(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t first_pair, std::size_t last_pair,
+	                  ThreadPool& workers, std::vector<Population<Genome>>& chunk_offspring, std::vector<std::vector<Mating>>& chunk_matings,
+	                  bool spill_offspring = false) {
+		// NOTES:
+		//   - Matings come from scheduler (all pairs i < j by default, and j < i too, if crossover does not commute); mating k is "pair" k for random streams
+		//   - Default offspring amount controls how many times crossover for this particular pair is called
+		//   - Offspring amount shows how much more offspring should a pair have, if it's fitness is high (close to zero)
+		//   - Matings are cut into chunks; each chunk has its own buffer and buffers are used in chunk order,
+		//     so the order of offspring does not depend on number of threads
+		//   - With more than one thread, crossover (and offspring_amount, and matings of scheduler) are called concurrently
+		//   - Crossover gets pairs in blocks (cross_batch), so that virtual call and growth of buffer are paid once per block
+		std::size_t const default_offspring = default_offspring_amount();
+		bool const fixed_offspring = fixed_offspring_amount();
+		RandomStreams const streams(run_seed, std::get<GENERATION_COUNT_ID>(generation));
+		RandomStreams const mating_streams(run_seed ^ mating_salt, std::get<GENERATION_COUNT_ID>(generation));
+
+		std::size_t const pairs = last_pair - first_pair;
+		std::size_t const chunks = std::min(pairs, workers.size() == 1 ? 1 : workers.size() * chunks_per_thread);
+		if (chunk_offspring.size() < chunks) {
+			chunk_offspring.resize(chunks);
+			chunk_matings.resize(chunks);
+		}
+
+		workers.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+			auto& buffer = chunk_offspring[chunk];
+			auto& matings = chunk_matings[chunk];
+			buffer.clear();
+			if (spill_offspring) {
+				spill(buffer);
+			}
+
+			std::size_t const chunk_first_pair = first_pair + pairs * chunk / chunks,
+			                  chunk_last_pair = first_pair + pairs * (chunk + 1) / chunks;
+
+			for (std::size_t block_first_pair = chunk_first_pair; block_first_pair < chunk_last_pair; block_first_pair += matings_per_block) {
+				std::size_t const block_last_pair = std::min(chunk_last_pair, block_first_pair + matings_per_block);
+				std::size_t block_offspring = 0;
+				matings.clear();
+				scheduler->matings(block_first_pair, block_last_pair, mating_streams, matings);
+				for (auto& mating : matings) {
+					mating.count = fixed_offspring
+					               ? default_offspring
+					               : offspring_amount(generation, costs, mating.parent1, mating.parent2) * default_offspring;
+					block_offspring += mating.count;
+				}
+
+				// Geometric growth, as in push_back
+				if (buffer.size() + block_offspring > buffer.capacity()) {
+					buffer.reserve(std::max(buffer.size() + block_offspring, 2 * buffer.size()));
+				}
+				cross_batch(generation, costs, matings, streams, buffer);
+			}
+		});
+
+		return chunks;
+	}
+
+	// modifies generation
+	void compute_crossover(Generation<Genome>& generation, GenerationsCosts<Cost> const& costs) {
+		auto& specimens = std::get<SPECIMENS_ID>(generation);
+		auto& ages = std::get<AGE_ID>(generation);
+
+		age_parents(generation);
+		if (spill_specimens) {
+			spill(specimens);
+		}
+
+		// All offspring are in buffers at once, so they spill too, and are released, once they are spliced
+		std::size_t const chunks = breed(generation, costs, 0, schedule_matings(generation, costs), spill_specimens);
+
+		std::size_t new_specimens = 0;
+		for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+			new_specimens += offspring_buffers[chunk].size();
+		}
+		specimens.reserve(specimens.size() + new_specimens);
+		for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+			splice(specimens, offspring_buffers[chunk]);
+			if (spill_specimens) {
+				offspring_buffers[chunk] = Population<Genome>();
+			}
+		}
+		if (ages) {
+			ages.value().resize(specimens.size(), 0);
+		}
+
+		statistics.offspring = new_specimens;
+		statistics.peak_specimens = specimens.size();
+		statistics.capacity = specimens.capacity();
+	}
+
+	// Candidate for survival in streaming mode: either already stored specimen (by index) or an offspring
+	struct Candidate {
+		Cost cost;
+		std::size_t sequence; // index, which it would have without streaming
+		std::optional<std::size_t> offspring; // in streaming_offspring
+		std::size_t age;
+	};
+
+	// modifies generation and costs: crossover, fitness and elimination at once
+	void compute_streaming_elimination(Generation<Genome>& generation, GenerationsCosts<Cost>& costs) {
+		// NOTES:
+		//   - Candidates are kept in a heap with the worst one on top, so every offspring is compared only with it
+		//   - Comparison is the same as in select_best (ties are broken by index), so survivors are the same as without streaming
+		auto& specimens = std::get<SPECIMENS_ID>(generation);
+		auto& ages = std::get<AGE_ID>(generation);
+		std::size_t const survivors = selection->survivors();
+
+		age_parents(generation);
+		compute_fitness(generation, costs);
+
+		auto const better = [](Candidate const& one, Candidate const& another) {
+			if (one.cost < another.cost) return true;
+			if (another.cost < one.cost) return false;
+			return one.sequence < another.sequence;
+		};
+		std::vector<Candidate> best;
+		best.reserve(survivors + 1);
+		// Admitted offspring are moved here; those, which were pushed out since, are dropped when they are as many as the rest
+		auto& admitted = streaming_offspring;
+		admitted.clear();
+		std::size_t peak_admitted = 0;
+		std::vector<std::size_t> alive;
+		auto const drop_pushed_out = [&] {
+			alive.clear();
+			for (auto& candidate : best) {
+				if (!candidate.offspring) continue;
+				alive.push_back(candidate.offspring.value());
+				candidate.offspring = alive.size() - 1;
+			}
+			Compaction(alive).apply(admitted);
+		};
+		// Checked before candidate is built, so that losers are never copied
+		auto const admits = [&](Cost const& cost, std::size_t sequence) {
+			if (best.size() < survivors) return true;
+			if (survivors == 0) return false;
+			auto const& worst = best.front();
+			if (cost < worst.cost) return true;
+			if (worst.cost < cost) return false;
+			return sequence < worst.sequence;
+		};
+		auto const offer = [&](Candidate&& candidate) {
+			if (best.size() == survivors) {
+				std::pop_heap(best.begin(), best.end(), better);
+				best.pop_back();
+			}
+			best.emplace_back(std::move(candidate));
+			std::push_heap(best.begin(), best.end(), better);
+		};
+
+		for (std::size_t i = 0; i < specimens.size(); ++i) {
+			if (admits(costs[i], i)) {
+				offer(Candidate{costs[i], i, std::nullopt, ages ? ages.value()[i] : 0});
+			}
+		}
+
+		std::size_t const largest_batch = produce_offspring(generation, costs, streaming_batch_size().value(),
+		                  [&](Generation<Genome>& batch_generation, GenerationsCosts<Cost>& batch_costs, std::size_t sequence) {
+			auto& batch = std::get<SPECIMENS_ID>(batch_generation);
+			for (std::size_t i = 0; i < batch.size(); ++i, ++sequence) {
+				if (admits(batch_costs[i], sequence)) {
+					offer(Candidate{std::move(batch_costs[i]), sequence, admitted.size(), 0});
+					move_specimen(admitted, batch, i);
+				}
+			}
+			peak_admitted = std::max(peak_admitted, admitted.size());
+			if (admitted.size() > 2 * best.size()) {
+				drop_pushed_out();
+			}
+		});
+
+		// Batches in pipeline: one in each queue slot and one in each stage
+		statistics.peak_specimens = specimens.size() + peak_admitted + largest_batch * (pipeline_batch ? 2 * pipeline_depth + 3 : 1);
+		statistics.capacity = specimens.capacity();
+
+		std::sort(best.begin(), best.end(), better);
+
+		// Survivors go to the other buffer, which takes the place of specimens; then the old one waits for the next generation
+		auto& survived = streaming_survivors;
+		survived.clear();
+		std::vector<std::size_t> survived_ages;
+		survived.reserve(best.size());
+		costs.clear();
+		for (auto& candidate : best) {
+			if (candidate.offspring) {
+				move_specimen(survived, admitted, candidate.offspring.value());
+			} else {
+				move_specimen(survived, specimens, candidate.sequence);
+			}
+			costs.emplace_back(std::move(candidate.cost));
+			survived_ages.emplace_back(candidate.age);
+		}
+		std::swap(specimens, survived);
+		survived.clear();
+		if (ages) {
+			ages = std::move(survived_ages);
+		}
+		admitted.clear();
+	}
+
+	// Crosses all matings of generation in batches of about batch_size offspring, scores each batch as a separate generation
+	// and calls collect(batch_generation, batch_costs, first_sequence) for batches in order;
+	// first_sequence is the index, which the first offspring of batch would have without batches
+	// With pipeline, these three steps run concurrently for different batches
+	// Returns size of the largest batch
+	template <typename Collect>
+	std::size_t produce_offspring(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs, std::size_t batch_size, Collect&& collect) {
+		std::size_t const specimens_size = std::get<SPECIMENS_ID>(generation).size();
+		bool const with_ages = std::get<AGE_ID>(generation).has_value();
+		std::size_t const pairs = schedule_matings(generation, costs);
+		std::size_t const pairs_per_batch = std::max<std::size_t>(1, batch_size / std::max<std::size_t>(1, default_offspring_amount()));
+
+		std::size_t largest_batch = 0;
+		auto const gather = [&](Population<Genome>& batch, std::vector<Population<Genome>>& buffers, std::size_t chunks) {
+			batch.clear();
+			for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+				splice(batch, buffers[chunk]);
+			}
+			statistics.offspring += batch.size();
+			largest_batch = std::max(largest_batch, batch.size());
+		};
+
+		if (!pipeline_batch) {
+			// Batch is reused as a standalone generation for fitness
+			auto& batch = std::get<SPECIMENS_ID>(streaming_generation);
+			std::get<GENERATION_COUNT_ID>(streaming_generation) = std::get<GENERATION_COUNT_ID>(generation);
+			GenerationsCosts<Cost> batch_costs;
+
+			std::size_t sequence = specimens_size;
+			for (std::size_t first_pair = 0; first_pair < pairs; first_pair += pairs_per_batch) {
+				std::size_t const chunks = breed(generation, costs, first_pair, std::min(pairs, first_pair + pairs_per_batch));
+				gather(batch, offspring_buffers, chunks);
+				std::get<AGE_ID>(streaming_generation) = with_ages ? std::optional(std::vector<std::size_t>(batch.size(), 0)) : std::nullopt;
+
+				batch_costs.clear();
+				compute_costs(streaming_generation, batch_costs);
+				assert(batch_costs.size() == batch.size());
+
+				collect(streaming_generation, batch_costs, sequence);
+				sequence += batch.size();
+			}
+			batch.clear();
+			return largest_batch;
+		}
+
+		struct Batch {
+			Generation<Genome> generation;
+			GenerationsCosts<Cost> costs;
+			std::size_t first_sequence;
+		};
+		BoundedQueue<Batch> crossed(pipeline_depth), scored(pipeline_depth);
+		std::exception_ptr crossover_error, fitness_error, collector_error;
+		auto const abort = [&] {
+			crossed.close();
+			scored.close();
+		};
+
+		std::thread crossover_stage([&] {
+			try {
+				std::size_t sequence = specimens_size;
+				for (std::size_t first_pair = 0; first_pair < pairs; first_pair += pairs_per_batch) {
+					std::size_t const chunks = breed(generation, costs, first_pair, std::min(pairs, first_pair + pairs_per_batch),
+					                                 *pipeline_pool, pipeline_offspring_buffers, pipeline_mating_buffers);
+					Batch batch{Generation<Genome>(), GenerationsCosts<Cost>(), sequence};
+					auto& batch_specimens = std::get<SPECIMENS_ID>(batch.generation);
+					gather(batch_specimens, pipeline_offspring_buffers, chunks);
+					std::get<GENERATION_COUNT_ID>(batch.generation) = std::get<GENERATION_COUNT_ID>(generation);
+					if (with_ages) {
+						std::get<AGE_ID>(batch.generation) = std::vector<std::size_t>(batch_specimens.size(), 0);
+					}
+					sequence += batch_specimens.size();
+					if (!crossed.push(std::move(batch))) return;
+				}
+				crossed.close();
+			} catch (...) {
+				crossover_error = std::current_exception();
+				abort();
+			}
+		});
+
+		std::thread collector_stage([&] {
+			try {
+				while (auto batch = scored.pop()) {
+					collect(batch->generation, batch->costs, batch->first_sequence);
+				}
+			} catch (...) {
+				collector_error = std::current_exception();
+				abort();
+			}
+		});
+
+		try {
+			while (auto batch = crossed.pop()) {
+				compute_costs(batch->generation, batch->costs);
+				assert(batch->costs.size() == std::get<SPECIMENS_ID>(batch->generation).size());
+				if (!scored.push(std::move(batch.value()))) break;
+			}
+		} catch (...) {
+			fitness_error = std::current_exception();
+			abort();
+		}
+		scored.close();
+
+		crossover_stage.join();
+		collector_stage.join();
+		for (auto const& error : {crossover_error, fitness_error, collector_error}) {
+			if (error) std::rethrow_exception(error);
+		}
+		return largest_batch;
+	}
+
+	// modifies generation and costs: crossover, fitness and elimination, with batches of offspring in pipeline
+	void compute_pipelined_elimination(Generation<Genome>& generation, GenerationsCosts<Cost>& costs) {
+		auto& specimens = std::get<SPECIMENS_ID>(generation);
+		auto& ages = std::get<AGE_ID>(generation);
+
+		age_parents(generation);
+		compute_fitness(generation, costs);
+
+		// Offspring are not added to generation while crossover stage reads it
+		Population<Genome> collected;
+		GenerationsCosts<Cost> collected_costs;
+		produce_offspring(generation, costs, pipeline_batch.value(),
+		                  [&](Generation<Genome>& batch_generation, GenerationsCosts<Cost>& batch_costs, std::size_t) {
+			splice(collected, std::get<SPECIMENS_ID>(batch_generation));
+			collected_costs.insert(collected_costs.end(), std::make_move_iterator(batch_costs.begin()), std::make_move_iterator(batch_costs.end()));
+		});
+
+		specimens.reserve(specimens.size() + collected.size());
+		splice(specimens, collected);
+		costs.insert(costs.end(), std::make_move_iterator(collected_costs.begin()), std::make_move_iterator(collected_costs.end()));
+		if (ages) {
+			ages.value().resize(specimens.size(), 0);
+		}
+		statistics.peak_specimens = specimens.size();
+		statistics.capacity = specimens.capacity();
+
+		eliminate_losers(generation, costs);
+	}
+
+	// modifies costs
+	// Costs are kept aligned with specimens through crossover (offspring are appended) and elimination (costs go along),
+	// so only new offspring have to be scored
+	void compute_fitness(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) {
+		if (fitness_depends_on_age() || costs.size() > std::get<SPECIMENS_ID>(generation).size()) {
+			costs.resize(0);
+		}
+		compute_costs(generation, costs);
+	}
+
+	// appends costs of specimens [costs.size(), specimens.size())
+	// It's the most heavy function of all.
+	// Whole-generation fitness depends on all specimens at once, so user MUST add parallelization there by himself;
+	// pointwise fitness is parallelized here
+	void compute_costs(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) {
+		if (!pointwise_fitness()) {
+			if constexpr (GenerationFitness<Fitness, Genome, Cost>) {
+				if (!incremental_fitness()) {
+					costs.resize(0);
+				}
+				fitness->cost(generation, costs);
+				if (costs.size() != std::get<SPECIMENS_ID>(generation).size()) {
+					throw std::logic_error("Fitness gave " + std::to_string(costs.size()) + " costs for "
+					                       + std::to_string(std::get<SPECIMENS_ID>(generation).size()) + " specimens");
+				}
+			}
+			return;
+		}
+		if constexpr (PointwiseFitness<Fitness, Genome, Cost>) {
+			compute_pointwise_costs(generation, costs);
+		}
+	}
+
+	void compute_pointwise_costs(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) {
+		auto const& specimens = std::get<SPECIMENS_ID>(generation);
+		auto const& ages = std::get<AGE_ID>(generation);
+		std::size_t const first = costs.size(),
+		                  size = specimens.size() - first;
+		if (threshold) {
+			threshold->offer(std::span<Cost const>(costs.data(), first));
+		}
+		if (size == 0) return;
+
+		std::size_t const grain = fitness_grain_size
+		                          ? std::max<std::size_t>(1, fitness_grain_size.value())
+		                          : std::max<std::size_t>(1, size / (pool.size() * chunks_per_thread));
+		std::size_t const chunks = (size + grain - 1) / grain;
+
+		costs.resize(specimens.size());
+		pool.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+			std::size_t const chunk_first = first + chunk * grain,
+			                  chunk_last = first + std::min(size, (chunk + 1) * grain);
+			if (threshold) {
+				bounded_cost_batch(specimens, ages, chunk_first, chunk_last, costs);
+			} else {
+				cost_batch(specimens, ages, chunk_first, chunk_last, costs);
+			}
+		});
+	}
+
+	// Costs of each portion are offered to threshold, and the next portion is scored against the new cutoff
+	static std::size_t constexpr bounded_portion = 64;
+
+	void bounded_cost_batch(Population<Genome> const& specimens, std::optional<std::vector<std::size_t>> const& ages,
+	                        std::size_t first, std::size_t last, GenerationsCosts<Cost>& costs) {
+		if constexpr (requires (Fitness const& f, Cost const& cutoff) { { f.bounded_cost(specimens[first], first, cutoff) } -> std::convertible_to<Cost>; }) {
+			std::optional<Cost> cutoff = threshold->cutoff();
+			for (std::size_t portion = first; portion < last; portion += bounded_portion) {
+				std::size_t const portion_last = std::min(last, portion + bounded_portion);
+				for (std::size_t i = portion; i < portion_last; ++i) {
+					std::size_t const age = ages ? ages.value()[i] : 0;
+					costs[i] = cutoff ? fitness->bounded_cost(specimens[i], age, cutoff.value()) : fitness->cost(specimens[i], age);
+				}
+				cutoff = threshold->offer(std::span<Cost const>(costs.data() + portion, portion_last - portion));
+			}
+		} else {
+			cost_batch(specimens, ages, first, last, costs);
+		}
+	}
+
+	void cost_batch(Population<Genome> const& specimens, std::optional<std::vector<std::size_t>> const& ages,
+	                std::size_t first, std::size_t last, GenerationsCosts<Cost>& costs) const {
+		if constexpr (requires (Fitness const& f) { f.cost_batch(specimens, ages, first, last, costs); }) {
+			fitness->cost_batch(specimens, ages, first, last, costs);
+		} else {
+			for (std::size_t i = first; i < last; ++i) {
+				costs[i] = fitness->cost(specimens[i], ages ? ages.value()[i] : 0);
+			}
+		}
+	}
+
+	// Projections are used, when there are more features
+	static std::size_t constexpr niche_dimensions = 4;
+	static std::uint64_t constexpr niche_salt = 0x6e69636865; // "niche"
+
+	// Niche of each specimen: hash of its cell
+	std::vector<std::uint64_t> find_niches(Population<Genome> const& specimens) {
+		std::size_t const n = specimens.size(),
+		                  dimensions = similarity->dimensions(),
+		                  cell_dimensions = std::min(dimensions, niche_dimensions);
+		bool const projected = dimensions > niche_dimensions;
+		float const radius = similarity->niche_radius();
+		if (projected && niche_projections.size() != niche_dimensions * (dimensions + 1)) {
+			// Gaussian directions (Box-Muller) and uniform offsets in cells, as in E2LSH
+			RandomStream random(run_seed ^ niche_salt, 0);
+			niche_projections.resize(niche_dimensions * (dimensions + 1));
+			for (std::size_t i = 0; i < niche_dimensions; ++i) {
+				float* const direction = niche_projections.data() + i * (dimensions + 1);
+				for (std::size_t j = 0; j < dimensions; ++j) {
+					float const u1 = random.get_random_float<float>(0.0f, 1.0f), u2 = random.get_random_float<float>(0.0f, 1.0f);
+					direction[j] = std::sqrt(-2.0f * std::log1p(-u1)) * std::cos(6.2831853f * u2);
+				}
+				direction[dimensions] = random.get_random_float<float>(0.0f, 1.0f);
+			}
+		}
+
+		std::vector<std::uint64_t> niches(n);
+		std::size_t const chunks = std::max<std::size_t>(1, std::min(n, pool.size() * chunks_per_thread));
+		pool.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+			std::vector<float> features(dimensions);
+			for (std::size_t i = n * chunk / chunks; i < n * (chunk + 1) / chunks; ++i) {
+				similarity->features(specimens[i], features);
+				std::uint64_t niche = niche_salt;
+				for (std::size_t c = 0; c < cell_dimensions; ++c) {
+					float coordinate = features[c] / radius;
+					if (projected) {
+						float const* const direction = niche_projections.data() + c * (dimensions + 1);
+						coordinate = direction[dimensions];
+						for (std::size_t j = 0; j < dimensions; ++j) {
+							coordinate += direction[j] * features[j] / radius;
+						}
+					}
+					niche = mix_bits(niche ^ static_cast<std::uint64_t>(static_cast<std::int64_t>(std::floor(coordinate))));
+				}
+				niches[i] = niche;
+			}
+		});
+		return niches;
+	}
+
+	// Survivors of clearing: best of each niche first, then the rest, in order better within both
+	template <typename Better>
+	std::vector<std::size_t> select_diverse(Population<Genome> const& specimens, Better const& better) {
+		std::size_t const n = specimens.size(),
+		                  capacity = std::max<std::size_t>(1, similarity->niche_capacity());
+		std::vector<std::uint64_t> const niches = find_niches(specimens);
+
+		// Leaders of each niche are a heap with the worst of them on top, in leaders[first, first + capacity)
+		std::unordered_map<std::uint64_t, std::size_t> first_leader;
+		std::vector<std::size_t> leaders, leaders_amount;
+		for (std::size_t i = 0; i < n; ++i) {
+			auto const [place, added] = first_leader.try_emplace(niches[i], leaders.size());
+			if (added) {
+				leaders.resize(leaders.size() + capacity);
+				leaders_amount.push_back(0);
+			}
+			auto const first = leaders.begin() + static_cast<std::ptrdiff_t>(place->second);
+			std::size_t& amount = leaders_amount[place->second / capacity];
+			if (amount < capacity) {
+				first[amount++] = i;
+				std::push_heap(first, first + amount, better);
+			} else if (better(i, *first)) {
+				std::pop_heap(first, first + amount, better);
+				first[amount - 1] = i;
+				std::push_heap(first, first + amount, better);
+			}
+		}
+
+		std::vector<char> cleared(n, 1);
+		for (std::size_t niche = 0; niche < leaders_amount.size(); ++niche) {
+			for (std::size_t k = 0; k < leaders_amount[niche]; ++k) {
+				cleared[leaders[niche * capacity + k]] = 0;
+			}
+		}
+		return select_best(n, selection->survivors(), pool, [&](std::size_t one, std::size_t another) {
+			if (cleared[one] != cleared[another]) return cleared[one] < cleared[another];
+			return better(one, another);
+		});
+	}
+
+	// Survivors by Pareto fronts, then by crowding distance (greater first) within a front
+	std::vector<std::size_t> select_pareto(Population<Genome> const& specimens, GenerationsCosts<Cost> const& costs) {
+		std::size_t const n = costs.size(),
+		                  m = objectives->objectives(),
+		                  survivors = selection->survivors();
+		std::vector<double> values(n * m);
+		std::size_t const chunks = std::max<std::size_t>(1, std::min(n, pool.size() * chunks_per_thread));
+		pool.parallel_for(chunks, [&](std::size_t chunk, std::size_t) {
+			for (std::size_t i = n * chunk / chunks; i < n * (chunk + 1) / chunks; ++i) {
+				objectives->values(costs[i], std::span<double>(values).subspan(i * m, m));
+			}
+		});
+
+		std::vector<std::size_t> const fronts = non_dominated_fronts(values, m, pool);
+		// Crowding matters only for fronts, which are (partly) taken
+		std::vector<std::size_t> front_sizes;
+		for (std::size_t front : fronts) {
+			if (front_sizes.size() <= front) front_sizes.resize(front + 1, 0);
+			++front_sizes[front];
+		}
+		std::size_t last_front = 0;
+		for (std::size_t taken = 0; last_front < front_sizes.size(); ++last_front) {
+			taken += front_sizes[last_front];
+			if (taken >= survivors) break;
+		}
+		std::vector<double> const crowding = crowding_distances(values, m, fronts, last_front, pool);
+
+		auto const better = [&](std::size_t one, std::size_t another) {
+			if (fronts[one] != fronts[another]) return fronts[one] < fronts[another];
+			if (crowding[one] != crowding[another]) return crowding[one] > crowding[another];
+			return one < another;
+		};
+		std::vector<std::size_t> chosen = similarity ? select_diverse(specimens, better) : select_best(n, survivors, pool, better);
+		first_front.clear();
+		for (std::size_t place = 0; place < chosen.size(); ++place) {
+			if (fronts[chosen[place]] == 0) first_front.push_back(place);
+		}
+		return chosen;
+	}
+
+	// modifies generation and costs
+	void eliminate_losers(Generation<Genome>& generation, GenerationsCosts<Cost>& costs) {
+		// NOTES:
+		//   - Only survivors are found (top-k, not a full sort) and only they are moved to first positions
+		//   - Then containers are resized to target size
+		//   - Costs and ages go along, so costs[0] is the cost of specimens[0], the best one
+		auto& specimens = std::get<SPECIMENS_ID>(generation);
+		auto& ages = std::get<AGE_ID>(generation);
+		assert(costs.size() == specimens.size());
+
+		std::vector<std::size_t> chosen;
+		if (objectives) {
+			chosen = select_pareto(specimens, costs);
+		} else if (similarity) {
+			chosen = select_diverse(specimens, [&costs](std::size_t one, std::size_t another) {
+				if (costs[one] < costs[another]) return true;
+				if (costs[another] < costs[one]) return false;
+				return one < another;
+			});
+		} else {
+			chosen = select_best(costs, selection->survivors(), pool);
+		}
+		Compaction const compaction(chosen);
+
+		compaction.apply(specimens);
+		compaction.apply(costs);
+		if (ages) {
+			compaction.apply(ages.value());
+		}
+	}
+};
+
+/*
+ *	Environment with virtual interfaces: policies could be changed at run time.
+ */
+template <typename Genome, typename Cost>
+class Environment : public BasicEnvironment<Genome, Cost, DynamicFitness<Genome, Cost>, ICrossover<Genome, Cost>, ISelection<Genome, Cost>> {
+	using Base = BasicEnvironment<Genome, Cost, DynamicFitness<Genome, Cost>, ICrossover<Genome, Cost>, ISelection<Genome, Cost>>;
+
+public:
+	Environment(std::shared_ptr<IFitness<Genome, Cost>> fitness,
+	            std::shared_ptr<ICrossover<Genome, Cost>> crossover,
+	            std::shared_ptr<ISelection<Genome, Cost>> selection,
+	            std::size_t number_of_threads = 1,
+	            std::optional<std::uint64_t> seed = std::nullopt)
+	  : Base(std::make_shared<DynamicFitness<Genome, Cost>>(fitness, nullptr), crossover, selection, number_of_threads, seed) { }
+
+	Environment(std::shared_ptr<IPointwiseFitness<Genome, Cost>> fitness,
+	            std::shared_ptr<ICrossover<Genome, Cost>> crossover,
+	            std::shared_ptr<ISelection<Genome, Cost>> selection,
+	            std::size_t number_of_threads = 1,
+	            std::optional<std::uint64_t> seed = std::nullopt)
+	  : Base(std::make_shared<DynamicFitness<Genome, Cost>>(nullptr, fitness), crossover, selection, number_of_threads, seed) { }
+};
+
+/*
+ *	Environment with concrete policies, known at compile time: no virtual calls in inner loops,
+ *	cross/cost could be inlined, constant default_offspring_amount(), fixed_offspring_amount() etc. are folded.
+ *	Policies don't have to derive from interfaces; to stay devirtualized, those that do should be final.
+ */
+template <typename Genome, typename Cost, typename Fitness, typename Crossover, typename Selection>
+using StaticEnvironment = BasicEnvironment<Genome, Cost, Fitness, Crossover, Selection>;
+
 } // namespace genetics
 
 #endif //__GENETICS_H
@@ -0,0 +1,332 @@
+#ifndef __GENETICS_ARENA_H
+#define __GENETICS_ARENA_H
+
+// Populations, which reuse memory of specimens: flat storage for sequence genomes, and recycled genomes, which own memory
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+/*
+ *	Population of sequence genomes (std::vector<T>) in one contiguous buffer plus offsets:
+ *	specimen i is elements[offsets[i], offsets[i+1]).
+ *	No allocation per specimen, and buffers are reused when population is cleared or compacted.
+ *	Specimens are exposed as spans: std::span<T const> is what fitness, crossover and selection see.
+ *	New specimens are written into one genome of the population, reused for each of them, and appended from it
+ *	(build() and commit(), see ICrossover::cross_batch): crossover with cross_into doesn't allocate once that genome has grown.
+ *
+ *	Elements and offsets are in std::vector by default; with storage, which can spill (SpillablePopulation, see SpillableRaggedPopulation
+ *	of genetics_spill.hpp), population can spill too.
+ *
+ *	To use it for some genome, specialize population_traits:
+ *	  template <> struct genetics::population_traits<std::vector<float>> : genetics::ragged_population<float> { };
+ */
+template <typename T,
+          typename Allocator = std::allocator<T>,
+          typename Elements = std::vector<T, Allocator>,
+          typename Offsets = std::vector<std::size_t, typename std::allocator_traits<Allocator>::template rebind_alloc<std::size_t>>>
+class RaggedPopulation {
+public:
+	using value_type = std::vector<T, Allocator>;
+
+	RaggedPopulation() {
+		offsets.push_back(0);
+	}
+
+	RaggedPopulation(std::vector<value_type> const& genomes) : RaggedPopulation() {
+		std::size_t total = 0;
+		for (auto const& genome : genomes) {
+			total += genome.size();
+		}
+		reserve(genomes.size(), total);
+		for (auto const& genome : genomes) {
+			emplace_back(genome);
+		}
+	}
+
+	std::size_t size() const { return offsets.size() - 1; }
+	bool empty() const { return size() == 0; }
+	std::size_t elements_size() const { return elements.size(); }
+	std::size_t capacity() const { return offsets.capacity() - 1; }
+
+	// Elements are estimated by current average length of specimen
+	void reserve(std::size_t specimens) {
+		std::size_t const average = size() == 0 ? 0 : (elements.size() + size() - 1) / size();
+		reserve(specimens, specimens * average);
+	}
+
+	void reserve(std::size_t specimens, std::size_t total_elements) {
+		offsets.reserve(specimens + 1);
+		elements.reserve(total_elements);
+	}
+
+	// Capacity is kept
+	void clear() {
+		elements.clear();
+		offsets.resize(1);
+	}
+
+	std::span<T> operator[](std::size_t index) {
+		return {elements.data() + offsets[index], offsets[index + 1] - offsets[index]};
+	}
+	std::span<T const> operator[](std::size_t index) const {
+		return {elements.data() + offsets[index], offsets[index + 1] - offsets[index]};
+	}
+	std::span<T const> at(std::size_t index) const {
+		if (index >= size()) throw std::out_of_range("RaggedPopulation::at");
+		return (*this)[index];
+	}
+
+	template <typename Range>
+	void emplace_back(Range const& genome) {
+		extend(elements, std::begin(genome), std::end(genome));
+		offsets.push_back(elements.size());
+	}
+
+	template <typename Range>
+	void push_back(Range const& genome) {
+		emplace_back(genome);
+	}
+
+	// Genome to write a new specimen into (it is empty), then commit() appends it
+	value_type& build() {
+		building.clear();
+		return building;
+	}
+	void commit() { emplace_back(building); }
+
+	// New specimen of given length, to be written in place
+	std::span<T> append(std::size_t length) {
+		elements.resize(elements.size() + length);
+		offsets.push_back(elements.size());
+		return (*this)[size() - 1];
+	}
+
+	// Drops the last specimens
+	void resize(std::size_t new_size) {
+		assert(new_size <= size());
+		offsets.resize(new_size + 1);
+		elements.resize(offsets.back());
+	}
+
+	// Whole population of other at the end, in one bulk copy
+	void append(RaggedPopulation const& other) {
+		std::size_t const shift = elements.size();
+		extend(elements, other.elements.begin(), other.elements.end());
+		offsets.reserve(offsets.size() + other.size());
+		for (std::size_t i = 1; i < other.offsets.size(); ++i) {
+			offsets.push_back(other.offsets[i] + shift);
+		}
+	}
+
+	// i-th chosen specimen becomes i-th, the rest are dropped
+	// One pass into spare buffers, which are swapped with current ones (and reused next time)
+	void compact(std::vector<std::size_t> const& chosen) {
+		spare_elements.clear();
+		spare_offsets.clear();
+		spare_offsets.push_back(0);
+		spare_offsets.reserve(chosen.size() + 1);
+		for (std::size_t index : chosen) {
+			extend(spare_elements, std::next(elements.begin(), offsets[index]), std::next(elements.begin(), offsets[index + 1]));
+			spare_offsets.push_back(spare_elements.size());
+		}
+		std::swap(elements, spare_elements);
+		std::swap(offsets, spare_offsets);
+	}
+
+	// Whole population from raw storage: elements and offsets as returned by data() and bounds()
+	void assign(std::span<T const> new_elements, std::span<std::size_t const> new_offsets) {
+		assert(!new_offsets.empty() && new_offsets.front() == 0 && new_offsets.back() == new_elements.size());
+		elements.assign(new_elements.begin(), new_elements.end());
+		offsets.assign(new_offsets.begin(), new_offsets.end());
+	}
+
+	// Raw storage, e.g. for vectorized fitness
+	std::span<T const> data() const { return elements; }
+	std::span<std::size_t const> bounds() const { return offsets; }
+
+	// Storage moves to scratch files in directory, if it can (see SpillablePopulation)
+	void spill(std::string const& directory)
+	requires requires (Elements& storage, Offsets& bounds) { storage.spill(directory); bounds.spill(directory); } {
+		elements.spill(directory);
+		offsets.spill(directory);
+		spare_elements.spill(directory);
+		spare_offsets.spill(directory);
+	}
+
+private:
+	Elements elements;
+	Offsets offsets;
+	Elements spare_elements;
+	Offsets spare_offsets;
+	value_type building;
+
+	// At the end of storage: std::vector inserts, other storage (e.g. SpillablePopulation) appends
+	template <typename Storage, typename Iterator>
+	static void extend(Storage& storage, Iterator first, Iterator last) {
+		if constexpr (requires { storage.append(first, last); }) {
+			storage.append(first, last);
+		} else {
+			storage.insert(storage.end(), first, last);
+		}
+	}
+};
+
+template <typename T, typename Allocator = std::allocator<T>>
+struct ragged_population {
+	using type = RaggedPopulation<T, Allocator>;
+};
+
+template <typename T, typename... Storage>
+void splice(RaggedPopulation<T, Storage...>& to, RaggedPopulation<T, Storage...>& from) {
+	to.append(from);
+	from.clear();
+}
+
+template <typename T, typename... Storage>
+void move_specimen(RaggedPopulation<T, Storage...>& to, RaggedPopulation<T, Storage...>& from, std::size_t index) {
+	to.emplace_back(from[index]);
+}
+
+/*
+ *	Population of genomes, which own memory (std::vector, std::string, trees of nodes...), whose dropped specimens are not destroyed:
+ *	they stay behind the live ones as recycled slots, and recycle() gives them out for new specimens.
+ *	Crossover writes offspring over them with cross_into (see ICrossover), reusing their memory;
+ *	survivors are swapped forward on elimination, and offspring are swapped into recycled slots of population on splice,
+ *	so each generation hands the memory of its losers to the next one, and once warmed up it doesn't allocate genomes at all.
+ *	The price is memory: genomes of last losers are kept (in population and in offspring buffers of Environment) till they are reused.
+ *
+ *	To use it for some genome, specialize population_traits:
+ *	  template <> struct genetics::population_traits<Tree> : genetics::recycling_population<Tree> { };
+ */
+template <typename Genome>
+class RecyclingPopulation {
+public:
+	using value_type = Genome;
+	using size_type = std::size_t;
+	using iterator = typename std::vector<Genome>::iterator;
+	using const_iterator = typename std::vector<Genome>::const_iterator;
+
+	RecyclingPopulation() = default;
+	RecyclingPopulation(std::vector<Genome> specimens) : items(std::move(specimens)), count(items.size()) { }
+
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	std::size_t capacity() const { return items.capacity(); }
+	// Dropped genomes, which wait to be reused
+	std::size_t recycled() const { return items.size() - count; }
+
+	Genome& operator[](std::size_t index) { return items[index]; }
+	Genome const& operator[](std::size_t index) const { return items[index]; }
+	Genome& front() { return items[0]; }
+	Genome const& front() const { return items[0]; }
+	Genome& back() { return items[count - 1]; }
+	Genome const& back() const { return items[count - 1]; }
+
+	iterator begin() { return items.begin(); }
+	iterator end() { return items.begin() + count; }
+	const_iterator begin() const { return items.begin(); }
+	const_iterator end() const { return items.begin() + count; }
+
+	void reserve(std::size_t specimens) { items.reserve(specimens); }
+
+	// Genomes are kept for reuse
+	void clear() { count = 0; }
+
+	void resize(std::size_t new_size) {
+		if (new_size > items.size()) items.resize(new_size);
+		count = new_size;
+	}
+
+	// Slot for a new specimen at the end: a recycled genome (its value is unspecified) or a new default one
+	Genome& recycle() {
+		if (count == items.size()) items.emplace_back();
+		return items[count++];
+	}
+
+	template <typename... Args>
+	Genome& emplace_back(Args&&... args) {
+		if (count < items.size()) {
+			items[count] = Genome(std::forward<Args>(args)...);
+		} else {
+			items.emplace_back(std::forward<Args>(args)...);
+		}
+		return items[count++];
+	}
+	void push_back(Genome const& genome) { emplace_back(genome); }
+	void push_back(Genome&& genome) { emplace_back(std::move(genome)); }
+	void pop_back() { --count; }
+
+	template <typename Iterator>
+	void assign(Iterator first, Iterator last) {
+		clear();
+		for (; first != last; ++first) {
+			emplace_back(*first);
+		}
+	}
+
+	// Live specimens of other are swapped into recycled slots (other gets the recycled genomes back) or moved to the end
+	void take(RecyclingPopulation& other) {
+		for (std::size_t i = 0; i < other.count; ++i) {
+			if (count < items.size()) {
+				std::swap(items[count], other.items[i]);
+			} else {
+				items.emplace_back(std::move(other.items[i]));
+			}
+			++count;
+		}
+		other.count = 0;
+	}
+
+	// i-th chosen specimen becomes i-th, the rest are recycled
+	// As in Compaction, chosen are swapped forward in order of their positions (so nothing chosen is overwritten), then put in order
+	void compact(std::vector<std::size_t> const& chosen) {
+		by_position.resize(chosen.size());
+		std::iota(by_position.begin(), by_position.end(), 0);
+		std::sort(by_position.begin(), by_position.end(),
+		          [&chosen](std::size_t one, std::size_t another) { return chosen[one] < chosen[another]; });
+		for (std::size_t place = 0; place < chosen.size(); ++place) {
+			if (chosen[by_position[place]] != place) {
+				std::swap(items[place], items[chosen[by_position[place]]]);
+			}
+		}
+		// place holds chosen[by_position[place]]; it goes to by_position[place]
+		for (std::size_t place = 0; place < chosen.size(); ++place) {
+			while (by_position[place] != place) {
+				std::size_t const target = by_position[place];
+				std::swap(items[place], items[target]);
+				std::swap(by_position[place], by_position[target]);
+			}
+		}
+		count = chosen.size();
+	}
+
+	bool operator==(RecyclingPopulation const& other) const {
+		return std::equal(begin(), end(), other.begin(), other.end());
+	}
+
+private:
+	std::vector<Genome> items; // live specimens [0, count), recycled genomes after them
+	std::size_t count = 0;
+	std::vector<std::size_t> by_position;
+};
+
+template <typename Genome>
+struct recycling_population {
+	using type = RecyclingPopulation<Genome>;
+};
+
+template <typename Genome>
+void splice(RecyclingPopulation<Genome>& to, RecyclingPopulation<Genome>& from) {
+	to.take(from);
+}
+
+// Swapped with a recycled slot of to, so from keeps a genome to reuse
+template <typename Genome>
+void move_specimen(RecyclingPopulation<Genome>& to, RecyclingPopulation<Genome>& from, std::size_t index) {
+	std::swap(to.recycle(), from[index]);
+}
+
+} // namespace genetics
+
+#endif //__GENETICS_ARENA_H
@@ -0,0 +1,351 @@
+#ifndef __GENETICS_CACHE_H
+#define __GENETICS_CACHE_H
+
+// Memoization of fitness for repeated genomes
+
+#include <unordered_map>
+#include <atomic>
+#include <iterator>
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+// std::hash, if Genome has it; otherwise combined hash of elements (for sequence genomes like std::vector<float>)
+// Genome and its SpecimenView (e.g. std::span from RaggedPopulation) have the same hash
+template <typename Genome>
+struct GenomeHash {
+	template <typename Specimen>
+	std::size_t operator()(Specimen const& specimen) const {
+		if constexpr (requires { std::hash<Specimen>{}(specimen); }) {
+			return std::hash<Specimen>{}(specimen);
+		} else {
+			using Element = std::decay_t<decltype(*std::begin(specimen))>;
+			std::uint64_t result = mix_bits(static_cast<std::uint64_t>(std::size(specimen)));
+			for (auto const& element : specimen) {
+				result = mix_bits(result ^ GenomeHash<Element>{}(element));
+			}
+			return static_cast<std::size_t>(result);
+		}
+	}
+};
+
+// operator==, if it is there; otherwise element-wise comparison (Genome against a view of it)
+template <typename Genome>
+struct GenomeEqual {
+	template <typename Specimen>
+	bool operator()(Genome const& genome, Specimen const& specimen) const {
+		if constexpr (requires { genome == specimen; }) {
+			return genome == specimen;
+		} else {
+			return std::equal(std::begin(genome), std::end(genome), std::begin(specimen), std::end(specimen));
+		}
+	}
+};
+
+// Owning copy of a specimen
+template <typename Genome, typename Specimen>
+Genome to_genome(Specimen const& specimen) {
+	if constexpr (std::is_constructible_v<Genome, Specimen const&>) {
+		return Genome(specimen);
+	} else {
+		return Genome(std::begin(specimen), std::end(specimen));
+	}
+}
+
+struct FitnessCacheStatistics {
+	std::size_t hits = 0, misses = 0, evictions = 0, size = 0;
+};
+
+/*
+ *	Bounded map Genome -> Cost.
+ *	Split into shards, each with its own lock, so concurrent lookups rarely wait for each other.
+ *	Hash only selects candidates, genomes are compared for equality before a hit.
+ *	When shard is full, entry is evicted with CLOCK: entries used since the hand passed them get a second chance.
+ */
+template <typename Genome, typename Cost, typename Hash = GenomeHash<Genome>, typename Equal = GenomeEqual<Genome>>
+class FitnessCache {
+public:
+	explicit FitnessCache(std::size_t capacity, std::size_t number_of_shards = 64, Hash hash = Hash(), Equal equal = Equal())
+	  : shards(std::max<std::size_t>(1, std::min(number_of_shards, capacity)))
+	  , hash(std::move(hash))
+	  , equal(std::move(equal)) {
+		for (std::size_t shard = 0; shard < shards.size(); ++shard) {
+			shards[shard].capacity = std::max<std::size_t>(1, capacity * (shard + 1) / shards.size() - capacity * shard / shards.size());
+		}
+	}
+
+	template <typename Specimen>
+	std::size_t hash_of(Specimen const& genome) const { return hash(genome); }
+
+	// key is additional part of identity (e.g. age), 0 if not used
+	template <typename Specimen>
+	std::optional<Cost> find(Specimen const& genome, std::size_t genome_hash, std::size_t key = 0) {
+		auto& shard = shard_of(genome_hash);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto [first, last] = shard.index.equal_range(genome_hash);
+		for (; first != last; ++first) {
+			auto& entry = shard.entries[first->second];
+			if (entry.key == key && equal(entry.genome, genome)) {
+				entry.referenced = true;
+				hits.fetch_add(1, std::memory_order_relaxed);
+				return entry.cost;
+			}
+		}
+		misses.fetch_add(1, std::memory_order_relaxed);
+		return std::nullopt;
+	}
+
+	template <typename Specimen>
+	void insert(Specimen const& genome, std::size_t genome_hash, Cost const& cost, std::size_t key = 0) {
+		auto& shard = shard_of(genome_hash);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		// Somebody could have computed the same genome concurrently
+		auto [first, last] = shard.index.equal_range(genome_hash);
+		for (; first != last; ++first) {
+			auto const& entry = shard.entries[first->second];
+			if (entry.key == key && equal(entry.genome, genome)) return;
+		}
+
+		if (shard.entries.size() < shard.capacity) {
+			shard.index.emplace(genome_hash, shard.entries.size());
+			shard.entries.push_back(Entry{to_genome<Genome>(genome), cost, genome_hash, key, false});
+			return;
+		}
+
+		// CLOCK
+		for (;;) {
+			auto& entry = shard.entries[shard.hand];
+			if (!entry.referenced) break;
+			entry.referenced = false;
+			shard.hand = (shard.hand + 1) % shard.entries.size();
+		}
+		std::size_t const slot = shard.hand;
+		shard.hand = (shard.hand + 1) % shard.entries.size();
+
+		auto& victim = shard.entries[slot];
+		auto [victim_first, victim_last] = shard.index.equal_range(victim.hash);
+		for (; victim_first != victim_last; ++victim_first) {
+			if (victim_first->second == slot) {
+				shard.index.erase(victim_first);
+				break;
+			}
+		}
+		victim = Entry{to_genome<Genome>(genome), cost, genome_hash, key, false};
+		shard.index.emplace(genome_hash, slot);
+		evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	FitnessCacheStatistics statistics() const {
+		FitnessCacheStatistics result;
+		result.hits = hits.load(std::memory_order_relaxed);
+		result.misses = misses.load(std::memory_order_relaxed);
+		result.evictions = evictions.load(std::memory_order_relaxed);
+		for (auto& shard : shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			result.size += shard.entries.size();
+		}
+		return result;
+	}
+
+	void reset_statistics() {
+		hits = 0;
+		misses = 0;
+		evictions = 0;
+	}
+
+	void clear() {
+		for (auto& shard : shards) {
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.entries.clear();
+			shard.index.clear();
+			shard.hand = 0;
+		}
+	}
+
+private:
+	struct Entry {
+		Genome genome;
+		Cost cost;
+		std::size_t hash;
+		std::size_t key;
+		bool referenced;
+	};
+
+	struct Shard {
+		mutable std::mutex mutex;
+		std::vector<Entry> entries;
+		std::unordered_multimap<std::size_t, std::size_t> index; // hash -> place in entries
+		std::size_t capacity = 0;
+		std::size_t hand = 0;
+	};
+
+	std::vector<Shard> shards;
+	Hash hash;
+	Equal equal;
+	std::atomic<std::size_t> hits{0}, misses{0}, evictions{0};
+
+	Shard& shard_of(std::size_t genome_hash) {
+		// Mixed once more: index buckets of the shard use the same hash
+		return shards[static_cast<std::size_t>(mix_bits(genome_hash) % shards.size())];
+	}
+};
+
+/*
+ *	Pointwise fitness with memoization: duplicates are looked up instead of being scored again.
+ *	If wrapped fitness depends on age, age is a part of the key.
+ *	Batches and bounded evaluation of wrapped fitness are kept: only misses are scored by its cost_batch or bounded_cost
+ *	(and only full costs of bounded evaluation, those not worse than cutoff, are cached).
+ */
+template <typename Genome, typename Cost, typename Hash = GenomeHash<Genome>, typename Equal = GenomeEqual<Genome>>
+class CachedPointwiseFitness : public IPointwiseFitness<Genome, Cost> {
+public:
+	CachedPointwiseFitness(std::shared_ptr<IPointwiseFitness<Genome, Cost>> fitness, std::size_t capacity)
+	  : fitness(fitness), cache(capacity) { }
+	~CachedPointwiseFitness() override = default;
+
+	Cost cost(SpecimenView<Genome> specimen, std::size_t age) const override {
+		std::size_t const key = fitness->depends_on_age() ? age : 0;
+		std::size_t const genome_hash = cache.hash_of(specimen);
+		if (auto known = cache.find(specimen, genome_hash, key)) {
+			return std::move(known.value());
+		}
+		Cost result = fitness->cost(specimen, age);
+		cache.insert(specimen, genome_hash, result, key);
+		return result;
+	}
+
+	void cost_batch(Population<Genome> const& specimens, std::optional<std::vector<std::size_t>> const& ages,
+	                std::size_t first, std::size_t last, GenerationsCosts<Cost>& costs) const override {
+		bool const by_age = fitness->depends_on_age();
+		std::vector<std::size_t> hashes(last - first), missing;
+		for (std::size_t i = first; i < last; ++i) {
+			std::size_t const age = ages ? ages.value()[i] : 0;
+			hashes[i - first] = cache.hash_of(specimens[i]);
+			if (auto known = cache.find(specimens[i], hashes[i - first], by_age ? age : 0)) {
+				costs[i] = std::move(known.value());
+			} else {
+				missing.push_back(i);
+			}
+		}
+		if (missing.empty()) return;
+
+		// Nothing is known: the batch goes as is, without copies of specimens
+		if (missing.size() == last - first) {
+			fitness->cost_batch(specimens, ages, first, last, costs);
+		} else {
+			Population<Genome> missing_specimens;
+			std::optional<std::vector<std::size_t>> missing_ages;
+			if (ages) missing_ages.emplace();
+			missing_specimens.reserve(missing.size());
+			for (std::size_t i : missing) {
+				missing_specimens.emplace_back(specimens[i]);
+				if (ages) missing_ages.value().push_back(ages.value()[i]);
+			}
+			GenerationsCosts<Cost> missing_costs(missing.size());
+			fitness->cost_batch(missing_specimens, missing_ages, 0, missing.size(), missing_costs);
+			for (std::size_t m = 0; m < missing.size(); ++m) {
+				costs[missing[m]] = std::move(missing_costs[m]);
+			}
+		}
+		for (std::size_t i : missing) {
+			cache.insert(specimens[i], hashes[i - first], costs[i], by_age && ages ? ages.value()[i] : 0);
+		}
+	}
+
+	bool depends_on_age() const override { return fitness->depends_on_age(); }
+
+	bool is_bounded() const override { return fitness->is_bounded(); }
+	Cost bounded_cost(SpecimenView<Genome> specimen, std::size_t age, Cost const& cutoff) const override {
+		std::size_t const key = fitness->depends_on_age() ? age : 0;
+		std::size_t const genome_hash = cache.hash_of(specimen);
+		if (auto known = cache.find(specimen, genome_hash, key)) {
+			return std::move(known.value());
+		}
+		Cost result = fitness->bounded_cost(specimen, age, cutoff);
+		// Evaluation, which went over cutoff, could have stopped early
+		if (!(cutoff < result)) cache.insert(specimen, genome_hash, result, key);
+		return result;
+	}
+
+	FitnessCacheStatistics statistics() const { return cache.statistics(); }
+	void reset_statistics() { cache.reset_statistics(); }
+
+private:
+	std::shared_ptr<IPointwiseFitness<Genome, Cost>> fitness;
+	mutable FitnessCache<Genome, Cost, Hash, Equal> cache;
+};
+
+/*
+ *	Whole-generation fitness with memoization.
+ *	Specimens missing in cache are gathered into a separate generation and scored by wrapped fitness at once,
+ *	so it is correct only if cost of a specimen does not depend on other specimens.
+ */
+template <typename Genome, typename Cost, typename Hash = GenomeHash<Genome>, typename Equal = GenomeEqual<Genome>>
+class CachedFitness : public IFitness<Genome, Cost> {
+public:
+	CachedFitness(std::shared_ptr<IFitness<Genome, Cost>> fitness, std::size_t capacity)
+	  : fitness(fitness), cache(capacity) { }
+	~CachedFitness() override = default;
+
+	void cost(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) override {
+		auto const& specimens = std::get<SPECIMENS_ID>(generation);
+		auto const& ages = std::get<AGE_ID>(generation);
+		bool const by_age = fitness->depends_on_age();
+		std::size_t const first = costs.size();
+
+		std::vector<std::optional<Cost>> found(specimens.size() - first);
+		std::vector<std::size_t> hashes(found.size()), missing;
+
+		auto& missing_specimens = std::get<SPECIMENS_ID>(misses);
+		auto& missing_ages = std::get<AGE_ID>(misses);
+		missing_specimens.clear();
+		std::get<GENERATION_COUNT_ID>(misses) = std::get<GENERATION_COUNT_ID>(generation);
+		missing_ages = ages ? std::optional<std::vector<std::size_t>>(std::vector<std::size_t>()) : std::nullopt;
+
+		for (std::size_t i = 0; i < found.size(); ++i) {
+			auto const& specimen = specimens[first + i];
+			std::size_t const age = ages ? ages.value()[first + i] : 0;
+			hashes[i] = cache.hash_of(specimen);
+			found[i] = cache.find(specimen, hashes[i], by_age ? age : 0);
+			if (!found[i]) {
+				missing.push_back(i);
+				missing_specimens.emplace_back(specimen);
+				if (missing_ages) missing_ages.value().push_back(age);
+			}
+		}
+
+		missing_costs.clear();
+		if (!missing.empty()) {
+			fitness->cost(misses, missing_costs);
+			if (missing_costs.size() != missing.size()) throw std::logic_error("Wrapped fitness gave wrong number of costs");
+		}
+		for (std::size_t m = 0; m < missing.size(); ++m) {
+			std::size_t const i = missing[m];
+			cache.insert(specimens[first + i], hashes[i], missing_costs[m], by_age && ages ? ages.value()[first + i] : 0);
+			found[i] = std::move(missing_costs[m]);
+		}
+		missing_specimens.clear();
+
+		for (auto& cost : found) {
+			costs.emplace_back(std::move(cost.value()));
+		}
+	}
+
+	bool incremental() const override { return true; }
+	bool depends_on_age() const override { return fitness->depends_on_age(); }
+
+	FitnessCacheStatistics statistics() const { return cache.statistics(); }
+	void reset_statistics() { cache.reset_statistics(); }
+
+private:
+	std::shared_ptr<IFitness<Genome, Cost>> fitness;
+	FitnessCache<Genome, Cost, Hash, Equal> cache;
+	Generation<Genome> misses;
+	GenerationsCosts<Cost> missing_costs;
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_CACHE_H
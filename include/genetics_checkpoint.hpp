@@ -0,0 +1,417 @@
+#ifndef __GENETICS_CHECKPOINT_H
+#define __GENETICS_CHECKPOINT_H
+
+// Binary checkpoints of generation: written with one vectored write, loaded through mmap
+// POSIX is expected
+
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <system_error>
+#include <ranges>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+/*
+ *	Hook for genomes and costs, which are not stored as they are in memory.
+ *	Specialize it with
+ *	  static void write(T const& value, std::vector<std::byte>& out); // appends bytes of value
+ *	  static T read(std::span<std::byte const> bytes);                // value from exactly these bytes
+ *	write could take a specimen view instead of T const& (e.g. std::span, if population is RaggedPopulation).
+ *	Without specialization, trivially copyable types are copied as they are,
+ *	and contiguous sequences of them (e.g. std::vector<float>) are stored as one array of elements plus offsets.
+ */
+template <typename T>
+struct Serializer;
+
+// Run is resumed from it with the same result, as if it was not interrupted: random numbers depend only on seed and generation
+template <typename Genome, typename Cost>
+struct Checkpoint {
+	Generation<Genome> generation;
+	GenerationsCosts<Cost> costs;
+	std::uint64_t seed = 0;
+};
+
+namespace checkpoint_format {
+
+enum Kind : std::uint32_t {
+	RAW = 1,        // records of fixed size
+	RAGGED = 2,     // offsets (count + 1) and elements
+	SERIALIZED = 3  // offsets (count + 1) and bytes from Serializer
+};
+
+template <typename T>
+concept Serializable = requires (std::span<std::byte const> bytes) {
+	{ Serializer<T>::read(bytes) } -> std::convertible_to<T>;
+};
+
+template <typename T>
+concept Ragged = std::ranges::contiguous_range<T>
+                 && std::is_trivially_copyable_v<std::ranges::range_value_t<T>>
+                 && std::is_constructible_v<T, std::ranges::range_value_t<T> const*, std::ranges::range_value_t<T> const*>;
+
+template <typename T>
+constexpr Kind kind_of() {
+	if constexpr (Serializable<T>) {
+		return SERIALIZED;
+	} else if constexpr (std::is_trivially_copyable_v<T>) {
+		return RAW;
+	} else {
+		static_assert(Ragged<T>, "Genome or Cost must be trivially copyable, a sequence of trivially copyable elements, or have a Serializer");
+		return RAGGED;
+	}
+}
+
+// Size of record for RAW, of element for RAGGED
+template <typename T>
+constexpr std::uint64_t unit_of() {
+	if constexpr (kind_of<T>() == RAW) return sizeof(T);
+	else if constexpr (kind_of<T>() == RAGGED) return sizeof(std::ranges::range_value_t<T>);
+	else return 1;
+}
+
+struct Section {
+	std::uint64_t offset = 0, size = 0;
+};
+
+struct Column {
+	std::uint32_t kind = 0;
+	std::uint32_t reserved = 0;
+	std::uint64_t unit = 0;
+	std::uint64_t count = 0;
+	Section offsets, data;
+};
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t has_ages;
+	std::uint64_t generation_count;
+	std::uint64_t seed;
+	Column specimens, costs;
+	Section ages;
+};
+
+inline constexpr char magic[8] = {'G', 'E', 'N', 'C', 'K', 'P', 'T', '\0'};
+inline constexpr std::uint32_t version = 1;
+// Sections start at this alignment, so that mapped arrays are aligned for any element
+inline constexpr std::uint64_t alignment = 64;
+
+// Pieces of file in order; data of containers is referenced, not copied, whenever it is contiguous already
+class Writer {
+public:
+	Writer() {
+		pieces.push_back({&header, sizeof(Header)});
+		size = sizeof(Header);
+	}
+
+	Header header{};
+
+	Section add(void const* data, std::uint64_t bytes) {
+		static std::byte const zeros[alignment] = {};
+		if (std::uint64_t const padding = (alignment - size % alignment) % alignment) {
+			pieces.push_back({const_cast<std::byte*>(zeros), padding});
+			size += padding;
+		}
+		Section section{size, bytes};
+		if (bytes > 0) {
+			pieces.push_back({const_cast<void*>(data), bytes});
+			size += bytes;
+		}
+		return section;
+	}
+
+	// Buffer, which lives as long as writer
+	std::vector<std::byte>& buffer() {
+		owned.emplace_back();
+		return owned.back();
+	}
+
+	std::vector<std::uint64_t>& offsets() {
+		owned_offsets.emplace_back();
+		return owned_offsets.back();
+	}
+
+	template <typename T, typename Container>
+	Column add_column(Container const& items) {
+		Column column;
+		column.kind = kind_of<T>();
+		column.unit = unit_of<T>();
+		column.count = items.size();
+
+		if constexpr (kind_of<T>() == SERIALIZED) {
+			auto& bytes = buffer();
+			auto& bounds = offsets();
+			bounds.reserve(items.size() + 1);
+			bounds.push_back(0);
+			for (std::size_t i = 0; i < items.size(); ++i) {
+				Serializer<T>::write(items[i], bytes);
+				bounds.push_back(bytes.size());
+			}
+			column.offsets = add(bounds.data(), bounds.size() * sizeof(std::uint64_t));
+			column.data = add(bytes.data(), bytes.size());
+		} else if constexpr (kind_of<T>() == RAW) {
+			if constexpr (std::ranges::contiguous_range<Container const> && std::is_same_v<std::ranges::range_value_t<Container>, T>) {
+				column.data = add(std::ranges::data(items), items.size() * sizeof(T));
+			} else {
+				auto& bytes = buffer();
+				bytes.resize(items.size() * sizeof(T));
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					T const value = items[i];
+					std::memcpy(bytes.data() + i * sizeof(T), &value, sizeof(T));
+				}
+				column.data = add(bytes.data(), bytes.size());
+			}
+		} else {
+			using Element = std::ranges::range_value_t<T>;
+			if constexpr (requires { items.data(); items.bounds(); }) {
+				// Flat population (RaggedPopulation) is written as it is
+				static_assert(sizeof(std::size_t) == sizeof(std::uint64_t));
+				column.offsets = add(items.bounds().data(), items.bounds().size_bytes());
+				column.data = add(items.data().data(), items.data().size_bytes());
+			} else {
+				auto& bounds = offsets();
+				bounds.reserve(items.size() + 1);
+				bounds.push_back(0);
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					bounds.push_back(bounds.back() + std::ranges::size(items[i]));
+				}
+				auto& bytes = buffer();
+				bytes.resize(bounds.back() * sizeof(Element));
+				for (std::size_t i = 0; i < items.size(); ++i) {
+					std::memcpy(bytes.data() + bounds[i] * sizeof(Element), std::ranges::data(items[i]), std::ranges::size(items[i]) * sizeof(Element));
+				}
+				column.offsets = add(bounds.data(), bounds.size() * sizeof(std::uint64_t));
+				column.data = add(bytes.data(), bytes.size());
+			}
+		}
+		return column;
+	}
+
+	// Into temporary file, which replaces path only when it is complete
+	void write(std::string const& path) {
+		std::string const temporary = path + ".tmp";
+		int const file = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (file < 0) throw std::system_error(errno, std::generic_category(), "Cannot create " + temporary);
+
+		// writev could write less than asked, and takes at most IOV_MAX pieces at once
+		std::size_t first = 0;
+		while (first < pieces.size()) {
+			int const amount = static_cast<int>(std::min<std::size_t>(pieces.size() - first, IOV_MAX));
+			ssize_t written = ::writev(file, pieces.data() + first, amount);
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				int const error = errno;
+				::close(file);
+				::unlink(temporary.c_str());
+				throw std::system_error(error, std::generic_category(), "Cannot write " + temporary);
+			}
+			while (written > 0) {
+				auto& piece = pieces[first];
+				std::size_t const done = std::min<std::size_t>(written, piece.iov_len);
+				piece.iov_base = static_cast<std::byte*>(piece.iov_base) + done;
+				piece.iov_len -= done;
+				written -= done;
+				if (piece.iov_len == 0) ++first;
+			}
+			while (first < pieces.size() && pieces[first].iov_len == 0) ++first;
+		}
+
+		// File is closed either way; the first error is reported
+		int error = ::fsync(file) != 0 ? errno : 0;
+		if (::close(file) != 0 && error == 0) error = errno;
+		if (error != 0) {
+			::unlink(temporary.c_str());
+			throw std::system_error(error, std::generic_category(), "Cannot write " + temporary);
+		}
+		if (::rename(temporary.c_str(), path.c_str()) != 0) {
+			error = errno;
+			::unlink(temporary.c_str());
+			throw std::system_error(error, std::generic_category(), "Cannot rename " + temporary);
+		}
+	}
+
+private:
+	std::vector<iovec> pieces;
+	std::uint64_t size = 0;
+	std::vector<std::vector<std::byte>> owned;
+	std::vector<std::vector<std::uint64_t>> owned_offsets;
+};
+
+// Read-only mapping of whole file
+class Mapping {
+public:
+	explicit Mapping(std::string const& path) {
+		int const file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0) throw std::system_error(errno, std::generic_category(), "Cannot open " + path);
+		struct stat status;
+		if (::fstat(file, &status) != 0) {
+			int const error = errno;
+			::close(file);
+			throw std::system_error(error, std::generic_category(), "Cannot stat " + path);
+		}
+		size = static_cast<std::size_t>(status.st_size);
+		if (size > 0) {
+			int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+			// Whole file is read anyway: one pass of read-ahead instead of a page fault per page
+			flags |= MAP_POPULATE;
+#endif
+			void* const mapped = ::mmap(nullptr, size, PROT_READ, flags, file, 0);
+			if (mapped == MAP_FAILED) {
+				int const error = errno;
+				::close(file);
+				throw std::system_error(error, std::generic_category(), "Cannot map " + path);
+			}
+			data = static_cast<std::byte const*>(mapped);
+		}
+		::close(file);
+	}
+	Mapping(Mapping const&) = delete;
+	Mapping& operator=(Mapping const&) = delete;
+	~Mapping() {
+		if (data) ::munmap(const_cast<std::byte*>(data), size);
+	}
+
+	template <typename T>
+	std::span<T const> section(Section const& section) const {
+		if (section.offset > size || section.size > size - section.offset || section.size % sizeof(T) != 0 || section.offset % alignof(T) != 0) {
+			throw std::runtime_error("Checkpoint is damaged: section out of file");
+		}
+		return {reinterpret_cast<T const*>(data + section.offset), static_cast<std::size_t>(section.size / sizeof(T))};
+	}
+
+	std::size_t size = 0;
+	std::byte const* data = nullptr;
+};
+
+template <typename T, typename Container>
+void read_sequences(Mapping const& mapping, Column const& column, Container& items);
+
+template <typename T, typename Container>
+void read_column(Mapping const& mapping, Column const& column, Container& items) {
+	if (column.kind != kind_of<T>() || column.unit != unit_of<T>()) {
+		throw std::runtime_error("Checkpoint was written for another type of genome or cost");
+	}
+	std::size_t const count = column.count;
+	items.clear();
+
+	if constexpr (kind_of<T>() == RAW) {
+		// Sections are aligned, so records are read in place
+		auto const records = mapping.section<T>(column.data);
+		if (records.size() != count) throw std::runtime_error("Checkpoint is damaged: wrong size of records");
+		if constexpr (requires { items.assign(records.begin(), records.end()); }) {
+			items.assign(records.begin(), records.end());
+		} else {
+			items.reserve(count);
+			for (auto const& record : records) {
+				items.push_back(record);
+			}
+		}
+	} else {
+		read_sequences<T>(mapping, column, items);
+	}
+}
+
+// RAGGED and SERIALIZED columns: offsets and data
+template <typename T, typename Container>
+void read_sequences(Mapping const& mapping, Column const& column, Container& items) {
+	std::size_t const count = column.count;
+	auto const bounds = mapping.section<std::uint64_t>(column.offsets);
+	if (bounds.size() != count + 1 || bounds.front() != 0 || !std::is_sorted(bounds.begin(), bounds.end())) {
+		throw std::runtime_error("Checkpoint is damaged: wrong offsets");
+	}
+
+	if constexpr (kind_of<T>() == SERIALIZED) {
+		auto const bytes = mapping.section<std::byte>(column.data);
+		if (bytes.size() != bounds.back()) throw std::runtime_error("Checkpoint is damaged: wrong size of data");
+		items.reserve(count);
+		for (std::size_t i = 0; i < count; ++i) {
+			items.push_back(Serializer<T>::read(bytes.subspan(bounds[i], bounds[i + 1] - bounds[i])));
+		}
+	} else {
+		using Element = std::ranges::range_value_t<T>;
+		auto const elements = mapping.section<Element>(column.data);
+		if (elements.size() != bounds.back()) throw std::runtime_error("Checkpoint is damaged: wrong size of data");
+		if constexpr (requires (std::span<std::size_t const> offsets) { items.assign(elements, offsets); }) {
+			// Flat population takes both arrays at once
+			items.assign(elements, std::span<std::size_t const>(reinterpret_cast<std::size_t const*>(bounds.data()), bounds.size()));
+		} else {
+			items.reserve(count);
+			for (std::size_t i = 0; i < count; ++i) {
+				items.push_back(T(elements.data() + bounds[i], elements.data() + bounds[i + 1]));
+			}
+		}
+	}
+}
+
+} // namespace checkpoint_format
+
+// Costs are those of the first costs.size() specimens, as in Environment::evolve
+// seed is the seed of Environment (Environment::seed()), to resume the same run
+template <typename Specimens, typename Cost>
+void save_checkpoint(std::string const& path, std::tuple<Specimens, std::size_t, std::optional<std::vector<std::size_t>>> const& generation,
+                     GenerationsCosts<Cost> const& costs, std::uint64_t seed) {
+	using namespace checkpoint_format;
+	using Genome = typename Specimens::value_type;
+	auto const& specimens = std::get<SPECIMENS_ID>(generation);
+	auto const& ages = std::get<AGE_ID>(generation);
+
+	Writer writer;
+	auto& header = writer.header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.generation_count = std::get<GENERATION_COUNT_ID>(generation);
+	header.seed = seed;
+	header.specimens = writer.add_column<Genome>(specimens);
+	header.costs = writer.add_column<Cost>(costs);
+	header.has_ages = ages.has_value();
+	if (ages) {
+		static_assert(sizeof(std::size_t) == sizeof(std::uint64_t));
+		header.ages = writer.add(ages.value().data(), ages.value().size() * sizeof(std::size_t));
+	}
+	writer.write(path);
+}
+
+template <typename Genome, typename Cost>
+void save_checkpoint(std::string const& path, Checkpoint<Genome, Cost> const& checkpoint) {
+	save_checkpoint(path, checkpoint.generation, checkpoint.costs, checkpoint.seed);
+}
+
+template <typename Genome, typename Cost>
+Checkpoint<Genome, Cost> load_checkpoint(std::string const& path) {
+	using namespace checkpoint_format;
+	Mapping const mapping(path);
+	if (mapping.size < sizeof(Header)) throw std::runtime_error("Not a checkpoint: " + path);
+	Header header;
+	std::memcpy(&header, mapping.data, sizeof(Header));
+	if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version) {
+		throw std::runtime_error("Not a checkpoint or unknown version: " + path);
+	}
+
+	Checkpoint<Genome, Cost> checkpoint;
+	checkpoint.seed = header.seed;
+	std::get<GENERATION_COUNT_ID>(checkpoint.generation) = header.generation_count;
+	read_column<Genome>(mapping, header.specimens, std::get<SPECIMENS_ID>(checkpoint.generation));
+	read_column<Cost>(mapping, header.costs, checkpoint.costs);
+	if (header.has_ages) {
+		auto const ages = mapping.section<std::size_t>(header.ages);
+		if (ages.size() != header.specimens.count) throw std::runtime_error("Checkpoint is damaged: wrong number of ages");
+		std::get<AGE_ID>(checkpoint.generation) = std::vector<std::size_t>(ages.begin(), ages.end());
+	}
+	if (checkpoint.costs.size() > header.specimens.count) throw std::runtime_error("Checkpoint is damaged: more costs than specimens");
+	return checkpoint;
+}
+
+} // namespace genetics
+
+#endif //__GENETICS_CHECKPOINT_H
@@ -0,0 +1,251 @@
+#ifndef __GENETICS_ISLANDS_H
+#define __GENETICS_ISLANDS_H
+
+// Island model: several populations evolving in parallel, exchanging their best specimens
+
+#include <atomic>
+#include <bit>
+#include <stop_token>
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+/*
+ *	Bounded single-producer single-consumer queue without locks.
+ *	Producer owns tail, consumer owns head; each only reads the other's index.
+ */
+template <typename T>
+class SpscRing {
+public:
+	explicit SpscRing(std::size_t capacity)
+	  : slots(std::bit_ceil(std::max<std::size_t>(capacity, 1))), mask(slots.size() - 1) { }
+	SpscRing(SpscRing const&) = delete;
+	SpscRing& operator=(SpscRing const&) = delete;
+
+	// false if queue is full, value is kept then
+	bool try_push(T&& value) {
+		std::size_t const tail = write_index.load(std::memory_order_relaxed);
+		if (tail - read_index.load(std::memory_order_acquire) == slots.size()) return false;
+		slots[tail & mask] = std::move(value);
+		write_index.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	std::optional<T> try_pop() {
+		std::size_t const head = read_index.load(std::memory_order_relaxed);
+		if (head == write_index.load(std::memory_order_acquire)) return std::nullopt;
+		std::optional<T> result(std::move(slots[head & mask]));
+		read_index.store(head + 1, std::memory_order_release);
+		return result;
+	}
+
+private:
+	std::vector<T> slots;
+	std::size_t const mask;
+	alignas(64) std::atomic<std::size_t> read_index{0};
+	alignas(64) std::atomic<std::size_t> write_index{0};
+};
+
+enum class MigrationTopology {
+	RING,           // island i sends to island i + 1
+	FULLY_CONNECTED // every island sends to every other one
+};
+
+/*
+ *	K islands, each one is an Environment with its own seed, on its own thread.
+ *	Every migration_interval generations an island sends copies of its best specimens to its neighbours
+ *	and takes in whatever has arrived to it; migrants compete as usual at the next elimination.
+ *	Sending never waits: if receiver has not taken previous migrants yet, new ones are dropped.
+ *	Evolution ends when any island finds a good enough specimen (others stop before their next generation) or all islands reach max_generations().
+ *
+ *	Factories are called once per island (with its index); they may return the same object,
+ *	if it can be used from several threads at once.
+ *	Because of migration timing, result depends on scheduling even with fixed seed (islands alone don't).
+ */
+template <typename Genome, typename Cost>
+class Islands {
+public:
+	using CrossoverFactory = std::function<std::shared_ptr<ICrossover<Genome, Cost>>(std::size_t island)>;
+	using SelectionFactory = std::function<std::shared_ptr<ISelection<Genome, Cost>>(std::size_t island)>;
+
+	// fitness(island) returns either IFitness or IPointwiseFitness
+	template <typename FitnessFactory>
+	requires std::invocable<FitnessFactory&, std::size_t>
+	Islands(FitnessFactory fitness,
+	        CrossoverFactory crossover,
+	        SelectionFactory selection,
+	        std::size_t number_of_islands,
+	        std::optional<std::uint64_t> seed = std::nullopt,
+	        std::size_t threads_per_island = 1)
+	  : pool(std::max<std::size_t>(number_of_islands, 1))
+	  , run_seed(seed ? seed.value() : random_seed()) {
+		for (std::size_t island = 0; island < pool.size(); ++island) {
+			selections.push_back(selection(island));
+			environments.push_back(std::make_unique<Environment<Genome, Cost>>(
+				fitness(island), crossover(island), selections.back(), threads_per_island, mix_bits(run_seed + island)));
+			senders.push_back(std::make_unique<ThreadPool>(1));
+		}
+		set_migration(10, 1, MigrationTopology::RING);
+	}
+
+	std::size_t size() const { return environments.size(); }
+	std::uint64_t seed() const { return run_seed; }
+
+	// For tuning of each island (streaming, fitness grain etc.)
+	Environment<Genome, Cost>& island(std::size_t index) { return *environments[index]; }
+
+	void set_migration(std::size_t interval, std::size_t migrants, MigrationTopology topology) {
+		migration_interval = std::max<std::size_t>(interval, 1);
+		migrants_amount = migrants;
+		channels.clear();
+		outgoing.assign(size(), {});
+		incoming.assign(size(), {});
+		auto const connect = [this](std::size_t from, std::size_t to) {
+			outgoing[from].push_back(channels.size());
+			incoming[to].push_back(channels.size());
+			channels.push_back(std::make_unique<SpscRing<Migrants>>(channel_capacity));
+		};
+		for (std::size_t from = 0; from < size() && size() > 1; ++from) {
+			if (topology == MigrationTopology::RING) {
+				connect(from, (from + 1) % size());
+			} else {
+				for (std::size_t to = 0; to < size(); ++to) {
+					if (to != from) connect(from, to);
+				}
+			}
+		}
+	}
+
+	// Every island starts with a copy of generation
+	std::vector<Generation<Genome>> evolve(Generation<Genome> const& generation) {
+		return evolve(std::vector<Generation<Genome>>(size(), generation));
+	}
+
+	std::vector<Generation<Genome>> evolve(std::vector<Generation<Genome>> generations) {
+		std::vector<GenerationsCosts<Cost>> costs(size());
+		return evolve(std::move(generations), costs);
+	}
+
+	// One generation and its known costs per island, as in Environment::evolve
+	// Index of island with the best specimen is best_island() afterwards
+	// Island stopped before its first epoch keeps its generation as is (and its costs could be empty)
+	std::vector<Generation<Genome>> evolve(std::vector<Generation<Genome>> generations, std::vector<GenerationsCosts<Cost>>& costs) {
+		assert(generations.size() == size());
+		costs.resize(size());
+		std::stop_source stop;
+
+		pool.parallel_for(size(), [&](std::size_t island, std::size_t) {
+			try {
+				run_island(island, generations[island], costs[island], stop);
+			} catch (...) {
+				stop.request_stop();
+				throw;
+			}
+		});
+
+		// Migrants that were not taken in are not needed anymore
+		for (auto& channel : channels) {
+			while (channel->try_pop()) { }
+		}
+
+		// First survivor is not the best one with objectives, so all survivors are looked at
+		best = 0;
+		std::optional<Cost> best_cost;
+		for (std::size_t island = 0; island < size(); ++island) {
+			if (costs[island].empty()) continue;
+			auto const island_best = std::min_element(costs[island].begin(), costs[island].end());
+			if (!best_cost || *island_best < best_cost.value()) {
+				best = island;
+				best_cost = *island_best;
+			}
+		}
+		return generations;
+	}
+
+	std::size_t best_island() const { return best; }
+
+private:
+	struct Migrants {
+		Population<Genome> specimens;
+		std::vector<std::size_t> ages;
+	};
+
+	// Several batches could be in flight when receiver is slower than sender
+	static std::size_t constexpr channel_capacity = 4;
+
+	ThreadPool pool;
+	std::uint64_t run_seed;
+	std::vector<std::shared_ptr<ISelection<Genome, Cost>>> selections;
+	std::vector<std::unique_ptr<Environment<Genome, Cost>>> environments;
+	std::vector<std::unique_ptr<ThreadPool>> senders; // of each island: migrants are chosen on its own thread
+
+	std::size_t migration_interval = 0;
+	std::size_t migrants_amount = 0;
+	std::vector<std::unique_ptr<SpscRing<Migrants>>> channels;
+	std::vector<std::vector<std::size_t>> outgoing, incoming; // channels of each island
+	std::size_t best = 0;
+
+	void run_island(std::size_t island, Generation<Genome>& generation, GenerationsCosts<Cost>& costs, std::stop_source& stop) {
+		auto& environment = *environments[island];
+		auto const& generation_count = std::get<GENERATION_COUNT_ID>(generation);
+		auto const max_generations = selections[island]->max_generations();
+		std::size_t const starting_generation = generation_count;
+
+		while (!stop.stop_requested()) {
+			receive(island, generation);
+
+			std::size_t epoch = migration_interval;
+			if (max_generations) {
+				epoch = std::min(epoch, max_generations.value() - (generation_count - starting_generation));
+			}
+			if (environment.advance(generation, costs, epoch, stop.get_token())) {
+				stop.request_stop();
+				return;
+			}
+			if (max_generations && generation_count - starting_generation >= max_generations.value()) {
+				return;
+			}
+
+			send(island, generation, costs);
+		}
+	}
+
+	// Best specimens among those with known costs
+	void send(std::size_t island, Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs) {
+		if (outgoing[island].empty() || migrants_amount == 0) return;
+		auto const& specimens = std::get<SPECIMENS_ID>(generation);
+		auto const& ages = std::get<AGE_ID>(generation);
+
+		auto const chosen = select_best(costs, migrants_amount, *senders[island]);
+		if (chosen.empty()) return;
+
+		for (std::size_t channel : outgoing[island]) {
+			Migrants migrants;
+			migrants.specimens.reserve(chosen.size());
+			for (std::size_t index : chosen) {
+				migrants.specimens.emplace_back(specimens[index]);
+				migrants.ages.push_back(ages ? ages.value()[index] : 0);
+			}
+			channels[channel]->try_push(std::move(migrants));
+		}
+	}
+
+	// Migrants go to the end, their costs are computed by fitness of this island
+	void receive(std::size_t island, Generation<Genome>& generation) {
+		auto& specimens = std::get<SPECIMENS_ID>(generation);
+		auto& ages = std::get<AGE_ID>(generation);
+		for (std::size_t channel : incoming[island]) {
+			while (auto migrants = channels[channel]->try_pop()) {
+				splice(specimens, migrants->specimens);
+				if (ages) {
+					ages.value().insert(ages.value().end(), migrants->ages.begin(), migrants->ages.end());
+				}
+			}
+		}
+	}
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_ISLANDS_H
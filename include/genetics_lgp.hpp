@@ -0,0 +1,711 @@
+#ifndef __GENETICS_LGP_H
+#define __GENETICS_LGP_H
+
+// Linear genetic programming: register-machine programs, their vectorized interpreter over a dataset, and crossover with mutations
+
+#include <vector>
+#include <span>
+#include <array>
+#include <bit>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <concepts>
+#include <ostream>
+#include <stdexcept>
+
+#include "genetics.hpp"
+#include "genetics_cache.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GENETICS_LGP_X86
+#include <immintrin.h>
+#endif
+
+namespace genetics {
+
+enum class LinearOp : std::uint8_t {
+	ADD,          // r = a + b
+	SUB,          // r = a - b
+	MUL,          // r = a * b
+	DIV,          // r = a / b, or a if |b| < 1e-6 (protected division)
+	MIN,          // r = a < b ? a : b
+	MAX,          // r = a > b ? a : b
+	ADD_CONSTANT, // r = a + c
+	MUL_CONSTANT, // r = a * c
+	SET_CONSTANT  // r = c
+};
+
+inline constexpr std::size_t linear_ops = 9;
+
+/*
+ *	One instruction of register machine: destination = source1 op source2 (or constant).
+ *	Sources are registers or, with INPUT bit, inputs (columns of dataset); inputs are read-only.
+ *	Trivially copyable, so programs go as they are into RaggedPopulation, checkpoints and worker processes.
+ */
+struct LinearInstruction {
+	static constexpr std::uint8_t INPUT = 0x80;
+
+	LinearOp op;
+	std::uint8_t destination;
+	std::uint8_t source1, source2;
+	float constant;
+
+	bool operator==(LinearInstruction const&) const = default;
+};
+
+static_assert(std::is_trivially_copyable_v<LinearInstruction> && sizeof(LinearInstruction) == 8);
+
+// Instructions are executed in order; register 0 is the output, all registers start with 0
+using LinearProgram = std::vector<LinearInstruction>;
+
+inline bool reads_source1(LinearOp op) { return op != LinearOp::SET_CONSTANT; }
+inline bool reads_source2(LinearOp op) { return op < LinearOp::ADD_CONSTANT; }
+
+struct LinearMachine {
+	std::size_t registers = 8; // at most 64
+	std::size_t inputs = 1;    // at most 128
+	std::size_t max_length = 64;
+	float min_constant = -10.f, max_constant = 10.f;
+};
+
+inline std::uint8_t random_linear_source(LinearMachine const& machine, RandomStream& random) {
+	if (machine.inputs > 0 && random.get_random_int<int>(0, 1)) {
+		return static_cast<std::uint8_t>(LinearInstruction::INPUT | random.get_random_int<std::size_t>(0, machine.inputs - 1));
+	}
+	return static_cast<std::uint8_t>(random.get_random_int<std::size_t>(0, machine.registers - 1));
+}
+
+inline LinearInstruction random_linear_instruction(LinearMachine const& machine, RandomStream& random) {
+	LinearInstruction instruction;
+	instruction.op = static_cast<LinearOp>(random.get_random_int<std::size_t>(0, linear_ops - 1));
+	instruction.destination = static_cast<std::uint8_t>(random.get_random_int<std::size_t>(0, machine.registers - 1));
+	instruction.source1 = random_linear_source(machine, random);
+	instruction.source2 = random_linear_source(machine, random);
+	instruction.constant = random.get_random_float<float>(machine.min_constant, machine.max_constant);
+	return instruction;
+}
+
+inline LinearProgram random_linear_program(LinearMachine const& machine, std::size_t length, RandomStream& random) {
+	LinearProgram program(std::max<std::size_t>(1, std::min(length, machine.max_length)));
+	for (auto& instruction : program) {
+		instruction = random_linear_instruction(machine, random);
+	}
+	return program;
+}
+
+inline std::ostream& print_linear_source(std::ostream& os, std::uint8_t source) {
+	if (source & LinearInstruction::INPUT) return os << 'x' << (source & ~LinearInstruction::INPUT);
+	return os << 'r' << int(source);
+}
+
+// As a line of code, e.g. "r0 = r1 * x0;"
+inline std::ostream& operator<<(std::ostream& os, LinearInstruction const& instruction) {
+	static char const* const infix[] = {" + ", " - ", " * ", " / "};
+	os << 'r' << int(instruction.destination) << " = ";
+	switch (instruction.op) {
+	case LinearOp::ADD: case LinearOp::SUB: case LinearOp::MUL: case LinearOp::DIV:
+		print_linear_source(os, instruction.source1) << infix[static_cast<int>(instruction.op)];
+		print_linear_source(os, instruction.source2);
+		break;
+	case LinearOp::MIN: case LinearOp::MAX:
+		os << (instruction.op == LinearOp::MIN ? "min(" : "max(");
+		print_linear_source(os, instruction.source1) << ", ";
+		print_linear_source(os, instruction.source2) << ')';
+		break;
+	case LinearOp::ADD_CONSTANT: case LinearOp::MUL_CONSTANT:
+		print_linear_source(os, instruction.source1) << (instruction.op == LinearOp::ADD_CONSTANT ? " + " : " * ") << instruction.constant;
+		break;
+	case LinearOp::SET_CONSTANT:
+		os << instruction.constant;
+		break;
+	}
+	return os << ';';
+}
+
+// Whether instruction affects registers of needed (bit mask) after it; if so, needed becomes registers it depends on
+inline bool effective_instruction(LinearInstruction const& instruction, std::uint64_t& needed) {
+	std::uint64_t const written = std::uint64_t(1) << instruction.destination;
+	if (!(needed & written)) return false;
+	needed &= ~written;
+	if (reads_source1(instruction.op) && !(instruction.source1 & LinearInstruction::INPUT)) needed |= std::uint64_t(1) << instruction.source1;
+	if (reads_source2(instruction.op) && !(instruction.source2 & LinearInstruction::INPUT)) needed |= std::uint64_t(1) << instruction.source2;
+	return true;
+}
+
+// Indices of instructions of [first, end), which affect registers of needed at the end; the rest are introns.
+// Returns registers, which are read before first
+inline std::uint64_t effective_instructions(std::span<LinearInstruction const> program, std::size_t first, std::uint64_t needed,
+                                            std::vector<std::uint32_t>& out) {
+	out.clear();
+	for (std::size_t i = program.size(); i-- > first && needed; ) {
+		if (effective_instruction(program[i], needed)) out.push_back(static_cast<std::uint32_t>(i));
+	}
+	std::reverse(out.begin(), out.end());
+	return needed;
+}
+
+// Hash of prefix, as it is computed instruction by instruction by the interpreter
+struct LinearPrefixHash {
+	static std::uint64_t step(std::uint64_t hash, LinearInstruction const& instruction) {
+		std::uint64_t bits;
+		std::memcpy(&bits, &instruction, sizeof(bits));
+		return mix_bits(hash ^ bits);
+	}
+
+	template <typename Prefix>
+	std::size_t operator()(Prefix const& prefix) const {
+		std::uint64_t hash = 0;
+		for (auto const& instruction : prefix) {
+			hash = step(hash, instruction);
+		}
+		return static_cast<std::size_t>(hash);
+	}
+};
+
+/*
+ *	Sum of squared errors of linear programs over a dataset: rows of inputs and outputs, register 0 is compared with output.
+ *	One program runs over a block of rows at a time, instruction by instruction, each over the whole block (columns go along SIMD lanes);
+ *	registers of a block stay in L1. Kernels use AVX-512, AVX2, or scalar code; the best supported one is chosen at run time.
+ *	Only effective instructions are executed (those, which affect register 0 at the end: introns are skipped).
+ *	Result is the same with every instruction set: operations are exact IEEE ones, and errors are summed as in PolynomialErrors
+ *	(error of row j goes to partial sum j % LANES, partial sums are added in one fixed order). NaN error becomes infinity.
+ *	Few rows waste lanes: blocks are at least LANES wide.
+ *
+ *	Prefix cache (off by default): registers of all rows after prefixes of stride, 2 * stride, ... instructions, so a program,
+ *	which starts as an already evaluated one (offspring start as their first parent, see LinearCrossover), runs only from
+ *	the longest known prefix. Only registers, which are live after the prefix, are kept, and they are copied in and out,
+ *	so a prefix is used only if more of its instructions are effective, than it has live registers; and it is kept only
+ *	when it is asked for the second time (most programs die, and their prefixes are never asked for again).
+ *	So cache pays off, when effective code is long (runs with bloat, few registers); short programs pay only for hashing.
+ */
+class LinearInterpreter {
+public:
+	enum class Isa { SCALAR, AVX2, AVX512 };
+
+	static constexpr std::size_t LANES = 16;  // Partial sums
+	static constexpr std::size_t BLOCK = 256; // Rows per pass of a program
+
+	// Isa is clamped to the one the processor supports
+	LinearInterpreter(LinearMachine const& machine, std::vector<std::vector<float>> const& inputs, std::vector<float> const& outputs,
+	                  Isa isa = best_isa())
+	  : machine(machine), rows(outputs.size()), isa(std::min(isa, best_isa())) {
+		if (machine.registers == 0 || machine.registers > 64 || machine.inputs > 128) {
+			throw std::invalid_argument("Linear machine must have 1 to 64 registers and at most 128 inputs");
+		}
+		if (inputs.size() != rows) throw std::invalid_argument("Rows of inputs and outputs differ");
+		padded = std::max<std::size_t>(1, (rows + LANES - 1) / LANES) * LANES;
+		block = std::min(BLOCK, padded);
+		padded = (padded + block - 1) / block * block;
+		columns.assign(machine.inputs * padded, 0.f);
+		ys.assign(padded, 0.f);
+		for (std::size_t j = 0; j < rows; ++j) {
+			if (inputs[j].size() != machine.inputs) throw std::invalid_argument("Row of inputs has wrong size");
+			for (std::size_t i = 0; i < machine.inputs; ++i) {
+				columns[i * padded + j] = inputs[j][i];
+			}
+			ys[j] = outputs[j];
+		}
+	}
+
+	// One input: points (x, y)
+	LinearInterpreter(LinearMachine const& machine, std::vector<std::pair<float, float>> const& target, Isa isa = best_isa())
+	  : LinearInterpreter(machine, inputs_of(target), outputs_of(target), isa) { }
+
+	static Isa best_isa() {
+#ifdef GENETICS_LGP_X86
+		static Isa const supported = __builtin_cpu_supports("avx512f") ? Isa::AVX512
+		                           : __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? Isa::AVX2
+		                           : Isa::SCALAR;
+		return supported;
+#else
+		return Isa::SCALAR;
+#endif
+	}
+
+	static bool has_fma() {
+#ifdef GENETICS_LGP_X86
+		static bool const supported = __builtin_cpu_supports("fma");
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	Isa instruction_set() const { return isa; }
+	std::size_t size() const { return rows; }
+	LinearMachine const& linear_machine() const { return machine; }
+
+	// Registers after prefixes of multiples of stride instructions are cached, in at most bytes; 0 bytes turn cache off
+	void set_prefix_cache(std::size_t bytes, std::size_t stride = 16) {
+		std::size_t const entries = bytes / (machine.registers * padded * sizeof(float));
+		cache = entries ? std::make_unique<PrefixCache>(entries) : nullptr;
+		cache_stride = std::max<std::size_t>(1, stride);
+		seen_size = entries ? 4 * entries : 0;
+		seen = entries ? std::make_unique<std::atomic<std::uint64_t>[]>(seen_size) : nullptr;
+	}
+	FitnessCacheStatistics prefix_cache_statistics() const { return cache ? cache->statistics() : FitnessCacheStatistics{}; }
+
+	// Sum of squared errors; throws std::invalid_argument, if program uses registers or inputs, which machine doesn't have
+	float operator()(std::span<LinearInstruction const> program) const {
+		return run(program, nullptr);
+	}
+
+	// Register 0 at every row
+	void predict(std::span<LinearInstruction const> program, std::span<float> out) const {
+		if (out.size() < rows) throw std::invalid_argument("Not enough room for outputs");
+		run(program, out.data());
+	}
+
+private:
+	// Registers of all rows after a prefix, only those, which were live after it in the program, which kept them
+	struct PrefixState {
+		std::uint64_t registers;
+		std::vector<float> values; // of block b, i-th register of registers at (b * count + i) * block
+
+		// Registers of mask (all of them are here) to block of registers
+		void restore(std::uint64_t mask, std::size_t block_index, std::size_t block, float* block_registers) const {
+			float const* state = values.data() + block_index * std::popcount(registers) * block;
+			for (std::uint64_t rest = registers; rest; rest &= rest - 1, state += block) {
+				std::size_t const r = static_cast<std::size_t>(std::countr_zero(rest));
+				if (mask & (std::uint64_t(1) << r)) std::copy_n(state, block, block_registers + r * block);
+			}
+		}
+		void save(std::size_t block_index, std::size_t block, float const* block_registers) {
+			float* state = values.data() + block_index * std::popcount(registers) * block;
+			for (std::uint64_t rest = registers; rest; rest &= rest - 1, state += block) {
+				std::copy_n(block_registers + std::countr_zero(rest) * block, block, state);
+			}
+		}
+	};
+	using State = std::shared_ptr<PrefixState const>;
+	using PrefixCache = FitnessCache<LinearProgram, State, LinearPrefixHash>;
+
+	LinearMachine machine;
+	std::size_t rows, padded, block;
+	Isa isa;
+	std::vector<float> columns, ys; // Padded with zeros up to whole blocks
+	std::unique_ptr<PrefixCache> cache;
+	std::size_t cache_stride = 16;
+	std::unique_ptr<std::atomic<std::uint64_t>[]> seen; // Hashes of prefixes asked for, direct-mapped
+	std::size_t seen_size = 0;
+
+	static std::vector<std::vector<float>> inputs_of(std::vector<std::pair<float, float>> const& target) {
+		std::vector<std::vector<float>> inputs;
+		for (auto const& point : target) inputs.push_back({point.first});
+		return inputs;
+	}
+	static std::vector<float> outputs_of(std::vector<std::pair<float, float>> const& target) {
+		std::vector<float> outputs;
+		for (auto const& point : target) outputs.push_back(point.second);
+		return outputs;
+	}
+
+	void validate(std::span<LinearInstruction const> program) const {
+		auto const valid = [this](std::uint8_t source) {
+			return (source & LinearInstruction::INPUT) ? std::size_t(source & ~LinearInstruction::INPUT) < machine.inputs : source < machine.registers;
+		};
+		for (auto const& instruction : program) {
+			if (static_cast<std::size_t>(instruction.op) >= linear_ops || instruction.destination >= machine.registers
+			    || (reads_source1(instruction.op) && !valid(instruction.source1)) || (reads_source2(instruction.op) && !valid(instruction.source2))) {
+				throw std::invalid_argument("Linear program doesn't fit its machine");
+			}
+		}
+	}
+
+	// Scratch of a thread, valid till its next call
+	struct Scratch {
+		std::vector<float> registers;
+		std::vector<std::uint32_t> effective;
+		std::vector<std::size_t> effective_after; // effective instructions after checkpoints, from the last one
+		std::vector<float const*> inputs;
+		std::vector<std::uint64_t> hashes, live; // of prefixes, which end at checkpoints
+	};
+
+	float run(std::span<LinearInstruction const> program, float* prediction) const {
+		validate(program);
+		thread_local Scratch scratch;
+		std::size_t const registers = machine.registers;
+		scratch.registers.resize(registers * block);
+		scratch.inputs.resize(machine.inputs);
+
+		// Longest cached prefix, which is worth it; then the longest prefix after it, which was asked for before, is kept (at most one per run)
+		State known;
+		std::size_t start = 0, keep = 0;
+		std::uint64_t keep_hash = 0, restored = 0, kept_registers = 0;
+		if (cache && !prediction) {
+			// Registers live after a prefix; state after it pays off only if it saves more effective instructions, than registers it brings
+			std::size_t const checkpoints = program.empty() ? 0 : (program.size() - 1) / cache_stride;
+			auto& live = scratch.live;
+			live.assign(checkpoints, 0);
+			std::uint64_t needed = 1;
+			std::size_t effective = 0;
+			for (std::size_t i = program.size(); i-- > 0 && needed; ) {
+				if ((i + 1) % cache_stride == 0 && i + 1 < program.size()) {
+					live[i / cache_stride] = needed;
+					scratch.effective_after.push_back(effective);
+				}
+				if (effective_instruction(program[i], needed)) ++effective;
+			}
+			std::size_t worth = 0; // checkpoints up to the last one, which is worth it
+			for (std::size_t k = checkpoints, j = 0; k-- > 0; ) {
+				if (!live[k]) continue;
+				if (effective - scratch.effective_after[j++] <= static_cast<std::size_t>(std::popcount(live[k]))) {
+					live[k] = 0;
+				} else {
+					worth = std::max(worth, k + 1);
+				}
+			}
+			scratch.effective_after.clear();
+
+			auto& hashes = scratch.hashes;
+			hashes.clear();
+			std::uint64_t hash = 0;
+			for (std::size_t i = 0; i < worth * cache_stride; ++i) {
+				hash = LinearPrefixHash::step(hash, program[i]);
+				if ((i + 1) % cache_stride == 0) hashes.push_back(hash);
+			}
+			for (std::size_t k = hashes.size(); k-- > 0; ) {
+				if (!live[k]) continue;
+				std::size_t const length = (k + 1) * cache_stride;
+				auto state = cache->find(program.first(length), static_cast<std::size_t>(hashes[k]));
+				if (state && (live[k] & ~state.value()->registers) == 0) {
+					known = std::move(state.value());
+					start = length;
+					restored = live[k];
+					break;
+				}
+			}
+			for (std::size_t k = start / cache_stride; k < hashes.size(); ++k) {
+				if (live[k] && seen_before(hashes[k])) {
+					keep = (k + 1) * cache_stride;
+					keep_hash = hashes[k];
+					kept_registers = live[k];
+				}
+			}
+		}
+
+		// State to keep is taken between effective instructions of its prefix and the rest
+		effective_instructions(program, start, 1, scratch.effective);
+		std::size_t const split = keep ? static_cast<std::size_t>(
+			std::lower_bound(scratch.effective.begin(), scratch.effective.end(), static_cast<std::uint32_t>(keep)) - scratch.effective.begin()) : 0;
+		std::span<std::uint32_t const> const before(scratch.effective.data(), split), after(scratch.effective.data() + split, scratch.effective.size() - split);
+		std::shared_ptr<PrefixState> kept;
+		if (keep) {
+			kept = std::make_shared<PrefixState>();
+			kept->registers = kept_registers;
+			kept->values.resize(std::popcount(kept_registers) * padded);
+		}
+
+		float partial[LANES] = {};
+		for (std::size_t first_row = 0; first_row < padded; first_row += block) {
+			std::size_t const block_index = first_row / block;
+			float* const block_registers = scratch.registers.data();
+			if (known) {
+				known->restore(restored, block_index, block, block_registers);
+			} else {
+				std::fill_n(block_registers, registers * block, 0.f);
+			}
+			for (std::size_t i = 0; i < machine.inputs; ++i) {
+				scratch.inputs[i] = columns.data() + i * padded + first_row;
+			}
+
+			execute(program.data(), before, block_registers, scratch.inputs.data());
+			if (kept) kept->save(block_index, block, block_registers);
+			execute(program.data(), after, block_registers, scratch.inputs.data());
+
+			std::size_t const valid = std::min(block, rows - std::min(rows, first_row));
+			accumulate(block_registers, ys.data() + first_row, valid, partial);
+			if (prediction) std::copy_n(block_registers, valid, prediction + first_row);
+		}
+		if (kept) cache->insert(program.first(keep), static_cast<std::size_t>(keep_hash), State(std::move(kept)));
+
+		float const error = reduce(partial);
+		return std::isnan(error) ? INFINITY : error;
+	}
+
+	// Whether prefix was asked for since its slot was taken last time; most programs die unused, so their prefixes are not kept
+	bool seen_before(std::uint64_t hash) const {
+		hash |= 1; // 0 is an empty slot
+		return seen[hash % seen_size].exchange(hash, std::memory_order_relaxed) == hash;
+	}
+
+	// The fixed order of summation, as in PolynomialErrors
+	static float reduce(float const (&partial)[LANES]) {
+		float sums[LANES / 2];
+		for (std::size_t i = 0; i < LANES / 2; ++i) sums[i] = partial[i] + partial[i + LANES / 2];
+		for (std::size_t width = LANES / 4; width > 0; width /= 2) {
+			for (std::size_t i = 0; i < width; ++i) sums[i] += sums[i + width];
+		}
+		return sums[0];
+	}
+
+	float const* source(std::uint8_t operand, float const* registers, float const* const* inputs) const {
+		return (operand & LinearInstruction::INPUT) ? inputs[operand & ~LinearInstruction::INPUT] : registers + operand * block;
+	}
+
+	void execute(LinearInstruction const* program, std::span<std::uint32_t const> indices, float* registers, float const* const* inputs) const {
+		switch (isa) {
+#ifdef GENETICS_LGP_X86
+		case Isa::AVX512:
+			return execute_avx512(program, indices, registers, inputs);
+		case Isa::AVX2:
+			return execute_avx2(program, indices, registers, inputs);
+#endif
+		default:
+			return execute_scalar(program, indices, registers, inputs);
+		}
+	}
+
+	// Errors of valid rows of the block go to partial sums: row j to j % LANES (blocks are whole numbers of LANES)
+	void accumulate(float const* output, float const* y, std::size_t valid, float (&partial)[LANES]) const {
+		switch (isa) {
+#ifdef GENETICS_LGP_X86
+		case Isa::AVX512:
+			return accumulate_avx512(output, y, valid, partial);
+		case Isa::AVX2:
+			return accumulate_avx2(output, y, valid, partial);
+#endif
+		default:
+#ifdef GENETICS_LGP_X86
+			if (has_fma()) return accumulate_scalar_fma(output, y, valid, partial);
+#endif
+			return accumulate_scalar(output, y, valid, partial);
+		}
+	}
+
+	static constexpr float tiny = 1e-6f; // Protected division returns dividend for smaller divisors
+
+	void execute_scalar(LinearInstruction const* program, std::span<std::uint32_t const> indices, float* registers, float const* const* inputs) const {
+		for (std::uint32_t index : indices) {
+			auto const& instruction = program[index];
+			float* const r = registers + instruction.destination * block;
+			float const* const a = source(instruction.source1, registers, inputs);
+			float const* const b = source(instruction.source2, registers, inputs);
+			float const c = instruction.constant;
+			switch (instruction.op) {
+			case LinearOp::ADD: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] + b[j]; break;
+			case LinearOp::SUB: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] - b[j]; break;
+			case LinearOp::MUL: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] * b[j]; break;
+			case LinearOp::DIV: for (std::size_t j = 0; j < block; ++j) r[j] = std::fabs(b[j]) < tiny ? a[j] : a[j] / b[j]; break;
+			case LinearOp::MIN: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] < b[j] ? a[j] : b[j]; break;
+			case LinearOp::MAX: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] > b[j] ? a[j] : b[j]; break;
+			case LinearOp::ADD_CONSTANT: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] + c; break;
+			case LinearOp::MUL_CONSTANT: for (std::size_t j = 0; j < block; ++j) r[j] = a[j] * c; break;
+			case LinearOp::SET_CONSTANT: std::fill_n(r, block, c); break;
+			}
+		}
+	}
+
+	// Inlined into accumulate_scalar_fma, std::fma becomes an instruction there; elsewhere it is a call into the library
+	__attribute__((always_inline))
+	void accumulate_scalar(float const* output, float const* y, std::size_t valid, float (&partial)[LANES]) const {
+		for (std::size_t j = 0; j < valid; ++j) {
+			float const difference = y[j] - output[j];
+			partial[j % LANES] = std::fma(difference, difference, partial[j % LANES]);
+		}
+	}
+
+#ifdef GENETICS_LGP_X86
+	__attribute__((target("fma")))
+	void accumulate_scalar_fma(float const* output, float const* y, std::size_t valid, float (&partial)[LANES]) const {
+		accumulate_scalar(output, y, valid, partial);
+	}
+
+	// minps and maxps give the second operand, if either is NaN: as the scalar a < b ? a : b does
+	__attribute__((target("avx512f")))
+	void execute_avx512(LinearInstruction const* program, std::span<std::uint32_t const> indices, float* registers, float const* const* inputs) const {
+		__m512 const small = _mm512_set1_ps(tiny);
+		for (std::uint32_t index : indices) {
+			auto const& instruction = program[index];
+			float* const r = registers + instruction.destination * block;
+			float const* const a = source(instruction.source1, registers, inputs);
+			float const* const b = source(instruction.source2, registers, inputs);
+			__m512 const c = _mm512_set1_ps(instruction.constant);
+			switch (instruction.op) {
+			case LinearOp::ADD: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_add_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j))); break;
+			case LinearOp::SUB: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_sub_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j))); break;
+			case LinearOp::MUL: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_mul_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j))); break;
+			case LinearOp::DIV:
+				for (std::size_t j = 0; j < block; j += 16) {
+					__m512 const dividend = _mm512_loadu_ps(a + j), divisor = _mm512_loadu_ps(b + j);
+					__mmask16 const protect = _mm512_cmp_ps_mask(_mm512_abs_ps(divisor), small, _CMP_LT_OQ);
+					_mm512_storeu_ps(r + j, _mm512_mask_blend_ps(protect, _mm512_div_ps(dividend, divisor), dividend));
+				}
+				break;
+			case LinearOp::MIN: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_min_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j))); break;
+			case LinearOp::MAX: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_max_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j))); break;
+			case LinearOp::ADD_CONSTANT: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_add_ps(_mm512_loadu_ps(a + j), c)); break;
+			case LinearOp::MUL_CONSTANT: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, _mm512_mul_ps(_mm512_loadu_ps(a + j), c)); break;
+			case LinearOp::SET_CONSTANT: for (std::size_t j = 0; j < block; j += 16) _mm512_storeu_ps(r + j, c); break;
+			}
+		}
+	}
+
+	__attribute__((target("avx512f")))
+	void accumulate_avx512(float const* output, float const* y, std::size_t valid, float (&partial)[LANES]) const {
+		__m512 sums = _mm512_loadu_ps(partial);
+		for (std::size_t j = 0; j < valid; j += LANES) {
+			__mmask16 const mask = valid - j >= LANES ? __mmask16(0xFFFF) : __mmask16((1u << (valid - j)) - 1);
+			__m512 const difference = _mm512_maskz_sub_ps(mask, _mm512_loadu_ps(y + j), _mm512_loadu_ps(output + j));
+			sums = _mm512_fmadd_ps(difference, difference, sums);
+		}
+		_mm512_storeu_ps(partial, sums);
+	}
+
+	__attribute__((target("avx2")))
+	void execute_avx2(LinearInstruction const* program, std::span<std::uint32_t const> indices, float* registers, float const* const* inputs) const {
+		__m256 const small = _mm256_set1_ps(tiny), sign = _mm256_set1_ps(-0.f);
+		for (std::uint32_t index : indices) {
+			auto const& instruction = program[index];
+			float* const r = registers + instruction.destination * block;
+			float const* const a = source(instruction.source1, registers, inputs);
+			float const* const b = source(instruction.source2, registers, inputs);
+			__m256 const c = _mm256_set1_ps(instruction.constant);
+			switch (instruction.op) {
+			case LinearOp::ADD: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_add_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j))); break;
+			case LinearOp::SUB: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j))); break;
+			case LinearOp::MUL: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_mul_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j))); break;
+			case LinearOp::DIV:
+				for (std::size_t j = 0; j < block; j += 8) {
+					__m256 const dividend = _mm256_loadu_ps(a + j), divisor = _mm256_loadu_ps(b + j);
+					__m256 const protect = _mm256_cmp_ps(_mm256_andnot_ps(sign, divisor), small, _CMP_LT_OQ);
+					_mm256_storeu_ps(r + j, _mm256_blendv_ps(_mm256_div_ps(dividend, divisor), dividend, protect));
+				}
+				break;
+			case LinearOp::MIN: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_min_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j))); break;
+			case LinearOp::MAX: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_max_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j))); break;
+			case LinearOp::ADD_CONSTANT: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_add_ps(_mm256_loadu_ps(a + j), c)); break;
+			case LinearOp::MUL_CONSTANT: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, _mm256_mul_ps(_mm256_loadu_ps(a + j), c)); break;
+			case LinearOp::SET_CONSTANT: for (std::size_t j = 0; j < block; j += 8) _mm256_storeu_ps(r + j, c); break;
+			}
+		}
+	}
+
+	// Two registers of 8 lanes make the 16 partial sums
+	__attribute__((target("avx2,fma")))
+	void accumulate_avx2(float const* output, float const* y, std::size_t valid, float (&partial)[LANES]) const {
+		alignas(32) static constexpr int ones[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+		__m256 sums[2] = {_mm256_loadu_ps(partial), _mm256_loadu_ps(partial + 8)};
+		for (std::size_t j = 0; j < valid; j += LANES) {
+			std::size_t const count = std::min(LANES, valid - j);
+			for (std::size_t half = 0; half < 2; ++half) {
+				std::size_t const lanes = std::min<std::size_t>(8, count - std::min<std::size_t>(count, 8 * half));
+				__m256 const mask = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(ones + 8 - lanes)));
+				__m256 const difference = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(y + j + 8 * half), _mm256_loadu_ps(output + j + 8 * half)), mask);
+				sums[half] = _mm256_fmadd_ps(difference, difference, sums[half]);
+			}
+		}
+		_mm256_storeu_ps(partial, sums[0]);
+		_mm256_storeu_ps(partial + 8, sums[1]);
+	}
+#endif
+};
+
+/*
+ *	Pointwise fitness of linear programs: cost is made of squared error over the dataset of interpreter and length of program,
+ *	as Cost(error, length). Program is read in place, so population could be RaggedPopulation of LinearInstruction.
+ */
+template <typename Cost>
+requires std::constructible_from<Cost, float, std::size_t>
+class LinearProgramFitness : public IPointwiseFitness<LinearProgram, Cost> {
+public:
+	explicit LinearProgramFitness(LinearInterpreter interpreter) : interpreter(std::move(interpreter)) { }
+	~LinearProgramFitness() override = default;
+
+	Cost cost(SpecimenView<LinearProgram> specimen, std::size_t) const override {
+		std::span<LinearInstruction const> const program(specimen);
+		return Cost(interpreter(program), program.size());
+	}
+
+	LinearInterpreter& kernel() { return interpreter; }
+	LinearInterpreter const& kernel() const { return interpreter; }
+
+private:
+	LinearInterpreter interpreter;
+};
+
+/*
+ *	Offspring is a head of the first parent and a tail of the second one (cut at random points), at most max_length long;
+ *	so offspring of a parent share prefixes with it, which prefix cache of LinearInterpreter reuses.
+ *	Then, with mutation_probability, one of mutations: an operation (or a constant) is changed, an operand is changed,
+ *	a random instruction is inserted, or an instruction is removed.
+ */
+template <typename Cost>
+class LinearCrossover : public ICrossover<LinearProgram, Cost> {
+public:
+	explicit LinearCrossover(LinearMachine const& machine, double mutation_probability = 0.5)
+	  : machine(machine), mutation_probability(mutation_probability) { }
+	~LinearCrossover() override = default;
+
+	bool does_commute() const override { return false; }
+	bool fixed_offspring_amount() const override { return true; }
+
+	LinearProgram cross(Generation<LinearProgram> const& generation, GenerationsCosts<Cost> const& costs, std::size_t parent1, std::size_t parent2,
+	                    RandomStream& random) override {
+		LinearProgram offspring;
+		cross_into(generation, costs, parent1, parent2, random, offspring);
+		return offspring;
+	}
+
+	void cross_into(Generation<LinearProgram> const& generation, GenerationsCosts<Cost> const&, std::size_t parent1, std::size_t parent2,
+	                RandomStream& random, LinearProgram& offspring) override {
+		auto const& programs = std::get<SPECIMENS_ID>(generation);
+		std::span<LinearInstruction const> const one(programs[parent1]), another(programs[parent2]);
+
+		std::size_t const head = std::min(machine.max_length, random.get_random_int<std::size_t>(0, one.size())),
+		                  tail = random.get_random_int<std::size_t>(0, another.size()),
+		                  length = std::min(machine.max_length, head + another.size() - tail);
+		offspring.assign(one.begin(), one.begin() + head);
+		offspring.insert(offspring.end(), another.begin() + tail, another.begin() + tail + (length - head));
+		if (offspring.empty()) {
+			offspring.push_back(random_linear_instruction(machine, random));
+		}
+
+		if (random.get_random_float<double>(0.0, 1.0) < mutation_probability) {
+			mutate(offspring, random);
+		}
+	}
+
+private:
+	LinearMachine machine;
+	double mutation_probability;
+
+	void mutate(LinearProgram& program, RandomStream& random) const {
+		std::size_t const place = random.get_random_int<std::size_t>(0, program.size() - 1);
+		auto& instruction = program[place];
+		switch (random.get_random_int<int>(0, 3)) {
+		case 0: // operation, or constant of instructions with one
+			if (instruction.op >= LinearOp::ADD_CONSTANT && random.get_random_int<int>(0, 1)) {
+				float const range = (machine.max_constant - machine.min_constant) / 10.f;
+				instruction.constant += random.get_random_float<float>(-range, range);
+			} else {
+				instruction.op = static_cast<LinearOp>(random.get_random_int<std::size_t>(0, linear_ops - 1));
+			}
+			break;
+		case 1: // operand
+			switch (random.get_random_int<int>(0, 2)) {
+			case 0: instruction.destination = static_cast<std::uint8_t>(random.get_random_int<std::size_t>(0, machine.registers - 1)); break;
+			case 1: instruction.source1 = random_linear_source(machine, random); break;
+			default: instruction.source2 = random_linear_source(machine, random); break;
+			}
+			break;
+		case 2: // insertion
+			if (program.size() < machine.max_length) {
+				program.insert(program.begin() + place, random_linear_instruction(machine, random));
+			}
+			break;
+		default: // removal
+			if (program.size() > 1) {
+				program.erase(program.begin() + place);
+			}
+			break;
+		}
+	}
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_LGP_H
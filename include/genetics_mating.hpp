@@ -0,0 +1,174 @@
+#ifndef __GENETICS_MATING_H
+#define __GENETICS_MATING_H
+
+// Mating schedulers with fixed budget of matings per generation: work of generation is O(budget), not O(survivors ^ 2)
+
+#include <functional>
+#include <numeric>
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+/*
+ *	Base of schedulers, which draw parents independently for each of budget matings.
+ *	draw(random) picks one parent; second one is drawn until it differs from the first
+ *	(a few times: if draw keeps giving the same one, second parent is any other, uniformly).
+ */
+template <typename Genome, typename Cost>
+class BudgetMating : public IMatingScheduler<Genome, Cost> {
+public:
+	explicit BudgetMating(std::size_t budget) : budget(budget) { }
+	~BudgetMating() override = default;
+
+	std::size_t schedule(Generation<Genome> const& generation, GenerationsCosts<Cost> const& costs) override {
+		specimens = std::get<SPECIMENS_ID>(generation).size();
+		prepare(generation, costs);
+		return specimens < 2 ? 0 : budget;
+	}
+
+	void matings(std::size_t first, std::size_t last, RandomStreams const& random, std::vector<Mating>& out) const override {
+		for (std::size_t k = first; k < last; ++k) {
+			RandomStream stream = random.stream(k, 0);
+			std::size_t const parent1 = draw(stream);
+			std::size_t parent2 = draw(stream);
+			for (std::size_t attempt = 1; parent2 == parent1 && attempt < max_attempts; ++attempt) {
+				parent2 = draw(stream);
+			}
+			if (parent2 == parent1) {
+				parent2 = (parent1 + 1 + stream.get_random_int<std::size_t>(0, specimens - 2)) % specimens;
+			}
+			out.push_back(Mating{parent1, parent2, 1, k});
+		}
+	}
+
+	std::size_t expected_matings(std::size_t) const override { return budget; }
+
+	void set_budget(std::size_t new_budget) { budget = new_budget; }
+
+protected:
+	std::size_t specimens = 0;
+
+	// Called by schedule, when specimens are already counted
+	virtual void prepare(Generation<Genome> const&, GenerationsCosts<Cost> const&) { }
+	virtual std::size_t draw(RandomStream& random) const = 0;
+
+private:
+	static std::size_t constexpr max_attempts = 16;
+	std::size_t budget;
+};
+
+// Uniformly random pairs
+template <typename Genome, typename Cost>
+class RandomMating : public BudgetMating<Genome, Cost> {
+public:
+	explicit RandomMating(std::size_t budget) : BudgetMating<Genome, Cost>(budget) { }
+	~RandomMating() override = default;
+
+protected:
+	std::size_t draw(RandomStream& random) const override {
+		return random.get_random_int<std::size_t>(0, this->specimens - 1);
+	}
+};
+
+/*
+ *	Each parent is the best of tournament_size specimens, drawn with replacement (ties go to the lower index).
+ *	Greater tournament - stronger selection pressure; tournament of 1 is random mating.
+ */
+template <typename Genome, typename Cost>
+class TournamentMating : public BudgetMating<Genome, Cost> {
+public:
+	TournamentMating(std::size_t budget, std::size_t tournament_size)
+	  : BudgetMating<Genome, Cost>(budget), tournament_size(std::max<std::size_t>(1, tournament_size)) { }
+	~TournamentMating() override = default;
+
+	bool needs_costs() const override { return true; }
+
+protected:
+	void prepare(Generation<Genome> const&, GenerationsCosts<Cost> const& costs) override {
+		this->costs = &costs;
+	}
+
+	std::size_t draw(RandomStream& random) const override {
+		std::size_t winner = random.get_random_int<std::size_t>(0, this->specimens - 1);
+		for (std::size_t round = 1; round < tournament_size; ++round) {
+			std::size_t const challenger = random.get_random_int<std::size_t>(0, this->specimens - 1);
+			if ((*costs)[challenger] < (*costs)[winner] || (!((*costs)[winner] < (*costs)[challenger]) && challenger < winner)) {
+				winner = challenger;
+			}
+		}
+		return winner;
+	}
+
+private:
+	std::size_t tournament_size;
+	GenerationsCosts<Cost> const* costs = nullptr; // of current generation, alive during its crossover
+};
+
+/*
+ *	Fitness-proportional (roulette wheel) selection: parent is drawn with probability proportional to weight(cost),
+ *	which must be non-negative and greater for better specimens (e.g. 1 / (1 + cost)).
+ *	Walker's alias table is built in O(n) per generation, then every draw is O(1).
+ *	If all weights are zero, parents are drawn uniformly.
+ */
+template <typename Genome, typename Cost>
+class ProportionalMating : public BudgetMating<Genome, Cost> {
+public:
+	ProportionalMating(std::size_t budget, std::function<double(Cost const&)> weight)
+	  : BudgetMating<Genome, Cost>(budget), weight(std::move(weight)) { }
+	~ProportionalMating() override = default;
+
+	bool needs_costs() const override { return true; }
+
+protected:
+	void prepare(Generation<Genome> const&, GenerationsCosts<Cost> const& costs) override {
+		// Vose's method: columns of average height; a short column is topped up by a tall one, which becomes its alias
+		std::size_t const n = this->specimens;
+		probability.assign(n, 1.0);
+		alias.resize(n);
+		std::vector<double> scaled(n);
+		double total = 0;
+		for (std::size_t i = 0; i < n; ++i) {
+			scaled[i] = std::max(0.0, weight(costs[i]));
+			total += scaled[i];
+		}
+		if (!(total > 0)) {
+			std::iota(alias.begin(), alias.end(), 0);
+			return;
+		}
+
+		std::vector<std::size_t> small, large;
+		for (std::size_t i = 0; i < n; ++i) {
+			scaled[i] *= static_cast<double>(n) / total;
+			(scaled[i] < 1.0 ? small : large).push_back(i);
+		}
+		while (!small.empty() && !large.empty()) {
+			std::size_t const short_column = small.back(), tall_column = large.back();
+			small.pop_back();
+			probability[short_column] = scaled[short_column];
+			alias[short_column] = tall_column;
+			scaled[tall_column] -= 1.0 - scaled[short_column];
+			if (scaled[tall_column] < 1.0) {
+				large.pop_back();
+				small.push_back(tall_column);
+			}
+		}
+		// What is left is full up to rounding errors
+		for (std::size_t i : small) alias[i] = i;
+		for (std::size_t i : large) alias[i] = i;
+	}
+
+	std::size_t draw(RandomStream& random) const override {
+		std::size_t const column = random.get_random_int<std::size_t>(0, this->specimens - 1);
+		return random.get_random_float<double>(0.0, 1.0) < probability[column] ? column : alias[column];
+	}
+
+private:
+	std::function<double(Cost const&)> weight;
+	std::vector<double> probability;
+	std::vector<std::size_t> alias;
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_MATING_H
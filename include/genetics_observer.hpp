@@ -0,0 +1,65 @@
+#ifndef __GENETICS_OBSERVER_H
+#define __GENETICS_OBSERVER_H
+
+// Observers of evolution: sinks for statistics of generations
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+/*
+ *	Writes one CSV line per generation (header first), flushed, so it could be watched while evolution goes on.
+ *	Costs are written with operator<<, if Cost has it.
+ *	Could be shared by several environments (e.g. islands): lines are written whole.
+ */
+template <typename Cost>
+class CsvObserver : public IObserver<Cost> {
+public:
+	explicit CsvObserver(std::ostream& out) : out(out) {
+		out << "generation,eliminating,crossover_seconds,fitness_seconds,elimination_seconds,offspring,offspring_per_second,"
+		       "peak_specimens,capacity,reserved_bytes,best,median,worst" << std::endl;
+	}
+	~CsvObserver() override = default;
+
+	void generation_done(GenerationStatistics<Cost> const& statistics) override {
+		std::ostringstream line;
+		line << statistics.generation << ',' << statistics.eliminating << ','
+		     << statistics.crossover_seconds << ',' << statistics.fitness_seconds << ',' << statistics.elimination_seconds << ','
+		     << statistics.offspring << ',' << statistics.offspring_per_second << ','
+		     << statistics.peak_specimens << ',' << statistics.capacity << ',' << statistics.reserved_bytes << ','
+		     << field(statistics.best) << ',' << field(statistics.median) << ',' << field(statistics.worst);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		out << line.str() << std::endl;
+	}
+
+private:
+	std::ostream& out;
+	std::mutex mutex;
+
+	static std::string field(std::optional<Cost> const& cost) {
+		if constexpr (requires (std::ostream& stream, Cost const& value) { stream << value; }) {
+			if (!cost) return "";
+			std::ostringstream text;
+			text << cost.value();
+			std::string result = text.str();
+			if (result.find_first_of(",\"\n") == std::string::npos) return result;
+			std::string quoted = "\"";
+			for (char c : result) {
+				if (c == '"') quoted += '"';
+				quoted += c;
+			}
+			return quoted + '"';
+		} else {
+			return "";
+		}
+	}
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_OBSERVER_H
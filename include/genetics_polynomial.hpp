@@ -0,0 +1,385 @@
+#ifndef __GENETICS_POLYNOMIAL_H
+#define __GENETICS_POLYNOMIAL_H
+
+// Polynomial regression: vectorized evaluation of polynomials at many points and squared error against a target
+
+#include <vector>
+#include <span>
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <stdexcept>
+
+#include "genetics.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GENETICS_POLYNOMIAL_X86
+#include <immintrin.h>
+#endif
+
+namespace genetics {
+
+/*
+ *	Sum of squared errors of polynomials over a fixed set of points (x, y).
+ *	Coefficients go from the constant term up: p[0] + p[1]x + p[2]x^2 + ...
+ *	Kernels use AVX-512, AVX2 with FMA, or scalar code; the best supported one is chosen at run time.
+ *	  - Many points: points go along SIMD lanes, GROUP polynomials at once to hide latency of FMA chains.
+ *	  - Up to LANES points (e.g. a handful of test cases): polynomials go along lanes, a whole register of them at once.
+ *	Hence batch(): that many polynomials per kernel call.
+ *
+ *	Result is the same with every instruction set and with any batching:
+ *	Horner's steps are fused multiply-adds, error of point j goes to partial sum j % LANES, and partial sums are added up in one fixed order.
+ *	It differs in last bits from plain (unfused, sequential) evaluation, though. Points must be finite.
+ *	Scalar kernel is there for processors without AVX2. It is built with FMA instructions for processors, which have them;
+ *	on others std::fma is a call into the library, slower than plain evaluation, but with the same result.
+ */
+class PolynomialErrors {
+public:
+	enum class Isa { SCALAR, AVX2, AVX512 };
+
+	static constexpr std::size_t LANES = 16;     // Partial sums, and points per step of the kernels
+	static constexpr std::size_t GROUP = 4;      // Polynomials evaluated at once, when points go along lanes
+	static constexpr std::size_t GROUPS = 4;     // Registers of polynomials per call, when polynomials go along lanes
+	static constexpr std::size_t MAX_BATCH = 64; // Maximum of batch()
+
+	// Isa is clamped to the one the processor supports
+	explicit PolynomialErrors(std::vector<std::pair<float, float>> const& target, Isa isa = best_isa())
+	  : points(target.size()), isa(std::min(isa, best_isa())) {
+		std::size_t const padded = std::max<std::size_t>(1, (points + LANES - 1) / LANES) * LANES;
+		xs.assign(padded, 0.f);
+		ys.assign(padded, 0.f);
+		for (std::size_t j = 0; j < points; ++j) {
+			xs[j] = target[j].first;
+			ys[j] = target[j].second;
+		}
+	}
+
+	static Isa best_isa() {
+#ifdef GENETICS_POLYNOMIAL_X86
+		static Isa const supported = __builtin_cpu_supports("avx512f") ? Isa::AVX512
+		                           : __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? Isa::AVX2
+		                           : Isa::SCALAR;
+		return supported;
+#else
+		return Isa::SCALAR;
+#endif
+	}
+
+	static bool has_fma() {
+#ifdef GENETICS_POLYNOMIAL_X86
+		static bool const supported = __builtin_cpu_supports("fma");
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	Isa instruction_set() const { return isa; }
+	std::size_t size() const { return points; }
+
+	// Polynomials per kernel call: give at least that many at once to keep all lanes busy
+	std::size_t batch() const {
+		if (points > LANES) return GROUP;
+		return isa == Isa::AVX512 ? 16 * GROUPS : isa == Isa::AVX2 ? 8 * GROUPS : 1;
+	}
+
+	float operator()(std::span<float const> polynomial) const {
+		float error;
+		evaluate(&polynomial, 1, &error);
+		return error;
+	}
+
+	// errors[i] is the error of polynomials[i]
+	void operator()(std::span<std::span<float const> const> polynomials, std::span<float> errors) const {
+		if (errors.size() < polynomials.size()) throw std::invalid_argument("Not enough room for errors of polynomials");
+		for (std::size_t i = 0; i < polynomials.size(); i += batch()) {
+			evaluate(polynomials.data() + i, std::min(batch(), polynomials.size() - i), errors.data() + i);
+		}
+	}
+
+private:
+	std::size_t points;
+	Isa isa;
+	std::vector<float> xs, ys; // Padded with zeros up to LANES
+
+	// Coefficients of a group of width polynomials, highest power first, one row of width per Horner's step;
+	// shorter polynomials get leading zeros, which don't change the result: fma(0, x, c) == c
+	struct Group {
+		float const* coefficients;
+		std::size_t steps;
+	};
+
+	// Up to GROUPS groups of width polynomials. All of them are written before any is read:
+	// a vector load right after scalar stores to the same row would wait for them
+	// Rows live in a buffer of the calling thread, valid till its next call
+	static std::array<Group, GROUPS> transpose(std::span<float const> const* polynomials, std::size_t count, std::size_t width) {
+		thread_local std::vector<float> rows;
+		std::array<Group, GROUPS> groups{};
+		std::array<std::size_t, GROUPS> offsets{};
+		std::size_t total = 0;
+		for (std::size_t g = 0; g * width < count; ++g) {
+			for (std::size_t k = g * width; k < std::min(count, (g + 1) * width); ++k) {
+				groups[g].steps = std::max(groups[g].steps, polynomials[k].size());
+			}
+			offsets[g] = total;
+			total += groups[g].steps * width;
+		}
+		rows.assign(total, 0.f);
+		for (std::size_t k = 0; k < count; ++k) {
+			std::size_t const steps = groups[k / width].steps,
+			                  shift = steps - polynomials[k].size();
+			float* const column = rows.data() + offsets[k / width] + k % width;
+			for (std::size_t s = shift; s < steps; ++s) {
+				column[s * width] = polynomials[k][steps - 1 - s];
+			}
+		}
+		for (std::size_t g = 0; g * width < count; ++g) {
+			groups[g].coefficients = rows.data() + offsets[g];
+		}
+		return groups;
+	}
+
+	// The fixed order of summation; kernels with polynomials along lanes repeat it with whole registers
+	static float reduce(float const (&partial)[LANES]) {
+		float sums[LANES / 2];
+		for (std::size_t i = 0; i < LANES / 2; ++i) sums[i] = partial[i] + partial[i + LANES / 2];
+		for (std::size_t width = LANES / 4; width > 0; width /= 2) {
+			for (std::size_t i = 0; i < width; ++i) sums[i] += sums[i + width];
+		}
+		return sums[0];
+	}
+
+	void evaluate(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		switch (isa) {
+#ifdef GENETICS_POLYNOMIAL_X86
+		case Isa::AVX512:
+			return points > LANES ? evaluate_avx512(polynomials, count, errors) : evaluate_across_avx512(polynomials, count, errors);
+		case Isa::AVX2:
+			return points > LANES ? evaluate_avx2(polynomials, count, errors) : evaluate_across_avx2(polynomials, count, errors);
+#endif
+		default:
+#ifdef GENETICS_POLYNOMIAL_X86
+			if (has_fma()) return evaluate_scalar_fma(polynomials, count, errors);
+#endif
+			return evaluate_scalar(polynomials, count, errors);
+		}
+	}
+
+	// Inlined into evaluate_scalar_fma, std::fma becomes an instruction there
+	__attribute__((always_inline))
+	void evaluate_scalar(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		for (std::size_t k = 0; k < count; ++k) {
+			auto const& polynomial = polynomials[k];
+			float partial[LANES] = {};
+			for (std::size_t j = 0; j < points; ++j) {
+				float value = 0.f;
+				for (std::size_t s = polynomial.size(); s-- > 0; ) {
+					value = std::fma(value, xs[j], polynomial[s]);
+				}
+				float const difference = ys[j] - value;
+				partial[j % LANES] = std::fma(difference, difference, partial[j % LANES]);
+			}
+			errors[k] = reduce(partial);
+		}
+	}
+
+#ifdef GENETICS_POLYNOMIAL_X86
+	__attribute__((target("fma")))
+	void evaluate_scalar_fma(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		evaluate_scalar(polynomials, count, errors);
+	}
+
+	__attribute__((target("avx512f")))
+	void evaluate_avx512(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		Group const group = transpose(polynomials, count, GROUP)[0];
+		__m512 sums[GROUP];
+		for (auto& sum : sums) sum = _mm512_setzero_ps();
+
+		for (std::size_t j = 0; j < points; j += LANES) {
+			__mmask16 const valid = points - j >= LANES ? __mmask16(0xFFFF) : __mmask16((1u << (points - j)) - 1);
+			__m512 const x = _mm512_loadu_ps(xs.data() + j),
+			             y = _mm512_loadu_ps(ys.data() + j);
+			__m512 values[GROUP];
+			for (auto& value : values) value = _mm512_setzero_ps();
+			for (std::size_t s = 0; s < group.steps; ++s) {
+				float const* row = group.coefficients + s * GROUP;
+				for (std::size_t k = 0; k < GROUP; ++k) {
+					values[k] = _mm512_fmadd_ps(values[k], x, _mm512_set1_ps(row[k]));
+				}
+			}
+			for (std::size_t k = 0; k < GROUP; ++k) {
+				__m512 const difference = _mm512_maskz_sub_ps(valid, y, values[k]);
+				sums[k] = _mm512_fmadd_ps(difference, difference, sums[k]);
+			}
+		}
+
+		for (std::size_t k = 0; k < count; ++k) {
+			float partial[LANES];
+			_mm512_storeu_ps(partial, sums[k]);
+			errors[k] = reduce(partial);
+		}
+	}
+
+	__attribute__((target("avx512f")))
+	void evaluate_across_avx512(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		auto const groups = transpose(polynomials, count, 16);
+		for (std::size_t g = 0; g * 16 < count; ++g) {
+			evaluate_across_avx512(groups[g], std::min<std::size_t>(16, count - g * 16), errors + g * 16);
+		}
+	}
+
+	// Lane k is polynomial k; four points at once
+	__attribute__((target("avx512f")))
+	void evaluate_across_avx512(Group const& group, std::size_t count, float* errors) const {
+		__m512 squares[LANES];
+		for (auto& square : squares) square = _mm512_setzero_ps();
+
+		for (std::size_t j = 0; j < points; j += 4) {
+			__m512 values[4];
+			for (auto& value : values) value = _mm512_setzero_ps();
+			for (std::size_t s = 0; s < group.steps; ++s) {
+				__m512 const row = _mm512_loadu_ps(group.coefficients + s * 16);
+				for (std::size_t t = 0; t < 4; ++t) {
+					values[t] = _mm512_fmadd_ps(values[t], _mm512_set1_ps(xs[j + t]), row);
+				}
+			}
+			for (std::size_t t = 0; t < 4 && j + t < points; ++t) {
+				__m512 const difference = _mm512_sub_ps(_mm512_set1_ps(ys[j + t]), values[t]);
+				squares[j + t] = _mm512_mul_ps(difference, difference);
+			}
+		}
+
+		for (std::size_t i = 0; i < LANES / 2; ++i) squares[i] = _mm512_add_ps(squares[i], squares[i + LANES / 2]);
+		for (std::size_t width = LANES / 4; width > 0; width /= 2) {
+			for (std::size_t i = 0; i < width; ++i) squares[i] = _mm512_add_ps(squares[i], squares[i + width]);
+		}
+		float sums[16];
+		_mm512_storeu_ps(sums, squares[0]);
+		std::copy_n(sums, count, errors);
+	}
+
+	__attribute__((target("avx2,fma")))
+	void evaluate_avx2(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		// Two registers of 8 lanes make the 16 partial sums
+		alignas(32) static constexpr int ones[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+		Group const group = transpose(polynomials, count, GROUP)[0];
+		__m256 sums[GROUP][2];
+		for (auto& sum : sums) sum[0] = sum[1] = _mm256_setzero_ps();
+
+		for (std::size_t j = 0; j < points; j += LANES) {
+			std::size_t const valid = std::min(LANES, points - j);
+			__m256 const x[2] = {_mm256_loadu_ps(xs.data() + j), _mm256_loadu_ps(xs.data() + j + 8)},
+			             y[2] = {_mm256_loadu_ps(ys.data() + j), _mm256_loadu_ps(ys.data() + j + 8)};
+			__m256 const mask[2] = {_mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(ones + 8 - std::min<std::size_t>(valid, 8)))),
+			                        _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(ones + 8 - (valid - std::min<std::size_t>(valid, 8)))))};
+			__m256 values[GROUP][2];
+			for (auto& value : values) value[0] = value[1] = _mm256_setzero_ps();
+			for (std::size_t s = 0; s < group.steps; ++s) {
+				float const* row = group.coefficients + s * GROUP;
+				for (std::size_t k = 0; k < GROUP; ++k) {
+					__m256 const coefficient = _mm256_set1_ps(row[k]);
+					values[k][0] = _mm256_fmadd_ps(values[k][0], x[0], coefficient);
+					values[k][1] = _mm256_fmadd_ps(values[k][1], x[1], coefficient);
+				}
+			}
+			for (std::size_t k = 0; k < GROUP; ++k) {
+				for (std::size_t half = 0; half < 2; ++half) {
+					__m256 const difference = _mm256_and_ps(_mm256_sub_ps(y[half], values[k][half]), mask[half]);
+					sums[k][half] = _mm256_fmadd_ps(difference, difference, sums[k][half]);
+				}
+			}
+		}
+
+		for (std::size_t k = 0; k < count; ++k) {
+			float partial[LANES];
+			_mm256_storeu_ps(partial, sums[k][0]);
+			_mm256_storeu_ps(partial + 8, sums[k][1]);
+			errors[k] = reduce(partial);
+		}
+	}
+
+	__attribute__((target("avx2,fma")))
+	void evaluate_across_avx2(std::span<float const> const* polynomials, std::size_t count, float* errors) const {
+		auto const groups = transpose(polynomials, count, 8);
+		for (std::size_t g = 0; g * 8 < count; ++g) {
+			evaluate_across_avx2(groups[g], std::min<std::size_t>(8, count - g * 8), errors + g * 8);
+		}
+	}
+
+	// Lane k is polynomial k; four points at once
+	__attribute__((target("avx2,fma")))
+	void evaluate_across_avx2(Group const& group, std::size_t count, float* errors) const {
+		__m256 squares[LANES];
+		for (auto& square : squares) square = _mm256_setzero_ps();
+
+		for (std::size_t j = 0; j < points; j += 4) {
+			__m256 values[4];
+			for (auto& value : values) value = _mm256_setzero_ps();
+			for (std::size_t s = 0; s < group.steps; ++s) {
+				__m256 const row = _mm256_loadu_ps(group.coefficients + s * 8);
+				for (std::size_t t = 0; t < 4; ++t) {
+					values[t] = _mm256_fmadd_ps(values[t], _mm256_set1_ps(xs[j + t]), row);
+				}
+			}
+			for (std::size_t t = 0; t < 4 && j + t < points; ++t) {
+				__m256 const difference = _mm256_sub_ps(_mm256_set1_ps(ys[j + t]), values[t]);
+				squares[j + t] = _mm256_mul_ps(difference, difference);
+			}
+		}
+
+		for (std::size_t i = 0; i < LANES / 2; ++i) squares[i] = _mm256_add_ps(squares[i], squares[i + LANES / 2]);
+		for (std::size_t width = LANES / 4; width > 0; width /= 2) {
+			for (std::size_t i = 0; i < width; ++i) squares[i] = _mm256_add_ps(squares[i], squares[i + width]);
+		}
+		float sums[8];
+		_mm256_storeu_ps(sums, squares[0]);
+		std::copy_n(sums, count, errors);
+	}
+#endif
+};
+
+/*
+ *	Pointwise fitness of polynomial regression: cost is made of squared error over the target and number of coefficients,
+ *	as Cost(error, size). Chunks of the parallel loop go to the kernel in batches.
+ */
+template <typename Cost, typename Genome = std::vector<float>>
+requires std::constructible_from<Cost, float, std::size_t>
+class PolynomialFitness : public IPointwiseFitness<Genome, Cost> {
+public:
+	explicit PolynomialFitness(std::vector<std::pair<float, float>> const& target, PolynomialErrors::Isa isa = PolynomialErrors::best_isa())
+	  : errors(target, isa) { }
+	~PolynomialFitness() override = default;
+
+	Cost cost(SpecimenView<Genome> specimen, std::size_t) const override {
+		std::span<float const> const polynomial(specimen);
+		return Cost(errors(polynomial), polynomial.size());
+	}
+
+	void cost_batch(Population<Genome> const& specimens, std::optional<std::vector<std::size_t>> const&,
+	                std::size_t first, std::size_t last, GenerationsCosts<Cost>& costs) const override {
+		std::array<std::span<float const>, PolynomialErrors::MAX_BATCH> polynomials;
+		std::array<float, PolynomialErrors::MAX_BATCH> batch_errors;
+		std::size_t const batch = errors.batch();
+		for (std::size_t i = first; i < last; i += batch) {
+			std::size_t const count = std::min(batch, last - i);
+			for (std::size_t k = 0; k < count; ++k) {
+				polynomials[k] = std::span<float const>(specimens[i + k]);
+			}
+			errors(std::span(polynomials.data(), count), batch_errors);
+			for (std::size_t k = 0; k < count; ++k) {
+				costs[i + k] = Cost(batch_errors[k], polynomials[k].size());
+			}
+		}
+	}
+
+	PolynomialErrors const& kernel() const { return errors; }
+
+private:
+	PolynomialErrors errors;
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_POLYNOMIAL_H
@@ -0,0 +1,145 @@
+#ifndef __GENETICS_SESSION_H
+#define __GENETICS_SESSION_H
+
+// Evolution in steps: progress could be watched, and run could be stopped, between eliminations
+
+#include <iterator>
+#include <stop_token>
+
+#include "genetics.hpp"
+
+namespace genetics {
+
+/*
+ *	One evolve call, cut into steps: each step() runs generations up to the next elimination and returns,
+ *	then generation and costs could be read (costs are of all specimens right after elimination).
+ *	Generation and costs stay here, and buffers stay in environment, so steps don't set anything up or score anything again;
+ *	random streams depend only on seed and generation count, so steps make exactly the same run as one evolve call.
+ *	max_generations() limits the whole session, as it does one evolve call.
+ *
+ *	Cancellation is cooperative: stop token is checked before every generation, so a stopped session
+ *	is left at a generation boundary and could be read (or checkpointed) as any other.
+ *
+ *	Also a range of steps, as a generator: for (auto const& step : session) { ... } runs until the end.
+ */
+template <typename Environment>
+class EvolutionSession {
+public:
+	using Genome = typename Environment::genome_type;
+	using Cost = typename Environment::cost_type;
+
+	enum class State {
+		RUNNING,
+		GOOD_ENOUGH, // best specimen is good enough
+		FINISHED,    // max_generations() are done
+		CANCELLED
+	};
+
+	EvolutionSession(Environment& environment, Generation<Genome> generation, GenerationsCosts<Cost> costs = {},
+	                 std::stop_token stop = {})
+	  : environment(environment)
+	  , current_generation(std::move(generation))
+	  , current_costs(std::move(costs))
+	  , stop(std::move(stop))
+	  , limit(environment.max_generations()) {
+		if (limit && limit.value() == 0) current_state = State::FINISHED;
+	}
+
+	// Runs up to the next elimination (or at most given number of generations); false when session is over
+	bool step(std::optional<std::size_t> generations = std::nullopt) {
+		if (current_state != State::RUNNING) return false;
+		if (stop.stop_requested()) {
+			current_state = State::CANCELLED;
+			return false;
+		}
+
+		std::size_t const till_elimination = environment.generations_till_elimination(),
+		                  count = generation_count();
+		std::size_t amount = till_elimination - count % till_elimination;
+		if (generations) amount = std::min(amount, generations.value());
+		if (limit) amount = std::min(amount, limit.value() - done);
+
+		bool const good_enough = environment.advance(current_generation, current_costs, amount, stop);
+		done += generation_count() - count;
+		if (good_enough) {
+			current_state = State::GOOD_ENOUGH;
+		} else if (limit && done >= limit.value()) {
+			current_state = State::FINISHED;
+		} else if (stop.stop_requested()) {
+			current_state = State::CANCELLED;
+		}
+		return current_state == State::RUNNING;
+	}
+
+	State state() const { return current_state; }
+	bool running() const { return current_state == State::RUNNING; }
+
+	Generation<Genome> const& generation() const { return current_generation; }
+	Population<Genome> const& specimens() const { return std::get<SPECIMENS_ID>(current_generation); }
+	GenerationsCosts<Cost> const& costs() const { return current_costs; }
+	std::size_t generation_count() const { return std::get<GENERATION_COUNT_ID>(current_generation); }
+	// Since the start of session
+	std::size_t generations_done() const { return done; }
+
+	// Ends session: generation is moved out, and so are costs
+	Generation<Genome> release(GenerationsCosts<Cost>& costs) {
+		current_state = State::CANCELLED;
+		costs = std::move(current_costs);
+		return std::move(current_generation);
+	}
+
+	// Input iterator over steps: every increment is a step, dereference gives the session after it (the last step included)
+	class iterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = EvolutionSession;
+		using difference_type = std::ptrdiff_t;
+		using pointer = EvolutionSession const*;
+		using reference = EvolutionSession const&;
+
+		iterator() = default;
+		explicit iterator(EvolutionSession* session) : session(session) { }
+
+		reference operator*() const { return *session; }
+		pointer operator->() const { return session; }
+
+		iterator& operator++() {
+			if (!session->step_forward()) session = nullptr;
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+
+		bool operator==(iterator const& other) const { return session == other.session; }
+
+	private:
+		EvolutionSession* session = nullptr;
+	};
+
+	// The first step is taken here
+	iterator begin() {
+		return step_forward() ? iterator(this) : end();
+	}
+	iterator end() { return iterator(); }
+
+private:
+	Environment& environment;
+	Generation<Genome> current_generation;
+	GenerationsCosts<Cost> current_costs;
+	std::stop_token stop;
+
+	std::optional<std::size_t> limit;
+	std::size_t done = 0;
+	State current_state = State::RUNNING;
+
+	// Step of iteration: false if it made no generations (session was over, or it was stopped before the first one),
+	// so that the same state is not shown twice
+	bool step_forward() {
+		std::size_t const before = done;
+		step();
+		return done != before;
+	}
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_SESSION_H
@@ -0,0 +1,253 @@
+#ifndef __GENETICS_SPILL_H
+#define __GENETICS_SPILL_H
+
+// Populations, which could move out of RAM into memory-mapped scratch files (see set_memory_budget of Environment)
+// POSIX is expected
+
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "genetics.hpp"
+#include "genetics_arena.hpp"
+
+namespace genetics {
+
+/*
+ *	Contiguous container of trivially copyable specimens: in heap, as std::vector, until spill() is called,
+ *	then in a shared mapping of a scratch file. File is unlinked right after it is created, so nothing is left behind even after a crash.
+ *	Pages of the mapping are written back to the file by the kernel under memory pressure, so population may be bigger than RAM:
+ *	offspring are appended sequentially, and file grows by segments of segment_bytes (at least).
+ *	Genomes with memory of their own are not supported: budget, which needs them spilled, is refused with std::length_error;
+ *	sequence genomes (std::vector, as Polynomial of the tests) spill as SpillableRaggedPopulation.
+ *
+ *	To use it for some genome, specialize population_traits:
+ *	  template <> struct genetics::population_traits<long long> : genetics::spillable_population<long long> { };
+ */
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+class SpillablePopulation {
+public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using iterator = T*;
+	using const_iterator = T const*;
+
+	static std::size_t constexpr segment_bytes = std::size_t(64) << 20;
+
+	SpillablePopulation() = default;
+	SpillablePopulation(std::vector<T> const& specimens) {
+		assign(specimens.begin(), specimens.end());
+	}
+	SpillablePopulation(SpillablePopulation const& other) {
+		assign(other.begin(), other.end());
+	}
+	SpillablePopulation(SpillablePopulation&& other) noexcept {
+		swap(other);
+	}
+	SpillablePopulation& operator=(SpillablePopulation other) noexcept {
+		swap(other);
+		return *this;
+	}
+	~SpillablePopulation() {
+		release();
+	}
+
+	void swap(SpillablePopulation& other) noexcept {
+		std::swap(items, other.items);
+		std::swap(count, other.count);
+		std::swap(reserved, other.reserved);
+		std::swap(file, other.file);
+	}
+	friend void swap(SpillablePopulation& one, SpillablePopulation& another) noexcept { one.swap(another); }
+
+	// Moves storage to a scratch file in directory (temporary directory, if empty); later growth stays there
+	void spill(std::filesystem::path directory) {
+		if (spilled()) return;
+		if (directory.empty()) directory = std::filesystem::temp_directory_path();
+		std::string name = (directory / "genetics_spill_XXXXXX").string();
+		int const scratch = ::mkstemp(name.data());
+		if (scratch < 0) throw std::system_error(errno, std::generic_category(), "Cannot create scratch file in " + directory.string());
+		::unlink(name.c_str());
+
+		T* const heap_items = items;
+		std::size_t const heap_reserved = reserved;
+		file = scratch;
+		items = nullptr;
+		reserved = 0;
+		try {
+			grow(std::max<std::size_t>(count, 1));
+		} catch (...) {
+			::close(file);
+			file = -1;
+			items = heap_items;
+			reserved = heap_reserved;
+			throw;
+		}
+		if (count) std::memcpy(static_cast<void*>(items), heap_items, count * sizeof(T));
+		std::allocator<T>().deallocate(heap_items, heap_reserved);
+	}
+	bool spilled() const { return file >= 0; }
+
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	std::size_t capacity() const { return reserved; }
+
+	T* data() { return items; }
+	T const* data() const { return items; }
+	T* begin() { return items; }
+	T* end() { return items + count; }
+	T const* begin() const { return items; }
+	T const* end() const { return items + count; }
+
+	T& operator[](std::size_t index) { return items[index]; }
+	T const& operator[](std::size_t index) const { return items[index]; }
+	T& front() { return items[0]; }
+	T const& front() const { return items[0]; }
+	T& back() { return items[count - 1]; }
+	T const& back() const { return items[count - 1]; }
+
+	void reserve(std::size_t specimens) {
+		if (specimens > reserved) grow(specimens);
+	}
+
+	// Storage is kept
+	void clear() { count = 0; }
+
+	void resize(std::size_t new_size, T const& value = T()) {
+		reserve(new_size);
+		for (std::size_t i = count; i < new_size; ++i) {
+			new (items + i) T(value);
+		}
+		count = new_size;
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args) {
+		if (count == reserved) grow(std::max<std::size_t>(count + 1, 2 * count));
+		new (items + count) T(std::forward<Args>(args)...);
+		return items[count++];
+	}
+	void push_back(T const& value) { emplace_back(value); }
+	void pop_back() { --count; }
+
+	template <typename Iterator>
+	void assign(Iterator first, Iterator last) {
+		clear();
+		append(first, last);
+	}
+
+	// Growth is geometric, as in push_back: RaggedPopulation appends its specimens one by one
+	template <typename Iterator>
+	void append(Iterator first, Iterator last) {
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>) {
+			std::size_t const added = static_cast<std::size_t>(std::distance(first, last));
+			if (count + added > reserved) grow(std::max(count + added, 2 * count));
+			std::uninitialized_copy(first, last, items + count);
+			count += added;
+		} else {
+			for (; first != last; ++first) {
+				emplace_back(*first);
+			}
+		}
+	}
+
+	// i-th chosen specimen becomes i-th, the rest are dropped; chosen are few (survivors), so they go through heap
+	void compact(std::vector<std::size_t> const& chosen) {
+		std::vector<T> survived;
+		survived.reserve(chosen.size());
+		for (std::size_t index : chosen) {
+			survived.push_back(items[index]);
+		}
+		if (!survived.empty()) std::memcpy(static_cast<void*>(items), survived.data(), survived.size() * sizeof(T));
+		count = survived.size();
+	}
+
+	bool operator==(SpillablePopulation const& other) const {
+		return std::equal(begin(), end(), other.begin(), other.end());
+	}
+
+private:
+	T* items = nullptr;
+	std::size_t count = 0, reserved = 0;
+	int file = -1;
+
+	void grow(std::size_t specimens) {
+		if (!spilled()) {
+			T* const grown = std::allocator<T>().allocate(specimens);
+			if (count) std::memcpy(static_cast<void*>(grown), items, count * sizeof(T));
+			if (items) std::allocator<T>().deallocate(items, reserved);
+			items = grown;
+			reserved = specimens;
+			return;
+		}
+
+		// Old mapping is dropped: its pages are in the file, and the new one sees them
+		std::size_t const bytes = (specimens * sizeof(T) + segment_bytes - 1) / segment_bytes * segment_bytes;
+		if (::ftruncate(file, static_cast<off_t>(bytes)) != 0) {
+			throw std::system_error(errno, std::generic_category(), "Cannot grow scratch file");
+		}
+		if (items) ::munmap(items, reserved * sizeof(T));
+		void* const mapped = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+		if (mapped == MAP_FAILED) {
+			items = nullptr;
+			reserved = count = 0;
+			throw std::system_error(errno, std::generic_category(), "Cannot map scratch file");
+		}
+		items = static_cast<T*>(mapped);
+		reserved = bytes / sizeof(T);
+	}
+
+	void release() {
+		if (spilled()) {
+			if (items) ::munmap(items, reserved * sizeof(T));
+			::close(file);
+		} else if (items) {
+			std::allocator<T>().deallocate(items, reserved);
+		}
+		items = nullptr;
+		count = reserved = 0;
+		file = -1;
+	}
+};
+
+template <typename T>
+struct spillable_population {
+	using type = SpillablePopulation<T>;
+};
+
+/*
+ *	RaggedPopulation of sequence genomes (std::vector<T> of trivially copyable T), whose elements and offsets are SpillablePopulation:
+ *	in heap until spill(), then in scratch files.
+ *
+ *	To use it for some genome, specialize population_traits:
+ *	  template <> struct genetics::population_traits<std::vector<float>> : genetics::spillable_ragged_population<float> { };
+ */
+template <typename T>
+using SpillableRaggedPopulation = RaggedPopulation<T, std::allocator<T>, SpillablePopulation<T>, SpillablePopulation<std::size_t>>;
+
+template <typename T>
+struct spillable_ragged_population {
+	using type = SpillableRaggedPopulation<T>;
+};
+
+template <typename T>
+void splice(SpillablePopulation<T>& to, SpillablePopulation<T>& from) {
+	to.append(from.begin(), from.end());
+	from.clear();
+}
+
+template <typename T>
+void move_specimen(SpillablePopulation<T>& to, SpillablePopulation<T>& from, std::size_t index) {
+	to.push_back(from[index]);
+}
+
+} // namespace genetics
+
+#endif //__GENETICS_SPILL_H
@@ -0,0 +1,471 @@
+#ifndef __GENETICS_WORKERS_H
+#define __GENETICS_WORKERS_H
+
+// Fitness in worker processes: for evaluators, which are not thread-safe (global state, foreign simulators)
+// Linux is expected (eventfd, prctl)
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "genetics_checkpoint.hpp"
+
+namespace genetics {
+
+namespace process_pool {
+
+// Records are aligned to their header, so that arrays of elements could be read in place
+struct alignas(32) Record {
+	std::uint64_t index; // of specimen, or skip
+	std::uint64_t age;
+	std::uint64_t size;  // of payload
+};
+
+inline constexpr std::uint64_t skip = ~std::uint64_t(0); // rest of ring up to its end is not used
+inline constexpr std::uint64_t record_alignment = sizeof(Record);
+
+inline std::uint64_t record_size(std::uint64_t payload) {
+	return (sizeof(Record) + payload + record_alignment - 1) / record_alignment * record_alignment;
+}
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared memory needs lock-free atomics");
+
+// Counters only grow; producer owns head, consumer owns tail
+struct RingHeader {
+	alignas(64) std::atomic<std::uint64_t> head{0};
+	alignas(64) std::atomic<std::uint64_t> tail{0};
+};
+
+/*
+ *	Single-producer single-consumer ring of records in shared memory.
+ *	Record never wraps around: if it does not fit before the end, the rest is skipped.
+ */
+class Ring {
+public:
+	Ring() = default;
+	Ring(RingHeader* header, std::byte* data, std::uint64_t capacity) : header(header), data(data), capacity(capacity) { }
+
+	void reset() {
+		header->head.store(0, std::memory_order_relaxed);
+		header->tail.store(0, std::memory_order_relaxed);
+	}
+
+	bool fits(std::uint64_t payload) const { return record_size(payload) <= capacity; }
+
+	// false if there is no room now
+	bool push(std::uint64_t index, std::uint64_t age, std::span<std::byte const> payload) {
+		std::uint64_t const size = record_size(payload.size());
+		std::uint64_t head = header->head.load(std::memory_order_relaxed);
+		std::uint64_t const tail = header->tail.load(std::memory_order_acquire);
+		std::uint64_t const contiguous = capacity - head % capacity;
+		std::uint64_t const needed = contiguous < size ? contiguous + size : size;
+		if (head - tail + needed > capacity) return false;
+
+		if (contiguous < size) {
+			*reinterpret_cast<Record*>(data + head % capacity) = Record{skip, 0, contiguous - sizeof(Record)};
+			head += contiguous;
+		}
+		std::byte* const place = data + head % capacity;
+		*reinterpret_cast<Record*>(place) = Record{index, age, payload.size()};
+		if (!payload.empty()) std::memcpy(place + sizeof(Record), payload.data(), payload.size());
+		header->head.store(head + size, std::memory_order_release);
+		return true;
+	}
+
+	// Calls consume(record, payload) for the oldest record; false if there is none
+	template <typename Consume>
+	bool pop(Consume&& consume) {
+		std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+		std::uint64_t const head = header->head.load(std::memory_order_acquire);
+		while (tail != head) {
+			std::byte const* const place = data + tail % capacity;
+			Record const record = *reinterpret_cast<Record const*>(place);
+			tail += record_size(record.size);
+			if (record.index == skip) continue;
+			consume(record, std::span<std::byte const>(place + sizeof(Record), record.size));
+			header->tail.store(tail, std::memory_order_release);
+			return true;
+		}
+		header->tail.store(tail, std::memory_order_release);
+		return false;
+	}
+
+private:
+	RingHeader* header = nullptr;
+	std::byte* data = nullptr;
+	std::uint64_t capacity = 0;
+};
+
+// Bytes of a genome or cost, encoded as in checkpoints; scratch is used, if they are not contiguous already
+template <typename T, typename Value>
+std::span<std::byte const> encode(Value const& value, std::vector<std::byte>& scratch) {
+	using namespace checkpoint_format;
+	if constexpr (kind_of<T>() == SERIALIZED) {
+		scratch.clear();
+		Serializer<T>::write(value, scratch);
+		return scratch;
+	} else if constexpr (kind_of<T>() == RAW) {
+		T const copy = value;
+		scratch.resize(sizeof(T));
+		std::memcpy(scratch.data(), &copy, sizeof(T));
+		return scratch;
+	} else {
+		return std::as_bytes(std::span(std::ranges::data(value), std::ranges::size(value)));
+	}
+}
+
+template <typename T>
+T decode(std::span<std::byte const> bytes) {
+	using namespace checkpoint_format;
+	if constexpr (kind_of<T>() == SERIALIZED) {
+		return Serializer<T>::read(bytes);
+	} else if constexpr (kind_of<T>() == RAW) {
+		alignas(T) std::byte storage[sizeof(T)];
+		std::memcpy(storage, bytes.data(), sizeof(T));
+		return *std::launder(reinterpret_cast<T*>(storage));
+	} else {
+		using Element = std::ranges::range_value_t<T>;
+		static_assert(alignof(Element) <= record_alignment);
+		auto const elements = reinterpret_cast<Element const*>(bytes.data());
+		return T(elements, elements + bytes.size() / sizeof(Element));
+	}
+}
+
+// Shared by parent and one worker: both rings, and request to stop
+struct Channel {
+	RingHeader requests, responses;
+	std::atomic<std::uint32_t> stop{0};
+};
+
+inline void signal(int event) {
+	std::uint64_t const one = 1;
+	while (::write(event, &one, sizeof(one)) < 0 && errno == EINTR) { }
+}
+
+inline void wait(int event) {
+	std::uint64_t value;
+	while (::read(event, &value, sizeof(value)) < 0 && errno == EINTR) { }
+}
+
+} // namespace process_pool
+
+/*
+ *	Whole-generation fitness, which scores new specimens with a pointwise fitness in worker processes.
+ *	Each worker is forked with a copy of the fitness, and evaluates one specimen at a time, so the fitness
+ *	doesn't have to be thread-safe; workers are as many processes, so they use as many cores.
+ *
+ *	Each worker has a shared mapping with two rings (specimens there, costs back) and two eventfds to wake the other side.
+ *	A worker gets at most batch specimens in flight (fewer near the end, so that workers finish together);
+ *	costs are written to their places in costs, so order of specimens is kept whatever worker was faster.
+ *
+ *	Worker, which dies (crash, abort, exception out of cost), is forked anew from the parent's pristine copy of fitness,
+ *	and its unfinished specimens are sent again; after max_attempts deaths on the same specimen cost throws std::runtime_error.
+ *	When cost throws, costs are left as they were given, and the pool could be used again.
+ *	Workers are killed, if the parent dies: with PR_SET_PDEATHSIG, which fires when the thread, that forked the worker, exits,
+ *	not the whole process. So constructor and cost calls (which fork workers anew) must be made on threads, that outlive the pool
+ *	(e.g. the main thread, or threads of a ThreadPool, which lives longer): otherwise workers are killed, when their thread exits,
+ *	and are forked again on the next cost call, with their specimens counted as attempts.
+ *
+ *	Genomes and costs are encoded as in checkpoints (see Serializer in genetics_checkpoint.hpp),
+ *	and an encoded specimen must fit into a ring (ring_bytes), otherwise std::length_error is thrown.
+ *	Workers are forked in constructor (and when they die); only the forking thread lives in a child,
+ *	so create it before other threads of the program could hold locks.
+ */
+template <typename Genome, typename Cost>
+class ProcessPoolFitness : public IFitness<Genome, Cost> {
+public:
+	static std::size_t constexpr max_attempts = 3;
+
+	ProcessPoolFitness(std::shared_ptr<IPointwiseFitness<Genome, Cost>> fitness, std::size_t workers,
+	                   std::size_t batch = 32, std::size_t ring_bytes = std::size_t(1) << 20)
+	  : fitness(std::move(fitness))
+	  , batch(std::max<std::size_t>(1, batch))
+	  , ring_bytes((std::max<std::size_t>(ring_bytes, 4096) + process_pool::record_alignment - 1)
+	               / process_pool::record_alignment * process_pool::record_alignment)
+	  , pool(std::max<std::size_t>(1, workers)) {
+		try {
+			for (auto& worker : pool) {
+				open(worker);
+				start(worker);
+			}
+		} catch (...) {
+			shutdown();
+			throw;
+		}
+	}
+	ProcessPoolFitness(ProcessPoolFitness const&) = delete;
+	ProcessPoolFitness& operator=(ProcessPoolFitness const&) = delete;
+	~ProcessPoolFitness() override {
+		shutdown();
+	}
+
+	void cost(Generation<Genome> const& generation, GenerationsCosts<Cost>& costs) override {
+		auto const& specimens = std::get<SPECIMENS_ID>(generation);
+		auto const& ages = std::get<AGE_ID>(generation);
+		std::size_t const first = costs.size(), last = specimens.size();
+		if (first >= last) return;
+		costs.resize(last);
+
+		next = first;
+		retries.clear();
+		attempts.clear();
+		std::size_t remaining = last - first;
+		try {
+			while (remaining > 0) {
+				for (auto& worker : pool) {
+					feed(worker, specimens, ages, last);
+				}
+				await();
+				for (auto& worker : pool) {
+					remaining -= collect(worker, costs);
+					if (!worker.in_flight.empty() && exited(worker)) {
+						remaining -= collect(worker, costs);
+						recover(worker);
+					}
+				}
+			}
+		} catch (...) {
+			// Busy workers would answer stale requests later; costs are left as they were given
+			for (auto& worker : pool) {
+				if (!worker.in_flight.empty()) restart(worker);
+			}
+			costs.resize(first);
+			throw;
+		}
+	}
+
+	bool incremental() const override { return true; }
+	bool depends_on_age() const override { return fitness->depends_on_age(); }
+
+	std::size_t workers() const { return pool.size(); }
+	// Workers forked again after they died
+	std::size_t restarts() const { return restarted; }
+
+private:
+	struct Worker {
+		pid_t pid = -1;
+		int to_worker = -1, to_parent = -1;
+		int exit_event = -1; // pidfd: readable, once worker is dead
+		void* memory = nullptr;
+		std::size_t memory_bytes = 0;
+		process_pool::Channel* channel = nullptr;
+		process_pool::Ring requests, responses;
+		std::deque<std::size_t> in_flight; // in order they were sent, and so are answered
+	};
+
+	std::shared_ptr<IPointwiseFitness<Genome, Cost>> fitness;
+	std::size_t batch, ring_bytes;
+	std::vector<Worker> pool;
+	std::size_t restarted = 0;
+
+	// Work of current cost call: specimens [next, last) are not sent yet, retries were sent to died workers
+	std::size_t next = 0;
+	std::deque<std::size_t> retries;
+	std::unordered_map<std::size_t, std::size_t> attempts;
+	std::vector<std::byte> scratch;
+	std::vector<pollfd> waiting;
+
+	void open(Worker& worker) {
+		std::size_t const header = (sizeof(process_pool::Channel) + 63) / 64 * 64;
+		worker.memory_bytes = header + 2 * ring_bytes;
+		void* const mapped = ::mmap(nullptr, worker.memory_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "Cannot map memory of fitness worker");
+		worker.memory = mapped;
+		worker.channel = new (mapped) process_pool::Channel();
+		auto* const rings = static_cast<std::byte*>(mapped) + header;
+		worker.requests = process_pool::Ring(&worker.channel->requests, rings, ring_bytes);
+		worker.responses = process_pool::Ring(&worker.channel->responses, rings + ring_bytes, ring_bytes);
+
+		worker.to_worker = ::eventfd(0, EFD_CLOEXEC);
+		worker.to_parent = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (worker.to_worker < 0 || worker.to_parent < 0) {
+			throw std::system_error(errno, std::generic_category(), "Cannot create eventfd of fitness worker");
+		}
+	}
+
+	void start(Worker& worker) {
+		worker.requests.reset();
+		worker.responses.reset();
+		worker.channel->stop.store(0, std::memory_order_relaxed);
+		std::uint64_t drained;
+		while (::read(worker.to_parent, &drained, sizeof(drained)) > 0) { }
+
+		pid_t const parent = ::getpid();
+		pid_t const pid = ::fork();
+		if (pid < 0) throw std::system_error(errno, std::generic_category(), "Cannot fork fitness worker");
+		if (pid == 0) serve(worker, parent);
+		worker.pid = pid;
+#ifdef SYS_pidfd_open
+		worker.exit_event = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#endif
+	}
+
+	// Child: never returns
+	[[noreturn]] void serve(Worker& worker, pid_t parent) {
+		::prctl(PR_SET_PDEATHSIG, SIGKILL);
+		if (::getppid() != parent) ::_exit(0);
+
+		try {
+			std::vector<std::byte> encoded;
+			for (;;) {
+				std::size_t answered = 0;
+				while (worker.requests.pop([&](process_pool::Record const& record, std::span<std::byte const> payload) {
+					Cost const result = fitness->cost(process_pool::decode<Genome>(payload), record.age);
+					auto const bytes = process_pool::encode<Cost>(result, encoded);
+					if (!worker.responses.fits(bytes.size())) ::_exit(3);
+					while (!worker.responses.push(record.index, 0, bytes)) {
+						process_pool::signal(worker.to_parent);
+						process_pool::wait(worker.to_worker);
+						if (worker.channel->stop.load(std::memory_order_acquire)) ::_exit(0);
+					}
+					// Parent is woken now and then, to collect costs while the rest is evaluated
+					if (++answered % 8 == 0) process_pool::signal(worker.to_parent);
+				})) { }
+				if (answered % 8 != 0) process_pool::signal(worker.to_parent);
+				if (worker.channel->stop.load(std::memory_order_acquire)) ::_exit(0);
+				process_pool::wait(worker.to_worker);
+			}
+		} catch (...) {
+			::_exit(2);
+		}
+	}
+
+	template <typename Specimens>
+	void feed(Worker& worker, Specimens const& specimens, std::optional<std::vector<std::size_t>> const& ages, std::size_t last) {
+		// Fewer in flight near the end, so that no worker is left with a long queue
+		std::size_t const unsent = retries.size() + (last - next);
+		std::size_t const limit = std::max<std::size_t>(1, std::min(batch, (unsent + pool.size() - 1) / pool.size()));
+		bool sent = false;
+		while (worker.in_flight.size() < limit && (!retries.empty() || next < last)) {
+			std::size_t const index = retries.empty() ? next : retries.front();
+			auto const bytes = process_pool::encode<Genome>(specimens[index], scratch);
+			if (!worker.requests.fits(bytes.size())) {
+				throw std::length_error("Specimen does not fit into ring of fitness worker: " + std::to_string(bytes.size()) + " bytes");
+			}
+			if (!worker.requests.push(index, ages ? ages.value()[index] : 0, bytes)) break;
+			if (retries.empty()) {
+				++next;
+			} else {
+				retries.pop_front();
+			}
+			worker.in_flight.push_back(index);
+			sent = true;
+		}
+		if (sent) process_pool::signal(worker.to_worker);
+	}
+
+	// Until some worker answers or dies (without pidfd, death is noticed by timeout)
+	void await() {
+		waiting.clear();
+		for (auto const& worker : pool) {
+			if (!worker.in_flight.empty()) waiting.push_back(pollfd{worker.to_parent, POLLIN, 0});
+		}
+		std::size_t const answers = waiting.size();
+		if (answers == 0) return;
+		for (auto const& worker : pool) {
+			if (!worker.in_flight.empty() && worker.exit_event >= 0) waiting.push_back(pollfd{worker.exit_event, POLLIN, 0});
+		}
+		int const ready = ::poll(waiting.data(), waiting.size(), 100);
+		if (ready < 0 && errno != EINTR) throw std::system_error(errno, std::generic_category(), "Cannot wait for fitness workers");
+		std::uint64_t drained;
+		for (std::size_t i = 0; i < answers; ++i) {
+			if (waiting[i].revents & POLLIN) ::read(waiting[i].fd, &drained, sizeof(drained));
+		}
+	}
+
+	// Returns amount of costs collected
+	std::size_t collect(Worker& worker, GenerationsCosts<Cost>& costs) {
+		std::size_t collected = 0;
+		while (worker.responses.pop([&](process_pool::Record const& record, std::span<std::byte const> payload) {
+			if (worker.in_flight.empty() || worker.in_flight.front() != record.index) {
+				throw std::runtime_error("Fitness worker answered out of order");
+			}
+			worker.in_flight.pop_front();
+			costs[record.index] = process_pool::decode<Cost>(payload);
+		})) {
+			++collected;
+		}
+		// Worker could wait for room in responses
+		if (collected) process_pool::signal(worker.to_worker);
+		return collected;
+	}
+
+	bool exited(Worker& worker) {
+		int status;
+		pid_t const result = ::waitpid(worker.pid, &status, WNOHANG);
+		if (result == 0) return false;
+		worker.pid = -1;
+		close_exit_event(worker);
+		return true;
+	}
+
+	// Worker died: specimen it was scoring is to blame, the rest of its queue is just sent again
+	void recover(Worker& worker) {
+		if (!worker.in_flight.empty()) {
+			std::size_t const culprit = worker.in_flight.front();
+			if (++attempts[culprit] >= max_attempts) {
+				worker.in_flight.clear();
+				start(worker);
+				++restarted;
+				throw std::runtime_error("Fitness worker died " + std::to_string(max_attempts) + " times on specimen " + std::to_string(culprit));
+			}
+			retries.insert(retries.begin(), worker.in_flight.begin(), worker.in_flight.end());
+			worker.in_flight.clear();
+		}
+		start(worker);
+		++restarted;
+	}
+
+	void restart(Worker& worker) {
+		stop(worker, true);
+		worker.in_flight.clear();
+		start(worker);
+		++restarted;
+	}
+
+	void stop(Worker& worker, bool kill) {
+		if (worker.pid > 0) {
+			if (kill) {
+				::kill(worker.pid, SIGKILL);
+			} else {
+				worker.channel->stop.store(1, std::memory_order_release);
+				process_pool::signal(worker.to_worker);
+			}
+			while (::waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) { }
+			worker.pid = -1;
+		}
+		close_exit_event(worker);
+	}
+
+	void close_exit_event(Worker& worker) {
+		if (worker.exit_event >= 0) ::close(worker.exit_event);
+		worker.exit_event = -1;
+	}
+
+	void shutdown() {
+		for (auto& worker : pool) {
+			stop(worker, !worker.in_flight.empty());
+			if (worker.to_worker >= 0) ::close(worker.to_worker);
+			if (worker.to_parent >= 0) ::close(worker.to_parent);
+			if (worker.memory) ::munmap(worker.memory, worker.memory_bytes);
+			worker = Worker();
+		}
+	}
+};
+
+} // namespace genetics
+
+#endif //__GENETICS_WORKERS_H
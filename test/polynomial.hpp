@@ -0,0 +1,335 @@
+#ifndef __GENETICS_TEST_POLYNOMIAL_H
+#define __GENETICS_TEST_POLYNOMIAL_H
+
+// Polynomial regression problem of test03, shared with benchmarks
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+
+#include "../include/genetics.hpp"
+
+typedef float domain_t;
+typedef std::vector<domain_t> Polynomial;
+
+inline domain_t interpret(Polynomial const& polynomial, domain_t variable) {
+	if (polynomial.size() == 0) return static_cast<domain_t>(0);
+	domain_t result = polynomial[polynomial.size()-1];
+	for (size_t i = 1; i < polynomial.size(); ++i) {
+		result = result * variable + polynomial[polynomial.size()-i-1];
+	}
+	return result;
+}
+
+inline std::string listing(Polynomial polynomial, std::string varname = "x") {
+	std::string result = "";
+	for (size_t i = 0; i < polynomial.size(); ++i) {
+		//if (polynomial[polynomial.size()-i-1] == 0) continue;
+		if (result == "") {
+			result = std::to_string(polynomial[polynomial.size()-i-1]) + (i < polynomial.size()-1 ? varname : "") + (polynomial.size() >= 3 && i < polynomial.size() - 2 ? std::string("^") + std::to_string(polynomial.size()-i-1) : "");
+		} else {
+			if (polynomial[polynomial.size()-i-1] >= 0) {
+				result += " + " + std::to_string(polynomial[polynomial.size()-i-1]);
+			} else {
+				result += " - " + std::to_string(-polynomial[polynomial.size()-i-1]);
+			}
+			result += (i < polynomial.size()-1 ? varname : "") + (i < polynomial.size() - 2 ? std::string("^") + std::to_string(polynomial.size()-i-1) : "");
+		}
+	}
+	if (result == "") return "0";
+	else return result.substr(0, result.size()-3);
+}
+
+inline double difference_with(Polynomial const& one, Polynomial const& another) {
+	double result = 0, monomial_difference;
+	size_t min_size = std::min(one.size(), another.size()),
+		   max_size = std::max(one.size(), another.size());
+
+	for (size_t i = 0; i < min_size; ++i) {
+		// MAGIC!
+		/*
+		monomial_difference = -(std::min(one[i], another[i]) - std::max(one[i], another[i]))
+							  / std::max(std::max(one[i], another[i]), -std::min(one[i], another[i]));
+		*/
+
+		// Less magic
+		domain_t coefficient_distance = std::max(one[i], another[i]) - std::min(one[i], another[i]);
+		domain_t maximum_absolute_coefficient = std::max(std::abs(one[i]), std::abs(another[i]));
+
+		monomial_difference = coefficient_distance / maximum_absolute_coefficient; // With normalization
+		//monomial_difference = coefficient_distance; // Without normalization
+
+		result += monomial_difference * i; // Greater power - greater importance
+		//result += monomial_difference; // Plain
+	}
+
+	// MORE MAGIC!!!
+	// Why arithmetic progression? It's like monomial_difference for all other coefficients is 1.
+	result += static_cast<double>(min_size + max_size - 1) * (max_size - min_size) / 2;
+	//result += max_size - min_size;
+
+	result /= (static_cast<double>(max_size - 1) * max_size / 2); // Normilize result (with greatest progression member)
+	//result /= max_size; // Normilize result (with polynomial degree)
+
+	return result;
+};
+
+class PolynomialCost {
+	private:
+		domain_t inaccuracy;
+		size_t size;
+
+		friend std::ostream& operator<<(std::ostream& os, PolynomialCost const& c);
+
+	public:
+		friend void swap(PolynomialCost& one, PolynomialCost& another) {
+			using std::swap;
+			swap(one.inaccuracy, another.inaccuracy);
+			swap(one.size, another.size);
+		}
+		PolynomialCost() : inaccuracy(.0), size(0) { }
+		PolynomialCost(domain_t inaccuracy, size_t size) : inaccuracy(inaccuracy), size(size) { }
+		PolynomialCost(PolynomialCost const& another) : inaccuracy(another.inaccuracy), size(another.size) { }
+		PolynomialCost(PolynomialCost&& another) {
+			swap(*this, another);
+		}
+		PolynomialCost& operator=(PolynomialCost another) {
+			swap(*this, another);
+			return *this;
+		}
+
+		bool operator==(PolynomialCost const& another) const {
+			return (inaccuracy == another.inaccuracy && size == another.size);
+		}
+		bool operator!=(PolynomialCost const& another) const {
+			return (!(*this == another));
+		}
+
+		bool operator<(PolynomialCost const& another) const {
+			return ((inaccuracy < another.inaccuracy) || (inaccuracy == another.inaccuracy && size < another.size));
+		}
+		bool operator>=(PolynomialCost const& another) const {
+			return (!(*this < another));
+		}
+		bool operator>(PolynomialCost const& another) const {
+			return (*this >= another && *this != another);
+		}
+		bool operator<=(PolynomialCost const& another) const {
+			return (!(*this > another));
+		}
+
+		size_t get_size() const {
+			return size;
+		}
+		domain_t get_inaccuracy() const {
+			return inaccuracy;
+		}
+};
+
+inline std::ostream& operator<<(std::ostream& os, PolynomialCost const& c) {
+	return (os << "(" << c.inaccuracy << "; " << c.size << ")");
+}
+
+inline PolynomialCost get_polynomial_cost(Polynomial const& polynomial, std::vector<std::pair<domain_t, domain_t>> const& target) {
+	domain_t inaccuracy = 0.f;
+	for (auto&& testcase : target) {
+		domain_t output = interpret(polynomial, testcase.first);
+		//temp = (std::max(testcase.second, temp) - std::min(testcase.second, temp));
+		inaccuracy += (testcase.second - output) * (testcase.second - output);
+	}
+	return PolynomialCost(inaccuracy, polynomial.size());
+}
+
+class PolyFitness : public genetics::IPointwiseFitness<Polynomial, PolynomialCost> {
+public:
+	PolyFitness(std::vector<std::pair<domain_t, domain_t>> target, bool bounded = false) : target(target), bounded(bounded) { }
+	~PolyFitness() override = default;
+
+	PolynomialCost cost(Polynomial const& polynomial, std::size_t age) const override {
+		return get_polynomial_cost(polynomial, target);
+	}
+
+	// Squared errors only add up, so tests are stopped, once inaccuracy is worse than cutoff
+	bool is_bounded() const override { return bounded; }
+	PolynomialCost bounded_cost(Polynomial const& polynomial, std::size_t age, PolynomialCost const& cutoff) const override {
+		domain_t inaccuracy = 0.f;
+		for (auto&& testcase : target) {
+			domain_t output = interpret(polynomial, testcase.first);
+			inaccuracy += (testcase.second - output) * (testcase.second - output);
+			if (cutoff < PolynomialCost(inaccuracy, polynomial.size())) break;
+		}
+		return PolynomialCost(inaccuracy, polynomial.size());
+	}
+
+private:
+	std::vector<std::pair<domain_t, domain_t>> target;
+	bool bounded;
+};
+
+class PolyCrossover : public genetics::ICrossover<Polynomial, PolynomialCost> {
+public:
+	~PolyCrossover() override = default;
+
+	bool does_commute() const { return false; } // Is crossover symmetric?
+	
+	Polynomial cross(genetics::Generation<Polynomial> const& generation, genetics::GenerationsCosts<PolynomialCost> const& costs, std::size_t parent1, std::size_t parent2, genetics::RandomStream& random) override {
+		Polynomial new_polynomial;
+		cross_into(generation, costs, parent1, parent2, random, new_polynomial);
+		return new_polynomial;
+	}
+
+	// Written over offspring, so that a recycled polynomial keeps its memory
+	void cross_into(genetics::Generation<Polynomial> const& generation, genetics::GenerationsCosts<PolynomialCost> const& costs, std::size_t parent1, std::size_t parent2,
+	                genetics::RandomStream& random, Polynomial& new_polynomial) override {
+		auto& polynomials = std::get<genetics::SPECIMENS_ID>(generation);
+		auto& ages = std::get<genetics::AGE_ID>(generation);
+
+
+		auto& one = polynomials[parent1];
+		auto& another = polynomials[parent2];
+
+		// Generate new poly
+		size_t first_joint = random.get_random_int<size_t>(0, one.size()),
+			   second_joint = random.get_random_int<size_t>(0, another.size());
+		new_polynomial.resize(first_joint + another.size() - second_joint);
+		std::copy_n(std::begin(one), first_joint, std::begin(new_polynomial));
+		std::copy_n(std::next(std::begin(another), second_joint), another.size() - second_joint, std::next(std::begin(new_polynomial), first_joint));
+
+		// How similar parents are?
+		/*
+		domain_t cumulative_sum = 0;
+		size_t const min_size = std::min(one.size(), another.size());
+
+		for (size_t i = 0; i < min_size; ++i) {
+			cumulative_sum += std::abs(one[i] - another[i]);
+		}
+
+		double const similarity = (10.0 * min_size - cumulative_sum) / (10.0 * min_size);
+		*/
+		double const similarity = difference_with(one, another);
+
+		// Will new poly mutate and how?
+		double constexpr mutation_probability = 0.5;
+
+		// Note: yep, with similarity > 0.5, there always will be a mutation
+		if (random.get_random_float<double>(0.0, 1.0) > mutation_probability + similarity
+			|| new_polynomial.size() == 0) {
+			return;
+		}
+
+		// There can be 6 types of mutation: changing coefficient value, (inserting/losing) a coefficient, cutting (head/tail) and "knockoff"
+		std::size_t choice = random.get_random_int<std::size_t>(0, 5);
+		switch (choice) {
+		case 0: { // change coefficient value
+			domain_t update = random.get_random_float<domain_t>(-3.f, 3.f);
+			for (auto& coefficient : new_polynomial) {
+				coefficient *= update;
+			}
+			break;
+		}
+		case 1: { // insert new coefficients/monomials
+			size_t how_much = random.get_random_int<size_t>(0, new_polynomial.size() / 4);
+			size_t cell;
+			for (size_t i = 0; i < how_much; ++i) {
+				cell = random.get_random_int<size_t>(0, new_polynomial.size() - 1);
+				new_polynomial.insert(std::next(std::begin(new_polynomial), cell),
+				                      random.get_random_float<domain_t>(-1.f, 1.f));
+			}
+			break;
+		}
+		case 2: { // remove/zero coefficients/monimials
+			size_t how_much = random.get_random_int<size_t>(0, new_polynomial.size() / 4);
+			size_t cell;
+			for (size_t i = 0; i < how_much; ++i) {
+				cell = random.get_random_int<size_t>(0, new_polynomial.size()-1);
+				new_polynomial[cell] = 0.f;
+			}
+			break;
+		}
+		case 3: { // cut poly head
+			size_t cell = random.get_random_int<size_t>(0, new_polynomial.size() - 1);
+			new_polynomial.erase(std::begin(new_polynomial), std::next(std::begin(new_polynomial), cell));
+			break;
+		}
+		case 4: { // cut poly tail
+			size_t cell = random.get_random_int<size_t>(0, new_polynomial.size() - 1);
+			new_polynomial.erase(std::next(std::begin(new_polynomial), cell + 1), std::end(new_polynomial));
+			break;
+		}
+		case 5: // "knock-off"
+			for (auto& coefficient : new_polynomial) {
+				coefficient = std::max(-0.25f, std::min(coefficient, 0.25f));
+			}
+			break;
+		}
+	}
+};
+
+class PolySelection : public genetics::ISelection<Polynomial, PolynomialCost> {
+public:
+	PolySelection(std::size_t gen_survivors, std::size_t max_generations_til_end) : gen_survivors(gen_survivors), max_generations_til_end(max_generations_til_end) { }
+	~PolySelection() override = default;
+
+	bool is_good_enough(Polynomial const& specimen, PolynomialCost const& cost) {
+		return cost.get_inaccuracy() < .001;
+	}
+
+	// Number of specimens selected from each generation.
+	std::size_t survivors() const override { return gen_survivors; }
+	void set_survivors(std::size_t new_val) { gen_survivors = new_val; }
+
+	// Limit of generations for one evolve call
+	std::optional<std::size_t> max_generations() const override { return max_generations_til_end; }
+	void set_max_generations(std::size_t new_val) { max_generations_til_end = new_val; }
+
+	// Selection will be performed only every generations_till_eliminaion generations
+	std::size_t generations_till_eliminaion() const override { return generations_per_phase; }
+	void set_generations_till_elimination(std::size_t new_val) { generations_per_phase = new_val; }
+
+private:
+	std::size_t gen_survivors;
+	std::size_t max_generations_til_end;
+	std::size_t generations_per_phase = 1;
+};
+
+// Inaccuracy and size as separate objectives, instead of lexicographic order of PolynomialCost
+class PolyObjectives : public genetics::IObjectives<PolynomialCost> {
+public:
+	~PolyObjectives() override = default;
+
+	std::size_t objectives() const override { return 2; }
+
+	void values(PolynomialCost const& cost, std::span<double> out) const override {
+		out[0] = cost.get_inaccuracy();
+		out[1] = static_cast<double>(cost.get_size());
+	}
+};
+
+// Polynomials are similar, if they give similar values on tests
+class PolySimilarity : public genetics::ISimilarity<Polynomial, PolynomialCost> {
+public:
+	PolySimilarity(std::vector<std::pair<domain_t, domain_t>> target, float radius, std::size_t capacity)
+	  : target(target), radius(radius), capacity(capacity) { }
+	~PolySimilarity() override = default;
+
+	std::size_t dimensions() const override { return target.size(); }
+
+	void features(Polynomial const& polynomial, std::span<float> out) const override {
+		for (std::size_t i = 0; i < target.size(); ++i) {
+			out[i] = interpret(polynomial, target[i].first);
+		}
+	}
+
+	float niche_radius() const override { return radius; }
+	std::size_t niche_capacity() const override { return capacity; }
+
+private:
+	std::vector<std::pair<domain_t, domain_t>> target;
+	float radius;
+	std::size_t capacity;
+};
+
+#endif //__GENETICS_TEST_POLYNOMIAL_H
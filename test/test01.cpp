@@ -16,12 +16,16 @@ public:
 
 	void cost(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t>& costs) override {
 		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+		std::size_t const known = costs.size();
 		costs.resize(specimens.size());
-		std::transform(begin(specimens), end(specimens), begin(costs), [](gene_t const& specimen) -> cost_t {
+		std::transform(std::next(begin(specimens), known), end(specimens), std::next(begin(costs), known), [](gene_t const& specimen) -> cost_t {
 			gene_t constexpr ideal = 100;
 			return static_cast<cost_t>(std::max(specimen, ideal) - std::min(specimen, ideal));
 		});
 	}
+
+	// Survivors keep their costs
+	bool incremental() const override { return true; }
 };
 
 class Crossover : public genetics::ICrossover<gene_t, cost_t> {
@@ -30,13 +34,13 @@ public:
 
 	bool does_commute() const override { return true; }
 
-	gene_t cross(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t> const& costs, std::size_t parent1, std::size_t parent2) {
+	gene_t cross(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t> const& costs, std::size_t parent1, std::size_t parent2, genetics::RandomStream& random) override {
 		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
 		gene_t new_specimen = (specimens[parent1] + specimens[parent2]) / 2;
 
 		// Mutation
-		if (genetics::RandomGenerator::get_instance().get_random_float<float>(0.f, 1.f) < 0.3f) {
-			if (genetics::RandomGenerator::get_instance().get_random_int<int>(0, 1)) {
+		if (random.get_random_float<float>(0.f, 1.f) < 0.3f) {
+			if (random.get_random_int<int>(0, 1)) {
 				--new_specimen;
 			} else {
 				++new_specimen;
@@ -45,6 +49,24 @@ public:
 
 		return new_specimen;
 	}
+
+	// Genome is trivial, so per-offspring virtual call would cost more than crossover itself
+	bool fixed_offspring_amount() const override { return true; }
+
+	void cross_batch(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t> const& costs, std::span<genetics::Mating const> matings,
+	                 genetics::RandomStreams const& streams, genetics::Population<gene_t>& offspring) override {
+		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+		for (auto const& mating : matings) {
+			for (std::size_t count = 0; count < mating.count; ++count) {
+				genetics::RandomStream random = streams.stream(mating.pair, count);
+				gene_t new_specimen = (specimens[mating.parent1] + specimens[mating.parent2]) / 2;
+				if (random.get_random_float<float>(0.f, 1.f) < 0.3f) {
+					new_specimen += random.get_random_int<int>(0, 1) ? -1 : 1;
+				}
+				offspring.push_back(new_specimen);
+			}
+		}
+	}
 };
 
 class Selection : public genetics::ISelection<gene_t, cost_t> {
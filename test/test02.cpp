@@ -0,0 +1,96 @@
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+
+#include "../include/genetics.hpp"
+#include "../include/genetics_checkpoint.hpp"
+#include "polynomial.hpp"
+
+// Checkpoints: big population of trivial genomes, and resumed polynomial regression
+
+using namespace std;
+
+template <>
+struct genetics::Serializer<PolynomialCost> {
+	struct Packed {
+		domain_t inaccuracy;
+		std::uint64_t size;
+	};
+
+	static void write(PolynomialCost const& cost, std::vector<std::byte>& out) {
+		Packed const packed{cost.get_inaccuracy(), cost.get_size()};
+		auto const bytes = std::as_bytes(std::span(&packed, 1));
+		out.insert(out.end(), bytes.begin(), bytes.end());
+	}
+
+	static PolynomialCost read(std::span<std::byte const> bytes) {
+		Packed packed;
+		std::memcpy(&packed, bytes.data(), sizeof(Packed));
+		return PolynomialCost(packed.inaccuracy, packed.size);
+	}
+};
+
+double seconds_since(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char const *argv[]) {
+	string const path = (filesystem::temp_directory_path() / "genetics_test02.checkpoint").string();
+
+	// Trivially copyable genomes are written and read as one block
+	{
+		size_t const size = 10'000'000;
+		vector<long long> specimens(size);
+		genetics::RandomStream(1, 0).fill_random_int<long long>(specimens, -1000, 1000);
+		auto generation = genetics::new_generation(std::move(specimens));
+		genetics::GenerationsCosts<size_t> costs(size, 7);
+
+		auto start = chrono::steady_clock::now();
+		genetics::save_checkpoint(path, generation, costs, 42);
+		cout << "Saved " << size << " specimens in " << seconds_since(start) << " s" << endl;
+
+		start = chrono::steady_clock::now();
+		auto restored = genetics::load_checkpoint<long long, size_t>(path);
+		cout << "Loaded them in " << seconds_since(start) << " s" << endl;
+
+		bool const same = std::get<genetics::SPECIMENS_ID>(restored.generation) == std::get<genetics::SPECIMENS_ID>(generation)
+		                  && restored.costs == costs && restored.seed == 42;
+		cout << (same ? "Restored population is the same" : "RESTORED POPULATION DIFFERS") << endl << endl;
+	}
+
+	// Polynomial regression, interrupted and resumed: result must be the same as without interruption
+	{
+		vector<pair<domain_t, domain_t>> const target = {{0, 1}, {1, 3}, {2, 7}, {3, 13}};
+		auto fitness = make_shared<PolyFitness>(target);
+		auto crossover = make_shared<PolyCrossover>();
+		auto selection = make_shared<PolySelection>(30, 5);
+		uint64_t const seed = 2024;
+
+		genetics::RandomStream random(seed, 0);
+		vector<Polynomial> polynomials(30);
+		for (auto& polynomial : polynomials) {
+			polynomial.resize(random.get_random_int<size_t>(1, 6));
+			random.fill_random_float<domain_t>(polynomial, -5.f, 5.f);
+		}
+
+		genetics::GenerationsCosts<PolynomialCost> costs;
+		genetics::Environment<Polynomial, PolynomialCost> world(fitness, crossover, selection, 1, seed);
+		auto halfway = world.evolve(genetics::new_generation(polynomials), costs);
+		genetics::save_checkpoint(path, halfway, costs, world.seed());
+		auto uninterrupted = world.evolve(std::move(halfway), costs);
+
+		auto checkpoint = genetics::load_checkpoint<Polynomial, PolynomialCost>(path);
+		genetics::Environment<Polynomial, PolynomialCost> another_world(fitness, crossover, selection, 1, checkpoint.seed);
+		auto resumed = another_world.evolve(std::move(checkpoint.generation), checkpoint.costs);
+
+		cout << "Generations: " << std::get<genetics::GENERATION_COUNT_ID>(uninterrupted) << " and " << std::get<genetics::GENERATION_COUNT_ID>(resumed) << endl;
+		cout << "Best: " << listing(std::get<genetics::SPECIMENS_ID>(resumed)[0]) << "; fitness = " << checkpoint.costs[0] << endl;
+		bool const same = std::get<genetics::SPECIMENS_ID>(resumed) == std::get<genetics::SPECIMENS_ID>(uninterrupted)
+		                  && std::get<genetics::AGE_ID>(resumed) == std::get<genetics::AGE_ID>(uninterrupted)
+		                  && checkpoint.costs == costs;
+		cout << (same ? "Resumed run is the same as uninterrupted one" : "RESUMED RUN DIFFERS") << endl;
+	}
+
+	filesystem::remove(path);
+	return 0;
+}
@@ -7,278 +7,13 @@
 #include <random>
 #include <iterator>
 #include <cmath>
+#include <thread>
 
 #include "../include/genetics.hpp"
-
-typedef float domain_t;
-typedef std::vector<domain_t> Polynomial;
-
-domain_t interpret(Polynomial polynomial, domain_t variable) {
-	if (polynomial.size() == 0) return static_cast<domain_t>(0);
-	domain_t result = polynomial[polynomial.size()-1];
-	for (size_t i = 1; i < polynomial.size(); ++i) {
-		result = result * variable + polynomial[polynomial.size()-i-1];
-	}
-	return result;
-}
-
-std::string listing(Polynomial polynomial, std::string varname = "x") {
-	std::string result = "";
-	for (size_t i = 0; i < polynomial.size(); ++i) {
-		//if (polynomial[polynomial.size()-i-1] == 0) continue;
-		if (result == "") {
-			result = std::to_string(polynomial[polynomial.size()-i-1]) + (i < polynomial.size()-1 ? varname : "") + (polynomial.size() >= 3 && i < polynomial.size() - 2 ? std::string("^") + std::to_string(polynomial.size()-i-1) : "");
-		} else {
-			if (polynomial[polynomial.size()-i-1] >= 0) {
-				result += " + " + std::to_string(polynomial[polynomial.size()-i-1]);
-			} else {
-				result += " - " + std::to_string(-polynomial[polynomial.size()-i-1]);
-			}
-			result += (i < polynomial.size()-1 ? varname : "") + (i < polynomial.size() - 2 ? std::string("^") + std::to_string(polynomial.size()-i-1) : "");
-		}
-	}
-	if (result == "") return "0";
-	else return result.substr(0, result.size()-3);
-}
-
-double difference_with(Polynomial const& one, Polynomial const& another) {
-	double result = 0, monomial_difference;
-	size_t min_size = std::min(one.size(), another.size()),
-		   max_size = std::max(one.size(), another.size());
-
-	for (size_t i = 0; i < min_size; ++i) {
-		// MAGIC!
-		/*
-		monomial_difference = -(std::min(one[i], another[i]) - std::max(one[i], another[i]))
-							  / std::max(std::max(one[i], another[i]), -std::min(one[i], another[i]));
-		*/
-
-		// Less magic
-		domain_t coefficient_distance = std::max(one[i], another[i]) - std::min(one[i], another[i]);
-		domain_t maximum_absolute_coefficient = std::max(std::abs(one[i]), std::abs(another[i]));
-
-		monomial_difference = coefficient_distance / maximum_absolute_coefficient; // With normalization
-		//monomial_difference = coefficient_distance; // Without normalization
-
-		result += monomial_difference * i; // Greater power - greater importance
-		//result += monomial_difference; // Plain
-	}
-
-	// MORE MAGIC!!!
-	// Why arithmetic progression? It's like monomial_difference for all other coefficients is 1.
-	result += static_cast<double>(min_size + max_size - 1) * (max_size - min_size) / 2;
-	//result += max_size - min_size;
-
-	result /= (static_cast<double>(max_size - 1) * max_size / 2); // Normilize result (with greatest progression member)
-	//result /= max_size; // Normilize result (with polynomial degree)
-
-	return result;
-};
-
-class PolynomialCost {
-	private:
-		domain_t inaccuracy;
-		size_t size;
-
-		friend std::ostream& operator<<(std::ostream& os, PolynomialCost const& c);
-
-	public:
-		friend void swap(PolynomialCost& one, PolynomialCost& another) {
-			using std::swap;
-			swap(one.inaccuracy, another.inaccuracy);
-			swap(one.size, another.size);
-		}
-		PolynomialCost() : inaccuracy(.0), size(0) { }
-		PolynomialCost(domain_t inaccuracy, size_t size) : inaccuracy(inaccuracy), size(size) { }
-		PolynomialCost(PolynomialCost const& another) : inaccuracy(another.inaccuracy), size(another.size) { }
-		PolynomialCost(PolynomialCost&& another) {
-			swap(*this, another);
-		}
-		PolynomialCost& operator=(PolynomialCost another) {
-			swap(*this, another);
-			return *this;
-		}
-
-		bool operator==(PolynomialCost const& another) const {
-			return (inaccuracy == another.inaccuracy && size == another.size);
-		}
-		bool operator!=(PolynomialCost const& another) const {
-			return (!(*this == another));
-		}
-
-		bool operator<(PolynomialCost const& another) const {
-			return ((inaccuracy < another.inaccuracy) || (inaccuracy == another.inaccuracy && size < another.size));
-		}
-		bool operator>=(PolynomialCost const& another) const {
-			return (!(*this < another));
-		}
-		bool operator>(PolynomialCost const& another) const {
-			return (*this >= another && *this != another);
-		}
-		bool operator<=(PolynomialCost const& another) const {
-			return (!(*this > another));
-		}
-
-		size_t get_size() const {
-			return size;
-		}
-		domain_t get_inaccuracy() const {
-			return inaccuracy;
-		}
-};
-
-std::ostream& operator<<(std::ostream& os, PolynomialCost const& c) {
-	return (os << "(" << c.inaccuracy << "; " << c.size << ")");
-}
-
-PolynomialCost get_polynomial_cost(Polynomial const& polynomial, std::vector<std::pair<domain_t, domain_t>> const& target) {
-	domain_t inaccuracy = 0.f;
-	for (auto&& testcase : target) {
-		domain_t output = interpret(polynomial, testcase.first);
-		//temp = (std::max(testcase.second, temp) - std::min(testcase.second, temp));
-		inaccuracy += (testcase.second - output) * (testcase.second - output);
-	}
-	return PolynomialCost(inaccuracy, polynomial.size());
-}
-
-class PolyFitness : public genetics::IFitness<Polynomial, PolynomialCost> {
-public:
-	PolyFitness(std::vector<std::pair<domain_t, domain_t>> target) : target(target) { }
-	~PolyFitness() override = default;
-
-	void cost(genetics::Generation<Polynomial> const& generation, genetics::GenerationsCosts<PolynomialCost>& costs) override {
-		auto& polynomials = std::get<genetics::SPECIMENS_ID>(generation);
-		auto& ages = std::get<genetics::AGE_ID>(generation);
-
-		for (size_t index = 0; index < polynomials.size(); ++index) {
-			costs.emplace_back(get_polynomial_cost(polynomials[index], target));
-		}
-	}
-
-private:
-	std::vector<std::pair<domain_t, domain_t>> target;
-};
-
-class PolyCrossover : public genetics::ICrossover<Polynomial, PolynomialCost> {
-public:
-	~PolyCrossover() override = default;
-
-	bool does_commute() const { return false; } // Is crossover symmetric?
-	
-	Polynomial cross(genetics::Generation<Polynomial> const& generation, genetics::GenerationsCosts<PolynomialCost> const& costs, std::size_t parent1, std::size_t parent2) override {
-		auto& polynomials = std::get<genetics::SPECIMENS_ID>(generation);
-		auto& ages = std::get<genetics::AGE_ID>(generation);
-
-
-		auto& one = polynomials[parent1];
-		auto& another = polynomials[parent2];
-
-		// Generate new poly
-		size_t first_joint = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, one.size()),
-			   second_joint = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, another.size());
-		Polynomial new_polynomial(first_joint + another.size() - second_joint);
-		std::copy_n(std::begin(one), first_joint, std::begin(new_polynomial));
-		std::copy_n(std::next(std::begin(another), second_joint), another.size() - second_joint, std::next(std::begin(new_polynomial), first_joint));
-
-		// How similar parents are?
-		/*
-		domain_t cumulative_sum = 0;
-		size_t const min_size = std::min(one.size(), another.size());
-
-		for (size_t i = 0; i < min_size; ++i) {
-			cumulative_sum += std::abs(one[i] - another[i]);
-		}
-
-		double const similarity = (10.0 * min_size - cumulative_sum) / (10.0 * min_size);
-		*/
-		double const similarity = difference_with(one, another);
-
-		// Will new poly mutate and how?
-		double constexpr mutation_probability = 0.5;
-
-		// Note: yep, with similarity > 0.5, there always will be a mutation
-		if (genetics::RandomGenerator::get_instance().get_random_float<double>(0.0, 1.0) > mutation_probability + similarity
-			|| new_polynomial.size() == 0) {
-			return new_polynomial;
-		}
-
-		// There can be 6 types of mutation: changing coefficient value, (inserting/losing) a coefficient, cutting (head/tail) and "knockoff"
-		std::size_t choice = genetics::RandomGenerator::get_instance().get_random_int<std::size_t>(0, 5);
-		switch (choice) {
-		case 0: { // change coefficient value
-			domain_t update = genetics::RandomGenerator::get_instance().get_random_float<domain_t>(-3.f, 3.f);
-			for (auto& coefficient : new_polynomial) {
-				coefficient *= update;
-			}
-			break;
-		}
-		case 1: { // insert new coefficients/monomials
-			size_t how_much = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, new_polynomial.size() / 4);
-			size_t cell;
-			for (size_t i = 0; i < how_much; ++i) {
-				cell = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, new_polynomial.size() - 1);
-				new_polynomial.insert(std::next(std::begin(new_polynomial), cell),
-				                      genetics::RandomGenerator::get_instance().get_random_float<domain_t>(-1.f, 1.f));
-			}
-			break;
-		}
-		case 2: { // remove/zero coefficients/monimials
-			size_t how_much = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, new_polynomial.size() / 4);
-			size_t cell;
-			for (size_t i = 0; i < how_much; ++i) {
-				cell = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, new_polynomial.size()-1);
-				new_polynomial[cell] = 0.f;
-			}
-			break;
-		}
-		case 3: { // cut poly head
-			size_t cell = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, new_polynomial.size() - 1);
-			new_polynomial.erase(std::begin(new_polynomial), std::next(std::begin(new_polynomial), cell));
-			break;
-		}
-		case 4: { // cut poly tail
-			size_t cell = genetics::RandomGenerator::get_instance().get_random_int<size_t>(0, new_polynomial.size() - 1);
-			new_polynomial.erase(std::next(std::begin(new_polynomial), cell + 1), std::end(new_polynomial));
-			break;
-		}
-		case 5: // "knock-off"
-			for (auto& coefficient : new_polynomial) {
-				coefficient = std::max(-0.25f, std::min(coefficient, 0.25f));
-			}
-			break;
-		}
-
-		return new_polynomial;
-	}
-};
-
-class PolySelection : public genetics::ISelection<Polynomial, PolynomialCost> {
-public:
-	PolySelection(std::size_t gen_survivors, std::size_t max_generations_til_end) : gen_survivors(gen_survivors), max_generations_til_end(max_generations_til_end) { }
-	~PolySelection() override = default;
-
-	bool is_good_enough(Polynomial const& specimen, PolynomialCost const& cost) {
-		return cost.get_inaccuracy() < .001;
-	}
-
-	// Number of specimens selected from each generation.
-	std::size_t survivors() const override { return gen_survivors; }
-	void set_survivors(std::size_t new_val) { gen_survivors = new_val; }
-
-	// Limit of generations for one evolve call
-	std::optional<std::size_t> max_generations() const override { return max_generations_til_end; }
-	void set_max_generations(std::size_t new_val) { max_generations_til_end = new_val; }
-
-	// Selection will be performed only every generations_till_eliminaion generations
-	std::size_t generations_till_eliminaion() const override { return generations_per_phase; }
-	void set_generations_till_elimination(std::size_t new_val) { generations_per_phase = new_val; }
-
-private:
-	std::size_t gen_survivors;
-	std::size_t max_generations_til_end;
-	std::size_t generations_per_phase = 1;
-};
-
+#include "../include/genetics_cache.hpp"
+#include "../include/genetics_observer.hpp"
+#include "../include/genetics_session.hpp"
+#include "polynomial.hpp"
 
 int main() {
 	std::vector<std::pair<domain_t, domain_t>> target;
@@ -299,12 +34,13 @@ int main() {
 	std::cout << "How many survivors may live each generation? " << std::flush;
 	std::cin >> survivors;
 
+	genetics::RandomStream random(genetics::random_seed(), 0);
 	std::vector<Polynomial> initial_polys;
 	for (size_t i = 0; i < survivors; ++i) {
 		Polynomial pbuffer;
-		std::size_t const guessed_length = genetics::RandomGenerator::get_instance().get_random_int<std::size_t>(0, 10);
+		std::size_t const guessed_length = random.get_random_int<std::size_t>(0, 10);
 		for (size_t j = 0; j < guessed_length; ++j) {
-			pbuffer.push_back(genetics::RandomGenerator::get_instance().get_random_float<domain_t>(-10.f, 10.f));
+			pbuffer.push_back(random.get_random_float<domain_t>(-10.f, 10.f));
 		}
 		initial_polys.push_back(std::move(pbuffer));
 	}
@@ -313,15 +49,21 @@ int main() {
 
 	auto fitness = std::make_shared<PolyFitness>(target);
 	auto crossover = std::make_shared<PolyCrossover>();
-	auto selection = std::make_shared<PolySelection>(survivors, generation_cap); // TODO: NOT gencap. I want to see progress
+	auto selection = std::make_shared<PolySelection>(survivors, generation_cap);
+
+	// Converged population is full of duplicates
+	auto cached_fitness = std::make_shared<genetics::CachedPointwiseFitness<Polynomial, PolynomialCost>>(fitness, 1 << 20);
 
-	genetics::Environment<Polynomial, PolynomialCost> world(fitness, crossover, selection);
+	genetics::Environment<Polynomial, PolynomialCost> world(cached_fitness, crossover, selection, std::max(1u, std::thread::hardware_concurrency()));
 
 	//std::size_t const gens_till_death = 1;
 	std::size_t const gens_till_death = 3; // XXX: VERY HEAVY. Initial survivors should be calculated carefully. Even "13" is big enough. "20" won't fit in 32 GB.
 	                                       //      But! This gives an unparalleled variety of specimen to algo.
 	selection->set_generations_till_elimination(gens_till_death);
 
+	// Converged population is full of near copies of the best: only a few of those, which give similar values, survive
+	world.set_similarity(std::make_shared<PolySimilarity>(target, 0.05f, 2));
+
 	genetics::GenerationsCosts<PolynomialCost> how_fit;
 
 	char ans;
@@ -329,67 +71,30 @@ int main() {
 	std::cin.get();
 	std::cin.get(ans);
 	if (ans == 'y' || ans == 'Y') {
-		fitness->cost(the_nonglitch, how_fit);
 		auto& specimens = std::get<genetics::SPECIMENS_ID>(the_nonglitch);
 		for (size_t i = 0; i < specimens.size(); ++i)
-			std::cout << listing(specimens.at(i)) << "; fitness = " << how_fit[i] << std::endl;
+			std::cout << listing(specimens.at(i)) << "; fitness = " << fitness->cost(specimens.at(i), 0) << std::endl;
 	}
 	std::cout << std::endl;
 
-	std::size_t matings = survivors * (survivors - 1);
-	for (std::size_t i = 1; i < gens_till_death; ++i) matings *= matings - 1;
-
-	// Tries to write a "." every time when another 1 hundred million matings occured.
-	if (matings > 100'000'000) {
-		double how_many_gens_for_10k_matings = 100'000'000.0 / matings;
-
-		std::size_t new_gen_cap = std::max(static_cast<std::size_t>(how_many_gens_for_10k_matings), gens_till_death);
-		double generation_pool = 0.0;
-
-		std::cout << "Wait for world history to happen " << std::flush;
-
-		selection->set_max_generations(new_gen_cap);
-
-		size_t full_iterations = generation_cap / new_gen_cap;
-
-		bool target_achieved = false;
-		std::size_t old_generation_count = 0;
-		for (size_t i = 0; i < full_iterations; ++i) {
-			the_nonglitch = world.evolve(std::move(the_nonglitch));
-
-			auto& specimens = std::get<genetics::SPECIMENS_ID>(the_nonglitch);
-			auto& generation_count = std::get<genetics::GENERATION_COUNT_ID>(the_nonglitch);
-
-			if (selection->is_good_enough(specimens[0], get_polynomial_cost(specimens[0], target))) {
-				target_achieved = true;
-				break;
-			}
-
-			generation_pool += generation_count - old_generation_count;
-			old_generation_count = generation_count;
-			while (generation_pool >= how_many_gens_for_10k_matings) {
-				std::cout << ".";
-				generation_pool -= how_many_gens_for_10k_matings;
-			}
-			std::cout << std::flush;
-		}
-
-		if (!target_achieved) {
-			// Last gens
-			selection->set_max_generations(generation_cap - full_iterations * new_gen_cap);
-			the_nonglitch = world.evolve(std::move(the_nonglitch));
-		}
-		std::cout << std::endl << std::endl;
-	} else {
-		the_nonglitch = world.evolve(std::move(the_nonglitch));
+	// Progress: statistics of every generation, as CSV
+	world.set_observer(std::make_shared<genetics::CsvObserver<PolynomialCost>>(std::cerr));
+	// One evolve call, with a look at the best after every elimination
+	genetics::EvolutionSession<genetics::Environment<Polynomial, PolynomialCost>> session(world, std::move(the_nonglitch));
+	for (auto const& step : session) {
+		std::cout << "Generation " << step.generation_count() << ": best fitness = " << step.costs()[0] << std::endl;
 	}
+	the_nonglitch = session.release(how_fit);
+	std::cout << std::endl;
 
 	auto& specimens = std::get<genetics::SPECIMENS_ID>(the_nonglitch);
 	auto& generation_count = std::get<genetics::GENERATION_COUNT_ID>(the_nonglitch);
 	auto& ages = std::get<genetics::AGE_ID>(the_nonglitch);
 
-	how_fit.clear();
-	fitness->cost(the_nonglitch, how_fit);
+	// Offspring of the last generation are not scored, if evolution stopped before elimination
+	for (std::size_t i = how_fit.size(); i < specimens.size(); ++i) {
+		how_fit.push_back(fitness->cost(specimens[i], 0));
+	}
 
 	if (how_fit[0].get_inaccuracy() > 0.001) {
 		std::cout << "Civilization of the Nonglitch fell at generation" << generation_count << ", unable to match your goal." << std::endl << std::endl;
@@ -405,6 +110,9 @@ int main() {
 	std::cout << "Author: " << listing(specimens.at(0)) << std::endl;
 	std::cout << "Age: " << ages.value()[0] << std::endl;
 
+	auto const cache_statistics = cached_fitness->statistics();
+	std::cout << "Fitness cache: " << cache_statistics.hits << " hits, " << cache_statistics.misses << " misses" << std::endl;
+
 	std::cout << std::endl << "Other last survivors:" << std::endl;
 	for (size_t i = 1; i < std::min(specimens.size(), 20lu); ++i) {
 		std::cout << listing(specimens.at(i)) << ";\n\tfitness = " << how_fit[i] << ";\n\tage = " << ages.value()[i] << ";" << std::endl;
@@ -0,0 +1,750 @@
+#include <bit>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/genetics.hpp"
+#include "../include/genetics_arena.hpp"
+#include "../include/genetics_cache.hpp"
+#include "../include/genetics_islands.hpp"
+#include "../include/genetics_lgp.hpp"
+#include "../include/genetics_polynomial.hpp"
+#include "../include/genetics_session.hpp"
+#include "../include/genetics_spill.hpp"
+#include "polynomial.hpp"
+
+// Modes of evolution give the same results as the plain one: same survivors, ages and costs; and fitness contracts are kept
+
+using namespace std;
+
+typedef long long int gene_t;
+typedef std::size_t cost_t;
+
+// The same value in another type, so that population_traits could be specialized for it alone
+template <typename T, int Storage>
+struct Stored {
+	T value;
+
+	Stored(T value = T()) : value(value) { }
+	operator T() const { return value; }
+};
+
+enum { RAGGED, SPILL, RECYCLED, FLAT, SPILL_RAGGED };
+
+template <>
+struct genetics::population_traits<std::vector<Stored<domain_t, RAGGED>>> : genetics::ragged_population<Stored<domain_t, RAGGED>> { };
+static_assert(std::is_same_v<genetics::Population<std::vector<Stored<domain_t, RAGGED>>>, genetics::RaggedPopulation<Stored<domain_t, RAGGED>>>);
+
+// Genomes allocated so far by CountingAllocator
+std::atomic<std::size_t> genome_allocations{0};
+
+template <typename T>
+struct CountingAllocator {
+	using value_type = T;
+
+	CountingAllocator() = default;
+	template <typename U>
+	CountingAllocator(CountingAllocator<U> const&) { }
+
+	T* allocate(std::size_t n) {
+		++genome_allocations;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T* pointer, std::size_t n) { std::allocator<T>().deallocate(pointer, n); }
+
+	bool operator==(CountingAllocator const&) const = default;
+};
+
+using Recycled = std::vector<Stored<domain_t, RECYCLED>, CountingAllocator<Stored<domain_t, RECYCLED>>>;
+
+template <>
+struct genetics::population_traits<Recycled> : genetics::recycling_population<Recycled> { };
+
+using Flat = std::vector<Stored<domain_t, FLAT>, CountingAllocator<Stored<domain_t, FLAT>>>;
+
+template <>
+struct genetics::population_traits<Flat> : genetics::ragged_population<Stored<domain_t, FLAT>, CountingAllocator<Stored<domain_t, FLAT>>> { };
+
+template <>
+struct genetics::population_traits<Stored<long long, SPILL>> : genetics::spillable_population<Stored<long long, SPILL>> { };
+
+template <>
+struct genetics::population_traits<std::vector<Stored<domain_t, SPILL_RAGGED>>> : genetics::spillable_ragged_population<Stored<domain_t, SPILL_RAGGED>> { };
+
+// Old specimens are worse, so survivors depend on ages
+// Genome is gene_t, or a Stored one, for other populations
+template <typename Genome = gene_t>
+class AgingFitness : public genetics::IPointwiseFitness<Genome, cost_t> {
+public:
+	~AgingFitness() override = default;
+
+	cost_t cost(genetics::SpecimenView<Genome> stored, std::size_t age) const override {
+		gene_t constexpr ideal = 100;
+		gene_t const specimen = stored;
+		return 4 * static_cast<cost_t>(std::max(specimen, ideal) - std::min(specimen, ideal)) + age;
+	}
+
+	bool depends_on_age() const override { return true; }
+};
+
+// Counts specimens scored one by one and in batches
+class CountingFitness : public AgingFitness<> {
+public:
+	~CountingFitness() override = default;
+
+	cost_t cost(gene_t const& specimen, std::size_t age) const override {
+		++single;
+		return AgingFitness<>::cost(specimen, age);
+	}
+
+	void cost_batch(genetics::Population<gene_t> const& specimens, std::optional<std::vector<std::size_t>> const& ages,
+	                std::size_t first, std::size_t last, genetics::GenerationsCosts<cost_t>& costs) const override {
+		batched += last - first;
+		for (std::size_t i = first; i < last; ++i) {
+			costs[i] = AgingFitness<>::cost(specimens[i], ages ? ages.value()[i] : 0);
+		}
+	}
+
+	mutable std::atomic<std::size_t> single{0}, batched{0};
+};
+
+// Whole-generation fitness of the old contract: costs are empty, and every cost is pushed back
+class LegacyFitness : public genetics::IFitness<gene_t, cost_t> {
+public:
+	~LegacyFitness() override = default;
+
+	void cost(genetics::Generation<gene_t> const& generation, genetics::GenerationsCosts<cost_t>& costs) override {
+		for (auto const& specimen : std::get<genetics::SPECIMENS_ID>(generation)) {
+			costs.push_back(AgingFitness<>().cost(specimen, 0));
+		}
+	}
+};
+
+// The same, claiming to be incremental: costs of survivors are pushed back twice
+class MisalignedFitness : public LegacyFitness {
+public:
+	bool incremental() const override { return true; }
+};
+
+template <typename Genome = gene_t>
+class Crossover : public genetics::ICrossover<Genome, cost_t> {
+public:
+	~Crossover() override = default;
+
+	bool does_commute() const override { return true; }
+
+	Genome cross(genetics::Generation<Genome> const& generation, genetics::GenerationsCosts<cost_t> const& costs, std::size_t parent1, std::size_t parent2,
+	             genetics::RandomStream& random) override {
+		auto& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+		return Genome((gene_t(specimens[parent1]) + gene_t(specimens[parent2])) / 2 + random.get_random_int<gene_t>(-3, 3));
+	}
+};
+
+template <typename Genome = gene_t>
+class Selection : public genetics::ISelection<Genome, cost_t> {
+public:
+	~Selection() override = default;
+
+	std::size_t survivors() const override { return 20; }
+	std::optional<std::size_t> max_generations() const override { return 12; }
+	std::size_t generations_till_eliminaion() const override { return 2; }
+};
+
+// Niches of width 500 over value of specimen: a few far leaders, and then the rest
+class ValueSimilarity : public genetics::ISimilarity<gene_t, cost_t> {
+public:
+	~ValueSimilarity() override = default;
+
+	std::size_t dimensions() const override { return 1; }
+	void features(gene_t const& specimen, std::span<float> out) const override { out[0] = static_cast<float>(specimen); }
+	float niche_radius() const override { return 500.f; }
+};
+
+// Cost against itself: no specimen dominates another, so all of them are the first front
+class Opposite : public genetics::IObjectives<cost_t> {
+public:
+	~Opposite() override = default;
+
+	std::size_t objectives() const override { return 2; }
+	void values(cost_t const& cost, std::span<double> out) const override {
+		out[0] = static_cast<double>(cost);
+		out[1] = -static_cast<double>(cost);
+	}
+};
+
+// Stops at a specimen close to ideal one
+class GoalSelection : public Selection<> {
+public:
+	bool is_good_enough(gene_t const&, cost_t const& cost) override { return cost <= 12; }
+};
+
+// Never good enough, and too long to wait for
+class EndlessSelection : public Selection<> {
+public:
+	static std::size_t constexpr generations = 1'000'000;
+
+	std::optional<std::size_t> max_generations() const override { return generations; }
+};
+
+// Keeps costs of the last eliminating generation
+class LastCosts : public genetics::IObserver<cost_t> {
+public:
+	~LastCosts() override = default;
+
+	void generation_done(genetics::GenerationStatistics<cost_t> const& statistics) override {
+		if (statistics.eliminating) last = statistics;
+	}
+
+	genetics::GenerationStatistics<cost_t> last;
+};
+
+// Polynomial regression over coefficients of any type, which converts to domain_t (in a vector of any allocator)
+template <typename T, typename Genome = std::vector<T>>
+class SequenceFitness : public genetics::IPointwiseFitness<Genome, PolynomialCost> {
+public:
+	~SequenceFitness() override = default;
+
+	PolynomialCost cost(genetics::SpecimenView<Genome> polynomial, std::size_t) const override {
+		domain_t inaccuracy = 0;
+		for (domain_t x : {-2.f, -1.f, 0.f, 1.f, 2.f, 3.f}) {
+			domain_t value = 0;
+			for (std::size_t i = polynomial.size(); i-- > 0; ) {
+				value = value * x + domain_t(polynomial[i]);
+			}
+			domain_t const error = x * x * x - 2 * x + 1 - value;
+			inaccuracy += error * error;
+		}
+		return PolynomialCost(inaccuracy, polynomial.size());
+	}
+};
+
+template <typename T, typename Genome = std::vector<T>>
+class SequenceCrossover : public genetics::ICrossover<Genome, PolynomialCost> {
+public:
+	~SequenceCrossover() override = default;
+
+	bool does_commute() const override { return false; }
+
+	Genome cross(genetics::Generation<Genome> const& generation, genetics::GenerationsCosts<PolynomialCost> const& costs,
+	             std::size_t parent1, std::size_t parent2, genetics::RandomStream& random) override {
+		Genome offspring;
+		cross_into(generation, costs, parent1, parent2, random, offspring);
+		return offspring;
+	}
+
+	void cross_into(genetics::Generation<Genome> const& generation, genetics::GenerationsCosts<PolynomialCost> const&,
+	                std::size_t parent1, std::size_t parent2, genetics::RandomStream& random, Genome& offspring) override {
+		auto const& polynomials = std::get<genetics::SPECIMENS_ID>(generation);
+		auto const& one = polynomials[parent1];
+		auto const& another = polynomials[parent2];
+		std::size_t const head = random.get_random_int<std::size_t>(0, one.size()),
+		                  tail = random.get_random_int<std::size_t>(0, another.size());
+		offspring.assign(one.begin(), one.begin() + head);
+		offspring.insert(offspring.end(), another.begin() + tail, another.end());
+		if (!offspring.empty() && random.get_random_int<int>(0, 1)) {
+			auto& coefficient = offspring[random.get_random_int<std::size_t>(0, offspring.size() - 1)];
+			coefficient = domain_t(coefficient) + random.get_random_float<domain_t>(-1.f, 1.f);
+		}
+	}
+};
+
+// Offspring are as long as parents, so that recycled genomes of a population of equal lengths always have room for them
+template <typename T, typename Genome = std::vector<T>>
+class BlendCrossover : public SequenceCrossover<T, Genome> {
+public:
+	~BlendCrossover() override = default;
+
+	void cross_into(genetics::Generation<Genome> const& generation, genetics::GenerationsCosts<PolynomialCost> const&,
+	                std::size_t parent1, std::size_t parent2, genetics::RandomStream& random, Genome& offspring) override {
+		auto const& polynomials = std::get<genetics::SPECIMENS_ID>(generation);
+		auto const& one = polynomials[parent1];
+		auto const& another = polynomials[parent2];
+		offspring.resize(one.size());
+		for (std::size_t i = 0; i < offspring.size(); ++i) {
+			offspring[i] = (domain_t(one[i]) + domain_t(another[i])) / 2 + random.get_random_float<domain_t>(-.5f, .5f);
+		}
+	}
+};
+
+template <typename T, typename Genome = std::vector<T>>
+class SequenceSelection : public genetics::ISelection<Genome, PolynomialCost> {
+public:
+	~SequenceSelection() override = default;
+
+	std::size_t survivors() const override { return 30; }
+	std::optional<std::size_t> max_generations() const override { return 20; }
+	std::size_t generations_till_eliminaion() const override { return 2; }
+};
+
+// Specimens as plain polynomials, whatever population they were in
+struct PolynomialRun {
+	std::vector<Polynomial> specimens;
+	std::vector<std::size_t> ages;
+	genetics::GenerationsCosts<PolynomialCost> costs;
+
+	bool operator==(PolynomialRun const& other) const = default;
+};
+
+template <typename T, typename Genome = std::vector<T>, typename Configure>
+PolynomialRun evolve_polynomials(Configure&& configure) {
+	genetics::Environment<Genome, PolynomialCost> env(std::make_shared<SequenceFitness<T, Genome>>(), std::make_shared<SequenceCrossover<T, Genome>>(),
+	                                                  std::make_shared<SequenceSelection<T, Genome>>(), 2, 11);
+	configure(env);
+	genetics::RandomStream random(5, 0);
+	std::vector<Genome> polynomials(30);
+	for (auto& polynomial : polynomials) {
+		polynomial.resize(random.get_random_int<std::size_t>(1, 6));
+		for (auto& coefficient : polynomial) {
+			coefficient = random.get_random_float<domain_t>(-3.f, 3.f);
+		}
+	}
+
+	PolynomialRun run;
+	auto const generation = env.evolve(genetics::new_generation(std::move(polynomials)), run.costs);
+	auto const& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+	for (std::size_t i = 0; i < specimens.size(); ++i) {
+		auto const& specimen = specimens[i];
+		run.specimens.emplace_back(specimen.begin(), specimen.end());
+	}
+	run.ages = std::get<genetics::AGE_ID>(generation).value();
+	return run;
+}
+
+// Genome allocations of a whole run of polynomials of equal lengths after its first steps, where population grows to its size
+// before elimination and buffers of environment fill up (with streaming, recycled genomes go round several of them); Genome is a vector of CountingAllocator
+template <typename Genome, typename Configure>
+std::size_t allocates_after_warm_up(Configure&& configure) {
+	using T = typename Genome::value_type;
+	genetics::Environment<Genome, PolynomialCost> env(std::make_shared<SequenceFitness<T, Genome>>(), std::make_shared<BlendCrossover<T, Genome>>(),
+	                                                  std::make_shared<SequenceSelection<T, Genome>>(), 2, 11);
+	configure(env);
+	genetics::RandomStream random(5, 0);
+	std::vector<Genome> polynomials(30, Genome(4));
+	for (auto& polynomial : polynomials) {
+		for (auto& coefficient : polynomial) {
+			coefficient = random.get_random_float<domain_t>(-3.f, 3.f);
+		}
+	}
+	genetics::EvolutionSession<genetics::Environment<Genome, PolynomialCost>> session(env, genetics::new_generation(std::move(polynomials)));
+	for (std::size_t step = 0; step < 4; ++step) {
+		session.step();
+	}
+	std::size_t const warm = genome_allocations;
+	while (session.step()) { }
+	return session.generations_done() == 20 ? genome_allocations - warm : std::size_t(-1);
+}
+
+struct Run {
+	genetics::Generation<gene_t> generation;
+	genetics::GenerationsCosts<cost_t> costs;
+
+	bool operator==(Run const& other) const {
+		return std::get<genetics::SPECIMENS_ID>(generation) == std::get<genetics::SPECIMENS_ID>(other.generation)
+		       && std::get<genetics::AGE_ID>(generation) == std::get<genetics::AGE_ID>(other.generation)
+		       && costs == other.costs;
+	}
+};
+
+// Specimens of other populations are converted back to gene_t
+template <typename Genome = gene_t, typename Fitness = AgingFitness<Genome>, typename Configure>
+Run evolve(Configure&& configure, std::shared_ptr<Fitness> fitness = std::make_shared<AgingFitness<Genome>>()) {
+	genetics::Environment<Genome, cost_t> env(fitness, std::make_shared<Crossover<Genome>>(), std::make_shared<Selection<Genome>>(), 2, 7);
+	configure(env);
+	genetics::RandomStream random(3, 0);
+	vector<gene_t> specimens(20);
+	random.fill_random_int<gene_t>(specimens, -1000, 1000);
+	genetics::GenerationsCosts<cost_t> costs;
+	auto const generation = env.evolve(genetics::new_generation(std::vector<Genome>(specimens.begin(), specimens.end())), costs);
+	auto const& evolved = std::get<genetics::SPECIMENS_ID>(generation);
+	return Run{{std::vector<gene_t>(evolved.begin(), evolved.end()), std::get<genetics::GENERATION_COUNT_ID>(generation), std::get<genetics::AGE_ID>(generation)},
+	           std::move(costs)};
+}
+
+// Errors as their bits, to compare results of kernels exactly
+std::vector<std::uint32_t> bits_of(std::vector<float> const& errors) {
+	std::vector<std::uint32_t> bits;
+	for (float error : errors) bits.push_back(std::bit_cast<std::uint32_t>(error));
+	return bits;
+}
+
+// Every instruction, row by row, as LinearOp documents them: register 0 at each row
+std::vector<float> run_naively(genetics::LinearMachine const& machine, genetics::LinearProgram const& program, std::vector<std::vector<float>> const& inputs) {
+	std::vector<float> outputs;
+	for (auto const& row : inputs) {
+		std::vector<float> registers(machine.registers, 0.f);
+		auto const source = [&](std::uint8_t operand) {
+			return (operand & genetics::LinearInstruction::INPUT) ? row[operand & ~genetics::LinearInstruction::INPUT] : registers[operand];
+		};
+		for (auto const& instruction : program) {
+			auto const a = [&] { return source(instruction.source1); };
+			auto const b = [&] { return source(instruction.source2); };
+			float const c = instruction.constant;
+			float& r = registers[instruction.destination];
+			switch (instruction.op) {
+			case genetics::LinearOp::ADD: r = a() + b(); break;
+			case genetics::LinearOp::SUB: r = a() - b(); break;
+			case genetics::LinearOp::MUL: r = a() * b(); break;
+			case genetics::LinearOp::DIV: r = std::fabs(b()) < 1e-6f ? a() : a() / b(); break;
+			case genetics::LinearOp::MIN: r = a() < b() ? a() : b(); break;
+			case genetics::LinearOp::MAX: r = a() > b() ? a() : b(); break;
+			case genetics::LinearOp::ADD_CONSTANT: r = a() + c; break;
+			case genetics::LinearOp::MUL_CONSTANT: r = a() * c; break;
+			case genetics::LinearOp::SET_CONSTANT: r = c; break;
+			}
+		}
+		outputs.push_back(registers[0]);
+	}
+	return outputs;
+}
+
+std::size_t failures = 0;
+
+void check(string const& what, bool passed) {
+	cout << what << (passed ? ": ok" : ": FAILED") << endl;
+	failures += passed ? 0 : 1;
+}
+
+int main(int argc, char const *argv[]) {
+	Run const plain = evolve([](auto&) { });
+	cout << "Plain run, best: " << std::get<genetics::SPECIMENS_ID>(plain.generation)[0] << "; fitness = " << plain.costs[0]
+	     << "; age = " << std::get<genetics::AGE_ID>(plain.generation).value()[0] << endl;
+
+	check("Streaming elimination with age-dependent fitness is the same as plain one", evolve([](auto& env) { env.set_streaming_batch(7); }) == plain);
+	check("Pipelined elimination with age-dependent fitness is the same as plain one", evolve([](auto& env) { env.set_pipeline(7); }) == plain);
+	// Generations between eliminations don't fit, so eliminating one is streamed
+	check("Memory budget with age-dependent fitness is the same as plain one", evolve([](auto& env) { env.set_memory_budget(8 * 1024); }) == plain);
+	// Generation between eliminations doesn't fit either (210 specimens of 24 bytes), so only population, which spills, can run
+	check("Spilled population with age-dependent fitness is the same as plain one",
+	      evolve<Stored<gene_t, SPILL>>([](auto& env) { env.set_memory_budget(2 * 1024); }) == plain);
+	bool refused = false;
+	try {
+		evolve([](auto& env) { env.set_memory_budget(2 * 1024); });
+	} catch (std::length_error const&) {
+		refused = true;
+	}
+	check("Population, which cannot spill, is refused by the same budget", refused);
+
+	// Survivors of niches are not sorted, so median and worst are found among them
+	{
+		auto const observer = std::make_shared<LastCosts>();
+		Run const niches = evolve([&](auto& env) {
+			env.set_similarity(std::make_shared<ValueSimilarity>());
+			env.set_observer(observer);
+		});
+		auto sorted = niches.costs;
+		std::sort(sorted.begin(), sorted.end());
+		check("Statistics of survivors of niches", !sorted.empty() && observer->last.best == sorted.front()
+		                                           && observer->last.median == sorted[sorted.size() / 2] && observer->last.worst == sorted.back());
+	}
+
+	// Good enough specimen of the first front stops evolution, wherever it is among survivors
+	{
+		auto const observer = std::make_shared<LastCosts>();
+		genetics::Environment<gene_t, cost_t> env(std::make_shared<AgingFitness<>>(), std::make_shared<Crossover<>>(), std::make_shared<GoalSelection>(), 2, 7);
+		env.set_objectives(std::make_shared<Opposite>());
+		env.set_observer(observer);
+		genetics::RandomStream random(3, 0);
+		vector<gene_t> specimens(20);
+		random.fill_random_int<gene_t>(specimens, -1000, 1000);
+		genetics::GenerationsCosts<cost_t> costs;
+		auto const generation = env.evolve(genetics::new_generation(std::move(specimens)), costs);
+		bool const stopped = std::get<genetics::GENERATION_COUNT_ID>(generation) < 12 && costs.front() > 12;
+		check("Good enough specimen, which is not the first survivor, stops Pareto elimination", stopped);
+		check("Best of Pareto survivors", observer->last.best == *std::min_element(costs.begin(), costs.end()));
+	}
+
+	// Islands don't depend on scheduling without migration: each one is the Environment of its seed
+	{
+		std::uint64_t const seed = 13;
+		auto const islands = [&](std::size_t migrants) {
+			genetics::Islands<gene_t, cost_t> archipelago([](std::size_t) { return std::make_shared<AgingFitness<>>(); },
+			                                              [](std::size_t) { return std::make_shared<Crossover<>>(); },
+			                                              [](std::size_t) { return std::make_shared<Selection<>>(); }, 3, seed);
+			archipelago.set_migration(3, migrants, genetics::MigrationTopology::FULLY_CONNECTED);
+			genetics::RandomStream random(3, 0);
+			vector<gene_t> specimens(20);
+			random.fill_random_int<gene_t>(specimens, -1000, 1000);
+			std::vector<genetics::GenerationsCosts<cost_t>> costs;
+			auto generations = archipelago.evolve(std::vector<genetics::Generation<gene_t>>(3, genetics::new_generation(std::move(specimens))), costs);
+			std::vector<Run> runs;
+			for (std::size_t island = 0; island < generations.size(); ++island) {
+				runs.push_back(Run{std::move(generations[island]), std::move(costs[island])});
+			}
+			return runs;
+		};
+		auto const isolated = islands(0);
+		bool same = isolated == islands(0);
+		for (std::size_t island = 0; island < isolated.size(); ++island) {
+			genetics::Environment<gene_t, cost_t> env(std::make_shared<AgingFitness<>>(), std::make_shared<Crossover<>>(), std::make_shared<Selection<>>(),
+			                                          1, genetics::mix_bits(seed + island));
+			genetics::RandomStream random(3, 0);
+			vector<gene_t> specimens(20);
+			random.fill_random_int<gene_t>(specimens, -1000, 1000);
+			Run alone;
+			alone.generation = env.evolve(genetics::new_generation(std::move(specimens)), alone.costs);
+			same = same && alone == isolated[island];
+		}
+		check("Isolated islands are the same in every run, and as separate environments", same);
+
+		// With migration, result depends on timing; it must still be a valid run
+		auto const migrated = islands(2);
+		bool valid = migrated.size() == 3;
+		for (auto const& run : migrated) {
+			auto const& specimens = std::get<genetics::SPECIMENS_ID>(run.generation);
+			valid = valid && specimens.size() == run.costs.size() && std::get<genetics::GENERATION_COUNT_ID>(run.generation) == 12;
+			for (std::size_t i = 0; valid && i < specimens.size(); ++i) {
+				valid = run.costs[i] == AgingFitness<>().cost(specimens[i], std::get<genetics::AGE_ID>(run.generation).value()[i]);
+			}
+		}
+		check("Islands with migration keep costs of their specimens", valid);
+	}
+
+	// Good enough island stops the others in the middle of their epoch; best island is the one of the best survivor
+	{
+		genetics::Islands<gene_t, cost_t> archipelago([](std::size_t) { return std::make_shared<AgingFitness<>>(); },
+		                                              [](std::size_t) { return std::make_shared<Crossover<>>(); },
+		                                              [](std::size_t island) -> std::shared_ptr<genetics::ISelection<gene_t, cost_t>> {
+		                                                      if (island == 0) return std::make_shared<GoalSelection>();
+		                                                      return std::make_shared<EndlessSelection>();
+		                                              }, 3, 7);
+		archipelago.set_migration(1'000'000, 0, genetics::MigrationTopology::RING);
+		for (std::size_t island = 0; island < archipelago.size(); ++island) {
+			archipelago.island(island).set_objectives(std::make_shared<Opposite>());
+		}
+		genetics::RandomStream random(3, 0);
+		vector<gene_t> specimens(20);
+		random.fill_random_int<gene_t>(specimens, -1000, 1000);
+		std::vector<genetics::GenerationsCosts<cost_t>> costs;
+		auto const generations = archipelago.evolve(std::vector<genetics::Generation<gene_t>>(3, genetics::new_generation(std::move(specimens))), costs);
+		bool stopped = std::get<genetics::GENERATION_COUNT_ID>(generations[0]) < 12;
+		for (std::size_t island = 1; island < generations.size(); ++island) {
+			stopped = stopped && std::get<genetics::GENERATION_COUNT_ID>(generations[island]) < EndlessSelection::generations;
+		}
+		check("Good enough island stops the others before their epoch ends", stopped);
+		bool best = true;
+		auto const& best_costs = costs[archipelago.best_island()];
+		for (auto const& island_costs : costs) {
+			best = best && !island_costs.empty() &&
+			       *std::min_element(best_costs.begin(), best_costs.end()) <= *std::min_element(island_costs.begin(), island_costs.end());
+		}
+		check("Best island has the best survivor", best);
+	}
+
+	// Populations of other containers
+	PolynomialRun const polynomials = evolve_polynomials<domain_t>([](auto&) { });
+	cout << "Polynomials, best: " << listing(polynomials.specimens[0]) << "; fitness = " << polynomials.costs[0] << endl;
+	check("RaggedPopulation is the same as std::vector", evolve_polynomials<Stored<domain_t, RAGGED>>([](auto&) { }) == polynomials);
+	check("RaggedPopulation with streaming elimination is the same as std::vector",
+	      evolve_polynomials<Stored<domain_t, RAGGED>>([](auto& env) { env.set_streaming_batch(16); }) == polynomials);
+	// 465 specimens between eliminations don't fit into the budget
+	check("Spilled RaggedPopulation is the same as std::vector",
+	      evolve_polynomials<Stored<domain_t, SPILL_RAGGED>>([](auto& env) { env.set_memory_budget(8 * 1024); }) == polynomials);
+	refused = false;
+	try {
+		evolve_polynomials<Stored<domain_t, RAGGED>>([](auto& env) { env.set_memory_budget(8 * 1024); });
+	} catch (std::length_error const&) {
+		refused = true;
+	}
+	check("RaggedPopulation, which cannot spill, is refused by the same budget", refused);
+
+	// Cache scores its misses by batches of wrapped fitness, and keeps its bounded evaluation
+	{
+		auto const counting = std::make_shared<CountingFitness>();
+		auto const cached = std::make_shared<genetics::CachedPointwiseFitness<gene_t, cost_t>>(counting, 1 << 10);
+		bool const same = evolve([](auto&) { }, cached) == plain;
+		check("Cached fitness is the same as plain one, and scores only misses, in batches",
+		      same && counting->single == 0 && counting->batched == cached->statistics().misses);
+		auto const bounded = std::make_shared<PolyFitness>(std::vector<std::pair<domain_t, domain_t>>{{0.f, 1.f}}, true);
+		check("Cached bounded fitness is bounded", genetics::CachedPointwiseFitness<Polynomial, PolynomialCost>(bounded, 16).is_bounded());
+	}
+
+	// Session makes the same run in steps, without scoring specimens again; stopped session has no more steps
+	{
+		auto const counting = std::make_shared<CountingFitness>();
+		evolve([](auto&) { }, counting);
+		auto const stepped = std::make_shared<CountingFitness>();
+		genetics::Environment<gene_t, cost_t> env(stepped, std::make_shared<Crossover<>>(), std::make_shared<Selection<>>(), 2, 7);
+		genetics::RandomStream random(3, 0);
+		vector<gene_t> specimens(20);
+		random.fill_random_int<gene_t>(specimens, -1000, 1000);
+		auto const first = genetics::new_generation(std::move(specimens));
+
+		genetics::EvolutionSession<genetics::Environment<gene_t, cost_t>> session(env, first);
+		std::size_t steps = 0;
+		for (auto const& step : session) {
+			steps += step.generations_done() > 0 ? 1 : 0;
+		}
+		Run const run{session.generation(), session.costs()};
+		check("Session is the same as one evolve call, and scores as many specimens", steps == 6 && run == plain && stepped->batched == counting->batched);
+
+		std::stop_source source;
+		source.request_stop();
+		genetics::EvolutionSession<genetics::Environment<gene_t, cost_t>> stopped(env, first, {}, source.get_token());
+		steps = static_cast<std::size_t>(std::distance(stopped.begin(), stopped.end()));
+		std::stop_source later;
+		genetics::EvolutionSession<genetics::Environment<gene_t, cost_t>> cancelled(env, first, {}, later.get_token());
+		std::size_t cancelled_steps = 0;
+		for ([[maybe_unused]] auto const& step : cancelled) {
+			++cancelled_steps;
+			later.request_stop();
+		}
+		check("Stopped session has no steps", steps == 0 && cancelled_steps == 1 && cancelled.generations_done() == 2);
+	}
+
+	// RecyclingPopulation keeps dropped genomes and gives them out again
+	{
+		genetics::RecyclingPopulation<Recycled> population(std::vector<Recycled>{{0}, {1}, {2}, {3}, {4}, {5}});
+		auto const buffer = population[4].data();
+		population.compact({4, 1, 5});
+		bool kept = population.size() == 3 && population.recycled() == 3 && population[0].data() == buffer
+		            && population[0][0] == 4 && population[1][0] == 1 && population[2][0] == 5;
+		genetics::RecyclingPopulation<Recycled> offspring(std::vector<Recycled>{{7}, {8}});
+		std::size_t const allocations = genome_allocations;
+		genetics::splice(population, offspring);
+		kept = kept && genome_allocations == allocations && population.size() == 5 && population.recycled() == 1
+		       && population[3][0] == 7 && population[4][0] == 8 && offspring.empty() && offspring.recycled() == 2;
+		check("RecyclingPopulation keeps survivors in order, and swaps offspring into dropped genomes", kept);
+	}
+	check("RecyclingPopulation is the same as std::vector", evolve_polynomials<Stored<domain_t, RECYCLED>, Recycled>([](auto&) { }) == polynomials);
+	check("RecyclingPopulation doesn't allocate genomes after warm-up", allocates_after_warm_up<Recycled>([](auto&) { }) == 0);
+	check("RecyclingPopulation with streaming elimination doesn't allocate genomes after warm-up",
+	      allocates_after_warm_up<Recycled>([](auto& env) { env.set_streaming_batch(16); }) == 0);
+	check("RaggedPopulation doesn't allocate after warm-up", allocates_after_warm_up<Flat>([](auto&) { }) == 0);
+	check("RaggedPopulation with streaming elimination doesn't allocate after warm-up",
+	      allocates_after_warm_up<Flat>([](auto& env) { env.set_streaming_batch(16); }) == 0);
+
+	// Whole-generation fitness gets empty costs, unless it is incremental; misaligned costs are an error
+	AgingFitness<> const ageless;
+	Run const legacy = evolve([](auto&) { }, std::make_shared<LegacyFitness>());
+	bool aligned = legacy.costs.size() == std::get<genetics::SPECIMENS_ID>(legacy.generation).size();
+	for (std::size_t i = 0; aligned && i < legacy.costs.size(); ++i) {
+		aligned = legacy.costs[i] == ageless.cost(std::get<genetics::SPECIMENS_ID>(legacy.generation)[i], 0);
+	}
+	check("Costs of whole-generation fitness of the old contract", aligned);
+	bool thrown = false;
+	try {
+		evolve([](auto&) { }, std::make_shared<MisalignedFitness>());
+	} catch (std::logic_error const&) {
+		thrown = true;
+	}
+	check("Misaligned costs are caught", thrown);
+
+	// Crossover, which does not commute, gets each pair both ways; any range of matings is a part of the whole list
+	{
+		std::size_t const n = 7;
+		genetics::AllPairsMating<gene_t, cost_t> scheduler(true);
+		genetics::RandomStreams const streams(0, 0);
+		std::size_t const amount = scheduler.schedule(genetics::new_generation<gene_t>(vector<gene_t>(n)), {});
+		vector<genetics::Mating> whole, parts;
+		scheduler.matings(0, amount, streams, whole);
+		scheduler.matings(0, 13, streams, parts);
+		scheduler.matings(13, amount, streams, parts);
+		vector<vector<std::size_t>> times(n, vector<std::size_t>(n));
+		bool ordered = amount == n * (n - 1) && amount == scheduler.expected_matings(n) && whole.size() == amount && parts.size() == amount;
+		for (std::size_t k = 0; ordered && k < amount; ++k) {
+			ordered = whole[k].pair == k && whole[k].parent1 == parts[k].parent1 && whole[k].parent2 == parts[k].parent2;
+			++times[whole[k].parent1][whole[k].parent2];
+		}
+		for (std::size_t i = 0; i < n; ++i) {
+			for (std::size_t j = 0; j < n; ++j) {
+				ordered = ordered && times[i][j] == (i != j ? 1 : 0);
+			}
+		}
+		check("All ordered pairs mate once", ordered);
+	}
+
+	// Kernels of every instruction set, which the processor has, give the same errors bit for bit
+	{
+		using PolynomialIsa = genetics::PolynomialErrors::Isa;
+		genetics::RandomStream random(17, 0);
+		std::vector<std::vector<float>> coefficients(100);
+		for (auto& polynomial : coefficients) {
+			polynomial.resize(random.get_random_int<std::size_t>(1, 12));
+			random.fill_random_float<float>(polynomial, -3.f, 3.f);
+		}
+		std::vector<std::span<float const>> const polynomials(coefficients.begin(), coefficients.end());
+		bool same = true;
+		// Polynomials along lanes, and points along lanes
+		for (std::size_t points : {5u, 100u}) {
+			std::vector<std::pair<float, float>> target(points);
+			for (auto& [x, y] : target) {
+				x = random.get_random_float<float>(-2.f, 2.f);
+				y = random.get_random_float<float>(-10.f, 10.f);
+			}
+			auto const errors_of = [&](PolynomialIsa isa) {
+				std::vector<float> errors(polynomials.size());
+				genetics::PolynomialErrors(target, isa)(polynomials, errors);
+				return bits_of(errors);
+			};
+			auto const scalar = errors_of(PolynomialIsa::SCALAR);
+			for (PolynomialIsa isa : {PolynomialIsa::AVX2, PolynomialIsa::AVX512}) {
+				if (isa <= genetics::PolynomialErrors::best_isa()) same = same && errors_of(isa) == scalar;
+			}
+		}
+		check("Polynomial errors are the same with every instruction set", same);
+
+		using LinearIsa = genetics::LinearInterpreter::Isa;
+		genetics::LinearMachine machine;
+		machine.inputs = 2;
+		std::size_t const rows = 300; // Last block is not whole
+		std::vector<std::vector<float>> inputs(rows, std::vector<float>(machine.inputs));
+		std::vector<float> outputs(rows);
+		for (std::size_t j = 0; j < rows; ++j) {
+			random.fill_random_float<float>(inputs[j], -2.f, 2.f);
+			outputs[j] = random.get_random_float<float>(-10.f, 10.f);
+		}
+		std::vector<genetics::LinearProgram> programs;
+		for (std::size_t i = 0; i < 50; ++i) {
+			programs.push_back(genetics::random_linear_program(machine, random.get_random_int<std::size_t>(1, machine.max_length), random));
+		}
+		auto const linear_errors_of = [&](LinearIsa isa) {
+			genetics::LinearInterpreter const interpreter(machine, inputs, outputs, isa);
+			std::vector<float> errors;
+			for (auto const& program : programs) errors.push_back(interpreter(program));
+			return bits_of(errors);
+		};
+		auto const scalar = linear_errors_of(LinearIsa::SCALAR);
+		same = true;
+		for (LinearIsa isa : {LinearIsa::AVX2, LinearIsa::AVX512}) {
+			if (isa <= genetics::LinearInterpreter::best_isa()) same = same && linear_errors_of(isa) == scalar;
+		}
+		check("Linear programs' errors are the same with every instruction set", same);
+
+		// Introns are skipped: predictions are those of every instruction
+		bool effective = true;
+		genetics::LinearInterpreter const interpreter(machine, inputs, outputs);
+		for (auto const& program : programs) {
+			std::vector<float> predicted(rows);
+			interpreter.predict(program, predicted);
+			effective = effective && bits_of(predicted) == bits_of(run_naively(machine, program, inputs));
+		}
+		check("Linear programs without their introns predict as all of their instructions", effective);
+
+		// Offspring of a few parents start as them; programs accumulate into registers they read, so most of their code is effective
+		std::vector<genetics::LinearProgram> parents;
+		for (std::size_t i = 0; i < 8; ++i) {
+			parents.push_back(genetics::random_linear_program(machine, machine.max_length, random));
+			for (auto& instruction : parents.back()) {
+				if (instruction.op == genetics::LinearOp::SET_CONSTANT) instruction.op = genetics::LinearOp::ADD_CONSTANT;
+				instruction.source1 = instruction.destination;
+			}
+		}
+		auto const generation = genetics::new_generation(std::move(parents));
+		genetics::LinearCrossover<cost_t> crossover(machine);
+		std::vector<genetics::LinearProgram> offspring;
+		for (std::size_t i = 0; i < 200; ++i) {
+			offspring.push_back(crossover.cross(generation, {}, random.get_random_int<std::size_t>(0, 7), random.get_random_int<std::size_t>(0, 7), random));
+		}
+		genetics::LinearInterpreter cached(machine, inputs, outputs);
+		cached.set_prefix_cache(std::size_t(16) << 20, 4);
+		bool hit = true;
+		for (auto const& programs : {std::get<genetics::SPECIMENS_ID>(generation), offspring}) {
+			for (auto const& program : programs) {
+				hit = hit && std::bit_cast<std::uint32_t>(cached(program)) == std::bit_cast<std::uint32_t>(interpreter(program));
+			}
+		}
+		check("Prefix cache gives the same errors, and is used", hit && cached.prefix_cache_statistics().hits > 0);
+	}
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/genetics.hpp"
+#include "../include/genetics_workers.hpp"
+
+// Fitness in worker processes survives crashing and throwing workers, and keeps costs as they were, when it gives up
+
+using namespace std;
+
+typedef std::vector<float> genome_t;
+typedef float cost_t;
+
+// First element of a specimen tells, what worker does with it
+float constexpr CRASH_ONCE = -13, CRASH = -666, THROW = -7; // others are not negative
+
+// Sum of elements; crashes and throws on marked specimens
+// Crashes are counted in shared memory, which every worker inherits, so that a restarted worker knows about the previous one
+class FaultyFitness : public genetics::IPointwiseFitness<genome_t, cost_t> {
+public:
+	FaultyFitness() {
+		void* const mapped = ::mmap(nullptr, sizeof(std::atomic<int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "Cannot map crash counter");
+		crashes = new (mapped) std::atomic<int>(0);
+	}
+	~FaultyFitness() override {
+		::munmap(crashes, sizeof(std::atomic<int>));
+	}
+
+	cost_t cost(genome_t const& specimen, std::size_t) const override {
+		if (!specimen.empty()) {
+			if (specimen[0] == CRASH || (specimen[0] == CRASH_ONCE && crashes->fetch_add(1) == 0)) {
+				::abort();
+			}
+			if (specimen[0] == THROW) throw std::runtime_error("Specimen is not welcome");
+		}
+		cost_t sum = 0;
+		for (float element : specimen) {
+			sum += element;
+		}
+		return sum;
+	}
+
+private:
+	std::atomic<int>* crashes;
+};
+
+// 40 specimens of a few elements, and one marked specimen among them
+genetics::Generation<genome_t> with_specimen(genome_t marked) {
+	std::vector<genome_t> specimens;
+	for (std::size_t i = 0; i < 40; ++i) {
+		specimens.push_back(genome_t(1 + i % 5, static_cast<float>(i)));
+	}
+	specimens[23] = std::move(marked);
+	return genetics::new_generation(std::move(specimens));
+}
+
+bool costs_are_sums(genetics::Generation<genome_t> const& generation, genetics::GenerationsCosts<cost_t> const& costs) {
+	auto const& specimens = std::get<genetics::SPECIMENS_ID>(generation);
+	if (costs.size() != specimens.size()) return false;
+	for (std::size_t i = 0; i < specimens.size(); ++i) {
+		cost_t sum = 0;
+		for (float element : specimens[i]) {
+			sum += element;
+		}
+		if (costs[i] != sum) return false;
+	}
+	return true;
+}
+
+std::size_t failures = 0;
+
+void check(string const& what, bool passed) {
+	cout << what << (passed ? ": ok" : ": FAILED") << endl;
+	failures += passed ? 0 : 1;
+}
+
+// Cost call, which must throw Error, leaves known costs as they are
+template <typename Error>
+bool gives_up(genetics::ProcessPoolFitness<genome_t, cost_t>& fitness, genetics::Generation<genome_t> const& generation) {
+	genetics::GenerationsCosts<cost_t> costs(5, -1.f);
+	try {
+		fitness.cost(generation, costs);
+	} catch (Error const&) {
+		return costs == genetics::GenerationsCosts<cost_t>(5, -1.f);
+	}
+	return false;
+}
+
+int main(int argc, char const *argv[]) {
+	genetics::ProcessPoolFitness<genome_t, cost_t> fitness(std::make_shared<FaultyFitness>(), 3, 4, 4096);
+
+	auto const plain = with_specimen({1, 2, 3});
+	genetics::GenerationsCosts<cost_t> costs;
+	fitness.cost(plain, costs);
+	check("Costs of workers", costs_are_sums(plain, costs) && fitness.restarts() == 0);
+
+	auto const crashing_once = with_specimen({CRASH_ONCE, 1});
+	costs.clear();
+	fitness.cost(crashing_once, costs);
+	check("Crashed worker is forked again, and its specimens are scored", costs_are_sums(crashing_once, costs) && fitness.restarts() == 1);
+
+	std::size_t const restarts = fitness.restarts();
+	bool const crashed = gives_up<std::runtime_error>(fitness, with_specimen({CRASH}));
+	check("Worker, which always crashes on a specimen, is given up after max_attempts",
+	      crashed && fitness.restarts() >= restarts + genetics::ProcessPoolFitness<genome_t, cost_t>::max_attempts);
+	check("Worker, which throws, is given up", gives_up<std::runtime_error>(fitness, with_specimen({THROW})));
+	check("Specimen, which does not fit into ring, is refused", gives_up<std::length_error>(fitness, with_specimen(genome_t(2'000, 1.f))));
+
+	costs.clear();
+	fitness.cost(plain, costs);
+	check("Workers are usable afterwards", costs_are_sums(plain, costs));
+
+	return failures ? 1 : 0;
+}